@@ -0,0 +1,97 @@
+//===--- AllocationChurn.swift --------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the performance of allocating and freeing many small
+// heap objects and array buffers whose lifetimes interleave, as opposed to
+// ObjectAllocation, which frees every object right after allocating it.
+//
+// Run with SWIFT_RUNTIME_ALLOCATOR=threadcache in the environment to compare
+// the runtime's thread-caching allocator against malloc.
+import TestsUtils
+
+final class ChurnSmall {
+  var x: Int
+  init(_ x: Int) { self.x = x }
+}
+
+final class ChurnMedium {
+  var a: Int
+  var b: Int
+  var c: Int
+  var d: Int
+  var next: ChurnSmall?
+  init(_ x: Int, _ n: ChurnSmall?) {
+    a = x; b = x; c = x; d = x
+    next = n
+  }
+}
+
+final class ChurnLarge {
+  var values: (Int, Int, Int, Int, Int, Int, Int, Int,
+               Int, Int, Int, Int, Int, Int, Int, Int)
+  init(_ x: Int) {
+    values = (x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x)
+  }
+}
+
+@inline(never)
+func churnObjects() -> Int {
+  // Keep a window of live objects of mixed sizes so that frees happen out
+  // of allocation order.
+  var small = [ChurnSmall?](repeating: nil, count: 64)
+  var medium = [ChurnMedium?](repeating: nil, count: 64)
+  var large = [ChurnLarge?](repeating: nil, count: 16)
+  var s = 0
+  for i in 0..<10_000 {
+    let x = ChurnSmall(i)
+    small[(i &* 7) & 63] = x
+    medium[(i &* 13) & 63] = ChurnMedium(i, x)
+    if i & 3 == 0 {
+      large[(i &* 5) & 15] = ChurnLarge(i)
+    }
+    s += medium[i & 63]?.a ?? 0
+  }
+  return s
+}
+
+@inline(never)
+func churnArrays() -> Int {
+  // Grow short arrays through the small size classes, as ArrayAppend does,
+  // and drop them again.
+  var s = 0
+  for i in 0..<2_000 {
+    var a = [Int]()
+    for j in 0..<(i & 31) {
+      a.append(j)
+    }
+    s += a.count
+  }
+  return s
+}
+
+@inline(never)
+public func run_AllocationChurnObjects(_ N: Int) {
+  var result = 0
+  for _ in 0..<N {
+    result = churnObjects()
+  }
+  CheckResults(result > 0, "Incorrect results in churnObjects")
+}
+
+@inline(never)
+public func run_AllocationChurnArrays(_ N: Int) {
+  var result = 0
+  for _ in 0..<N {
+    result = churnArrays()
+  }
+  CheckResults(result == 30_872, "Incorrect results in churnArrays")
+}
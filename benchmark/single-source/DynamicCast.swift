@@ -0,0 +1,111 @@
+//===--- DynamicCast.swift ------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the performance of the conditional casts that decoding
+// layers perform on heterogeneous values: class instances to a protocol,
+// structs to an existential, and Any to concrete types. Each cast site sees
+// a mix of types that succeed and fail.
+import TestsUtils
+
+protocol CastWeighted {
+  var weight: Int { get }
+}
+
+class CastBase {}
+
+final class CastWeightedClass : CastBase, CastWeighted {
+  var weight: Int { return 1 }
+}
+
+final class CastPlainClass : CastBase {}
+
+struct CastWeightedStruct : CastWeighted {
+  var weight: Int { return 2 }
+}
+
+struct CastPlainStruct {
+  var value = 0
+}
+
+@inline(never)
+func castObjectToProtocol(_ object: AnyObject) -> CastWeighted? {
+  return object as? CastWeighted
+}
+
+@inline(never)
+func castValueToProtocol<T>(_ value: T) -> CastWeighted? {
+  return value as? CastWeighted
+}
+
+@inline(never)
+func castAnyToInt(_ value: Any) -> Int? {
+  return value as? Int
+}
+
+@inline(never)
+func castAnyToString(_ value: Any) -> String? {
+  return value as? String
+}
+
+@inline(never)
+public func run_DynamicCastClassToProtocol(_ N: Int) {
+  let objects: [AnyObject] = (0..<100).map {
+    $0 % 4 == 0 ? CastPlainClass() : CastWeightedClass()
+  }
+  var total = 0
+  for _ in 0..<N * 100 {
+    for object in objects {
+      if let weighted = castObjectToProtocol(object) {
+        total += weighted.weight
+      }
+    }
+  }
+  CheckResults(total == N * 100 * 75,
+               "Incorrect results in DynamicCastClassToProtocol")
+}
+
+@inline(never)
+public func run_DynamicCastStructToExistential(_ N: Int) {
+  var total = 0
+  for _ in 0..<N * 10_000 {
+    for i in 0..<4 {
+      let result = i == 0 ? castValueToProtocol(CastPlainStruct())
+                          : castValueToProtocol(CastWeightedStruct())
+      if let weighted = result {
+        total += weighted.weight
+      }
+    }
+  }
+  CheckResults(total == N * 10_000 * 6,
+               "Incorrect results in DynamicCastStructToExistential")
+}
+
+@inline(never)
+public func run_DynamicCastAnyToConcrete(_ N: Int) {
+  let values: [Any] = (0..<100).map {
+    $0 % 2 == 0 ? $0 as Any : String($0) as Any
+  }
+  var total = 0
+  for _ in 0..<N * 100 {
+    for value in values {
+      if let int = castAnyToInt(value) {
+        total += int
+      } else if let string = castAnyToString(value) {
+        total += string.utf8.count
+      }
+    }
+  }
+  // The even numbers below 100 sum to 2450, and the odd ones are written
+  // with 5 one-digit and 45 two-digit strings.
+  CheckResults(total == N * 100 * (2450 + 95),
+               "Incorrect results in DynamicCastAnyToConcrete")
+}
@@ -0,0 +1,39 @@
+//===--- GenericMetadataLookup.swift --------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the cost of looking up generic type metadata that has
+// already been instantiated. Nesting Box a thousand levels deep puts a
+// thousand entries into Box's metadata cache, and every level of the
+// recursion looks one of them up again.
+import TestsUtils
+
+struct Box<T> {}
+
+let nestingDepth = 1_000
+
+// Keep the optimizer from specializing the recursion, so that each level
+// asks the runtime for the metadata of Box<T>.
+@_semantics("optimize.sil.never")
+func lookUpNestedBoxes<T>(_ type: T.Type, _ depth: Int) -> Int {
+  if depth == 0 {
+    return 0
+  }
+  return lookUpNestedBoxes(Box<T>.self, depth - 1) + 1
+}
+
+@inline(never)
+public func run_GenericMetadataLookup(_ N: Int) {
+  for _ in 0..<N * 10 {
+    CheckResults(lookUpNestedBoxes(Int.self, nestingDepth) == nestingDepth,
+                 "Incorrect results in GenericMetadataLookup")
+  }
+}
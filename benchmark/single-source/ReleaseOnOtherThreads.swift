@@ -0,0 +1,58 @@
+//===--- ReleaseOnOtherThreads.swift --------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the cost of releasing references to an object on threads
+// other than the one that allocated and retained it. The runtime may count
+// the allocating thread's references separately from everyone else's, in
+// which case these releases have to be reconciled with its count.
+import TestsUtils
+import Darwin
+
+final class SharedObject {
+  var value = 1
+}
+
+let releasesPerThread = 10_000
+let threadCount = 8
+
+@inline(never)
+func releaseOnThreads(_ object: SharedObject) {
+  let unmanaged = Unmanaged.passUnretained(object)
+  for _ in 0..<releasesPerThread * threadCount {
+    _ = unmanaged.retain()
+  }
+
+  var threads = [pthread_t?](repeating: nil, count: threadCount)
+  for i in 0..<threadCount {
+    let result = pthread_create(&threads[i], nil, {
+      let object = Unmanaged<SharedObject>.fromOpaque($0)
+      for _ in 0..<releasesPerThread {
+        object.release()
+      }
+      return nil
+    }, unmanaged.toOpaque())
+    CheckResults(result == 0, "Could not create a thread")
+  }
+  for thread in threads {
+    pthread_join(thread!, nil)
+  }
+}
+
+@inline(never)
+public func run_ReleaseOnOtherThreads(_ N: Int) {
+  let object = SharedObject()
+  for _ in 0..<N {
+    releaseOnThreads(object)
+  }
+  CheckResults(object.value == 1,
+               "Incorrect results in ReleaseOnOtherThreads")
+}
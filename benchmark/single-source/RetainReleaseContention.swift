@@ -0,0 +1,95 @@
+//===--- RetainReleaseContention.swift ------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the cost of retains and releases of one object shared by
+// several threads. Every thread retains and releases the same object, so
+// for an ordinary object they contend on its reference count. The Immortal
+// variants make the object immortal first, which turns its retains and
+// releases into plain loads. Compare the 1 and 8 thread variants to see how
+// the cost scales with contention.
+import TestsUtils
+import Darwin
+
+final class SharedObject {
+  var value = 1
+}
+
+@_silgen_name("swift_setImmortal")
+func _setImmortal(_ object: SharedObject)
+
+let pairsPerThread = 100_000
+
+// Keep the SIL optimizer from pairing up and removing the retains and
+// releases that are being measured.
+@_semantics("optimize.sil.never")
+func retainAndRelease(_ object: Unmanaged<SharedObject>) -> Int {
+  var s = 0
+  for _ in 0..<pairsPerThread {
+    _ = object.retain()
+    s += object.takeUnretainedValue().value
+    object.release()
+  }
+  return s
+}
+
+@inline(never)
+func retainAndReleaseOnThreads(_ object: SharedObject,
+                               _ threadCount: Int) {
+  let unmanaged = Unmanaged.passUnretained(object)
+  var threads = [pthread_t?](repeating: nil, count: threadCount)
+  for i in 0..<threadCount {
+    let result = pthread_create(&threads[i], nil, {
+      let object = Unmanaged<SharedObject>.fromOpaque($0)
+      CheckResults(retainAndRelease(object) == pairsPerThread,
+                   "Incorrect results in RetainReleaseContention")
+      return nil
+    }, unmanaged.toOpaque())
+    CheckResults(result == 0, "Could not create a thread")
+  }
+  for thread in threads {
+    pthread_join(thread!, nil)
+  }
+}
+
+@inline(never)
+func runRetainReleaseContention(_ N: Int, threadCount: Int,
+                                immortal: Bool) {
+  let object = SharedObject()
+  if immortal {
+    _setImmortal(object)
+  }
+  for _ in 0..<N {
+    retainAndReleaseOnThreads(object, threadCount)
+  }
+  CheckResults(object.value == 1,
+               "Incorrect results in RetainReleaseContention")
+}
+
+@inline(never)
+public func run_RetainReleaseContention1(_ N: Int) {
+  runRetainReleaseContention(N, threadCount: 1, immortal: false)
+}
+
+@inline(never)
+public func run_RetainReleaseContention8(_ N: Int) {
+  runRetainReleaseContention(N, threadCount: 8, immortal: false)
+}
+
+@inline(never)
+public func run_RetainReleaseContentionImmortal1(_ N: Int) {
+  runRetainReleaseContention(N, threadCount: 1, immortal: true)
+}
+
+@inline(never)
+public func run_RetainReleaseContentionImmortal8(_ N: Int) {
+  runRetainReleaseContention(N, threadCount: 8, immortal: true)
+}
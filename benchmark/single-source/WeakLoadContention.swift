@@ -0,0 +1,82 @@
+//===--- WeakLoadContention.swift -----------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the cost of loading one weak reference shared by several
+// threads. Every load retains the object, so the threads contend on its
+// reference count but on nothing else. Compare the 1 and 8 thread variants
+// to see how the cost scales with contention.
+import TestsUtils
+import Darwin
+
+final class SharedObject {
+  var value = 1
+}
+
+final class WeakBox {
+  weak var object: SharedObject?
+
+  init(_ object: SharedObject) {
+    self.object = object
+  }
+}
+
+let loadsPerThread = 100_000
+
+@inline(never)
+func loadWeak(_ box: WeakBox) -> Int {
+  var s = 0
+  for _ in 0..<loadsPerThread {
+    if let object = box.object {
+      s += object.value
+    }
+  }
+  return s
+}
+
+@inline(never)
+func loadWeakOnThreads(_ box: WeakBox, _ threadCount: Int) {
+  let unmanaged = Unmanaged.passUnretained(box)
+  var threads = [pthread_t?](repeating: nil, count: threadCount)
+  for i in 0..<threadCount {
+    let result = pthread_create(&threads[i], nil, {
+      let box = Unmanaged<WeakBox>.fromOpaque($0).takeUnretainedValue()
+      CheckResults(loadWeak(box) == loadsPerThread,
+                   "Incorrect results in WeakLoadContention")
+      return nil
+    }, unmanaged.toOpaque())
+    CheckResults(result == 0, "Could not create a thread")
+  }
+  for thread in threads {
+    pthread_join(thread!, nil)
+  }
+}
+
+@inline(never)
+func runWeakLoadContention(_ N: Int, threadCount: Int) {
+  let object = SharedObject()
+  let box = WeakBox(object)
+  for _ in 0..<N {
+    loadWeakOnThreads(box, threadCount)
+  }
+  CheckResults(box.object === object,
+               "Incorrect results in WeakLoadContention")
+}
+
+@inline(never)
+public func run_WeakLoadContention1(_ N: Int) {
+  runWeakLoadContention(N, threadCount: 1)
+}
+
+@inline(never)
+public func run_WeakLoadContention8(_ N: Int) {
+  runWeakLoadContention(N, threadCount: 8)
+}
@@ -21,6 +21,7 @@
 import TestsUtils
 import DriverUtils
 import Ackermann
+import AllocationChurn
 import AngryPhonebook
 import AnyHashableWithAClass
 import Array2D
@@ -46,8 +47,10 @@ import DictionaryBridge
 import DictionaryLiteral
 import DictionaryRemove
 import DictionarySwap
+import DynamicCast
 import ErrorHandling
 import Fibonacci
+import GenericMetadataLookup
 import GlobalClass
 import Hanoi
 import Hash
@@ -80,6 +83,8 @@ import RC4
 import RGBHistogram
 import RangeAssignment
 import RecursiveOwnedParameter
+import ReleaseOnOtherThreads
+import RetainReleaseContention
 import SetTests
 import SevenBoom
 import Sim2DArray
@@ -98,9 +103,12 @@ import TwoSum
 import TypeFlood
 import UTF8Decode
 import Walsh
+import WeakLoadContention
 import XorLoop
 
 precommitTests = [
+  "AllocationChurnArrays": run_AllocationChurnArrays,
+  "AllocationChurnObjects": run_AllocationChurnObjects,
   "AngryPhonebook": run_AngryPhonebook,
   "AnyHashableWithAClass": run_AnyHashableWithAClass,
   "Array2D": run_Array2D,
@@ -136,7 +144,11 @@ precommitTests = [
   "DictionaryRemoveOfObjects": run_DictionaryRemoveOfObjects,
   "DictionarySwap": run_DictionarySwap,
   "DictionarySwapOfObjects": run_DictionarySwapOfObjects,
+  "DynamicCastAnyToConcrete": run_DynamicCastAnyToConcrete,
+  "DynamicCastClassToProtocol": run_DynamicCastClassToProtocol,
+  "DynamicCastStructToExistential": run_DynamicCastStructToExistential,
   "ErrorHandling": run_ErrorHandling,
+  "GenericMetadataLookup": run_GenericMetadataLookup,
   "GlobalClass": run_GlobalClass,
   "Hanoi": run_Hanoi,
   "HashTest": run_HashTest,
@@ -204,6 +216,11 @@ precommitTests = [
   "RGBHistogramOfObjects": run_RGBHistogramOfObjects,
   "RangeAssignment": run_RangeAssignment,
   "RecursiveOwnedParameter": run_RecursiveOwnedParameter,
+  "ReleaseOnOtherThreads": run_ReleaseOnOtherThreads,
+  "RetainReleaseContention1": run_RetainReleaseContention1,
+  "RetainReleaseContention8": run_RetainReleaseContention8,
+  "RetainReleaseContentionImmortal1": run_RetainReleaseContentionImmortal1,
+  "RetainReleaseContentionImmortal8": run_RetainReleaseContentionImmortal8,
   "SetExclusiveOr": run_SetExclusiveOr,
   "SetIntersect": run_SetIntersect,
   "SetIsSubsetOf": run_SetIsSubsetOf,
@@ -235,6 +252,8 @@ precommitTests = [
   "TypeFlood": run_TypeFlood,
   "UTF8Decode": run_UTF8Decode,
   "Walsh": run_Walsh,
+  "WeakLoadContention1": run_WeakLoadContention1,
+  "WeakLoadContention8": run_WeakLoadContention8,
   "XorLoop": run_XorLoop,
 ]
 
@@ -27,6 +27,7 @@
 #include "swift/Basic/SourceLoc.h"
 #include "swift/Basic/STLExtras.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallSet.h"
@@ -809,6 +810,23 @@ private:
   /// this source file so far.
   llvm::MD5 InterfaceHash;
 
+  /// Hashes of the interface-contributing tokens of the declarations that
+  /// are being parsed, from outermost to innermost.
+  SmallVector<llvm::MD5, 2> DeclInterfaceHashes;
+
+  /// The names that the outermost declaration being parsed refers to in its
+  /// interface-contributing tokens.
+  std::vector<StringRef> DeclReferencedNames;
+
+  struct DeclFingerprint {
+    std::string Hash;
+    std::vector<StringRef> ReferencedNames;
+  };
+
+  /// The fingerprint of each declaration whose interface-contributing tokens
+  /// were hashed while it was parsed.
+  llvm::DenseMap<const Decl *, DeclFingerprint> DeclFingerprints;
+
   /// \brief The ID for the memory buffer containing this file's source.
   ///
   /// May be -1, to indicate no association with a buffer.
@@ -1036,6 +1054,51 @@ public:
     // Add null byte to separate tokens.
     uint8_t a[1] = {0};
     InterfaceHash.update(a);
+    for (auto &declHash : DeclInterfaceHashes) {
+      declHash.update(token);
+      declHash.update(a);
+    }
+  }
+
+  /// Records that the interface-contributing tokens of the declaration being
+  /// parsed refer to \p name, which is an identifier or operator.
+  void recordInterfaceReference(StringRef name) {
+    if (!DeclInterfaceHashes.empty())
+      DeclReferencedNames.push_back(name);
+  }
+
+  /// Starts hashing the interface-contributing tokens of a declaration, as
+  /// well as those of the whole file. Declarations may be nested, in which
+  /// case the tokens of the inner declaration also count towards the outer.
+  void beginDeclFingerprint() {
+    DeclInterfaceHashes.emplace_back();
+  }
+
+  /// Finishes the innermost declaration started by beginDeclFingerprint, and
+  /// records the hash of its tokens as the fingerprint of each of \p decls.
+  ///
+  /// The names referred to are only recorded for outermost declarations.
+  void endDeclFingerprint(ArrayRef<const Decl *> decls);
+
+  /// Returns the fingerprint recorded for \p D, or an empty string if there
+  /// is none.
+  ///
+  /// Fingerprints let dependency tracking tell which declarations of a file
+  /// changed when the file's interface hash changes.
+  StringRef getDeclFingerprint(const Decl *D) const {
+    auto found = DeclFingerprints.find(D);
+    if (found == DeclFingerprints.end())
+      return StringRef();
+    return found->second.Hash;
+  }
+
+  /// Returns the identifiers and operators that the interface of \p D refers
+  /// to, if \p D is a top-level declaration with a fingerprint.
+  ArrayRef<StringRef> getDeclReferencedNames(const Decl *D) const {
+    auto found = DeclFingerprints.find(D);
+    if (found == DeclFingerprints.end())
+      return {};
+    return found->second.ReferencedNames;
   }
 
   const llvm::MD5 &getInterfaceHashState() { return InterfaceHash; }
@@ -101,6 +101,10 @@ public:
   /// Emit a mapping of profile counters for use in coverage.
   bool EmitProfileCoverageMapping = false;
 
+  /// The profdata file whose execution counts should be attached to SIL
+  /// basic blocks, or empty if there is none.
+  std::string UseProfile;
+
   /// Should we use a pass pipeline passed in via a json file? Null by default.
   llvm::StringRef ExternalPassPipelineFilename;
   
@@ -0,0 +1,173 @@
+//===--- BinaryDependencyFile.h - Binary .swiftdeps format ------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines a compact binary encoding of the reference dependencies
+/// ("swiftdeps") the frontend emits for each primary file.
+///
+/// The binary form holds the same information as the YAML form, but can be
+/// read straight out of a memory-mapped file: every name is interned once in
+/// a string table, and records refer to names by index. Reading a file does
+/// not allocate.
+///
+/// All integers are 32-bit little-endian. The layout is
+///
+/// \code
+///   magic          "\xE2SDB"
+///   version        BinaryDependencyFile::Version
+///   numStrings
+///   numRecords
+///   numFingerprints
+///   interfaceHash  string index, or NoString
+///   strings        numStrings x (offset, length), offsets relative to
+///                  the start of the string data
+///   records        numRecords x (name, kind | direction | cascading)
+///   fingerprints   numFingerprints x (name, kind, fingerprint)
+///   string data
+/// \endcode
+///
+/// Member names are stored as a single string of the form
+/// "{MangledBaseName}\0memberName", which is the key the driver's dependency
+/// graph uses for them.
+///
+/// Fingerprints summarize the declarations behind each provided name, so that
+/// the driver can tell which names are affected by a change to the file.
+/// Only top-level, nominal, and member names have them.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_BASIC_BINARYDEPENDENCYFILE_H
+#define SWIFT_BASIC_BINARYDEPENDENCYFILE_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <tuple>
+#include <vector>
+
+namespace swift {
+
+/// A read-only view of a binary reference dependencies file.
+class BinaryDependencyFile {
+public:
+  static const uint32_t Version = 2;
+  static const uint32_t NoString = ~0U;
+
+  /// The kinds of names a file can provide or depend on.
+  ///
+  /// These match the sections of the YAML form.
+  enum class Kind : uint8_t {
+    TopLevel,
+    Nominal,
+    Member,
+    DynamicLookup,
+    External,
+    Last_Kind = External
+  };
+
+  struct Record {
+    StringRef Name;
+    Kind RecordKind;
+    bool IsProvides;
+    bool IsCascading;
+  };
+
+  /// The fingerprint of the declarations that provide a name.
+  struct Fingerprint {
+    StringRef Name;
+    Kind FingerprintKind;
+    StringRef Value;
+  };
+
+private:
+  const char *StringEntries = nullptr;
+  const char *Records = nullptr;
+  const char *Fingerprints = nullptr;
+  StringRef StringData;
+  uint32_t NumStrings = 0;
+  uint32_t NumRecords = 0;
+  uint32_t NumFingerprints = 0;
+  uint32_t InterfaceHash = NoString;
+
+  StringRef getString(uint32_t index) const;
+
+public:
+  /// Returns true if \p data starts with the binary format's signature.
+  ///
+  /// This is enough to tell the binary and YAML forms apart.
+  static bool hasSignature(StringRef data);
+
+  /// Checks that \p data is a well-formed binary dependencies file.
+  ///
+  /// Everything is validated up front, so that the accessors below can
+  /// trust the file. On success, the returned view refers into \p data,
+  /// which must outlive it.
+  static bool read(StringRef data, BinaryDependencyFile &result);
+
+  unsigned getNumRecords() const { return NumRecords; }
+  Record getRecord(unsigned index) const;
+
+  unsigned getNumFingerprints() const { return NumFingerprints; }
+  Fingerprint getFingerprint(unsigned index) const;
+
+  /// Returns the interface hash, or an empty string if there is none.
+  StringRef getInterfaceHash() const {
+    if (InterfaceHash == NoString)
+      return StringRef();
+    return getString(InterfaceHash);
+  }
+};
+
+/// Collects reference dependencies and writes them in the binary form.
+///
+/// \sa BinaryDependencyFile
+class BinaryDependencyFileWriter {
+  using Kind = BinaryDependencyFile::Kind;
+
+  llvm::StringMap<uint32_t> StringIndices;
+  std::vector<StringRef> Strings;
+  std::vector<std::pair<uint32_t, uint32_t>> Records;
+  std::vector<std::tuple<uint32_t, Kind, uint32_t>> Fingerprints;
+  uint32_t InterfaceHash = BinaryDependencyFile::NoString;
+
+  uint32_t intern(StringRef name);
+  void addRecord(StringRef name, Kind kind, bool isProvides,
+                 bool isCascading);
+
+public:
+  void addProvides(Kind kind, StringRef name) {
+    addRecord(name, kind, /*provides*/true, /*cascading*/true);
+  }
+  void addDepends(Kind kind, StringRef name, bool isCascading) {
+    addRecord(name, kind, /*provides*/false, isCascading);
+  }
+
+  /// Adds a member entry, which is keyed by both the mangled name of the
+  /// base type and the member name.
+  void addMember(StringRef baseName, StringRef memberName, bool isProvides,
+                 bool isCascading);
+
+  /// Records the fingerprint of the declarations that provide \p name.
+  void addFingerprint(Kind kind, StringRef name, StringRef fingerprint) {
+    Fingerprints.emplace_back(intern(name), kind, intern(fingerprint));
+  }
+  void addMemberFingerprint(StringRef baseName, StringRef memberName,
+                            StringRef fingerprint);
+
+  void setInterfaceHash(StringRef hash) { InterfaceHash = intern(hash); }
+
+  void write(raw_ostream &out) const;
+};
+
+} // end namespace swift
+
+#endif
@@ -19,6 +19,7 @@
 #include "llvm/Support/Program.h"
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <queue>
 
@@ -40,12 +41,23 @@ enum class TaskFinishedResponse {
 
 /// \brief A class encapsulating the execution of multiple tasks in parallel.
 class TaskQueue {
-  /// Tasks which have not begun execution.
-  std::queue<std::unique_ptr<Task>> QueuedTasks;
+  /// Tasks which have not begun execution, keyed by priority. Tasks with
+  /// higher priorities are executed first; tasks with the same priority are
+  /// executed in the order in which they were added.
+  std::multimap<unsigned, std::unique_ptr<Task>, std::greater<unsigned>>
+    QueuedTasks;
 
   /// The number of tasks to execute in parallel.
   unsigned NumberOfParallelTasks;
 
+  /// If nonzero, no task is started while the system load average is at
+  /// least this high, unless no other task is executing.
+  double MaximumLoadAverage = 0;
+
+  /// Whether to limit parallel execution using the GNU make jobserver named
+  /// in the MAKEFLAGS environment variable, if there is one.
+  bool UsesJobserver = false;
+
 public:
   /// \brief Create a new TaskQueue instance.
   ///
@@ -113,6 +125,22 @@ public:
   /// parallel
   unsigned getNumberOfParallelTasks() const;
 
+  /// \brief Stops the TaskQueue from starting new tasks while the system load
+  /// average is at least \p Limit, unless no other task is executing.
+  ///
+  /// A limit of 0 (the default) disables the check.
+  void setMaximumLoadAverage(double Limit) { MaximumLoadAverage = Limit; }
+
+  /// \brief Makes the TaskQueue cooperate with a GNU make jobserver.
+  ///
+  /// If the MAKEFLAGS environment variable names a jobserver when \ref execute
+  /// is called, each task other than the first one executing at a time must
+  /// take a token from the jobserver, which is given back when the task
+  /// finishes. This lets an outer build system limit the total number of
+  /// jobs running at once. The number of parallel tasks is still limited by
+  /// \ref getNumberOfParallelTasks.
+  void setUsesJobserver(bool Value = true) { UsesJobserver = Value; }
+
   /// \brief Adds a task to the TaskQueue.
   ///
   /// \param ExecPath the path to the executable which the task should execute
@@ -120,9 +148,11 @@ public:
   /// \param Env the environment which should be used for the task;
   /// must be null-terminated. If empty, inherits the parent's environment.
   /// \param Context an optional context which will be associated with the task
+  /// \param Priority tasks with higher priorities are started before tasks
+  /// with lower ones
   virtual void addTask(const char *ExecPath, ArrayRef<const char *> Args,
                        ArrayRef<const char *> Env = llvm::None,
-                       void *Context = nullptr);
+                       void *Context = nullptr, unsigned Priority = 0);
 
   /// \brief Synchronously executes the tasks in the TaskQueue.
   ///
@@ -159,7 +189,8 @@ class DummyTaskQueue : public TaskQueue {
       : ExecPath(ExecPath), Args(Args), Env(Env), Context(Context) {}
   };
 
-  std::queue<std::unique_ptr<DummyTask>> QueuedTasks;
+  std::multimap<unsigned, std::unique_ptr<DummyTask>, std::greater<unsigned>>
+    QueuedTasks;
 
 public:
   /// \brief Create a new DummyTaskQueue instance.
@@ -168,7 +199,7 @@ public:
 
   virtual void addTask(const char *ExecPath, ArrayRef<const char *> Args,
                        ArrayRef<const char *> Env = llvm::None,
-                       void *Context = nullptr);
+                       void *Context = nullptr, unsigned Priority = 0);
 
   virtual bool
   execute(TaskBeganCallback Began = TaskBeganCallback(),
@@ -136,6 +136,8 @@ public:
     };
     Status status = UpToDate;
     llvm::sys::TimeValue previousModTime;
+    /// How long compiling the input took, or zero if that isn't known.
+    llvm::sys::TimeValue previousDuration;
 
     InputInfo() = default;
     InputInfo(Status stat, llvm::sys::TimeValue time)
@@ -40,6 +40,7 @@ namespace swift {
 
 namespace driver {
   class Driver;
+  class OutputInfo;
   class ToolChain;
 
 /// An enum providing different levels of output which should be produced
@@ -110,6 +111,10 @@ private:
   /// parallel.
   unsigned NumberOfParallelCommands;
 
+  /// If nonzero, no command is started while the system load average is at
+  /// least this high, unless no other command is running.
+  double MaximumLoadAverage = 0;
+
   /// Indicates whether this Compilation should use skip execution of
   /// subtasks during performJobs() by using a dummy TaskQueue.
   ///
@@ -136,6 +141,19 @@ private:
   /// rebuilt.
   bool ShowIncrementalBuildDecisions = false;
 
+  /// When true, dumps the chain of jobs that determined how long the build
+  /// took, with how long each of them ran.
+  bool ShowCriticalPath = false;
+
+  /// When non-null, compile jobs that are ready to run at the same time are
+  /// combined into about NumberOfParallelCommands batches, each of which is
+  /// performed by a single frontend invocation with several primary files.
+  /// The batch jobs are constructed by this ToolChain.
+  const ToolChain *BatchModeToolChain = nullptr;
+
+  /// The OutputInfo that the jobs in batches were constructed with.
+  std::unique_ptr<const OutputInfo> BatchModeOutputInfo;
+
   static const Job *unwrap(const std::unique_ptr<const Job> &p) {
     return p.get();
   }
@@ -176,6 +194,10 @@ public:
     return NumberOfParallelCommands;
   }
 
+  void setMaximumLoadAverage(double Value) {
+    MaximumLoadAverage = Value;
+  }
+
   bool getIncrementalBuildEnabled() const {
     return EnableIncrementalBuild;
   }
@@ -194,11 +216,32 @@ public:
     ShowIncrementalBuildDecisions = value;
   }
 
+  void setShowsCriticalPath(bool value = true) {
+    ShowCriticalPath = value;
+  }
+
+  bool getBatchModeEnabled() const {
+    return BatchModeToolChain != nullptr;
+  }
+
+  /// Combine compile jobs into batches, constructed by \p TC from jobs that
+  /// were constructed with \p OI.
+  void enableBatchMode(const ToolChain &TC, const OutputInfo &OI);
+
   void setCompilationRecordPath(StringRef path) {
     assert(CompilationRecordPath.empty() && "already set");
     CompilationRecordPath = path;
   }
 
+  /// The path at which the .swiftdeps files of each build are saved, next
+  /// to the compilation record.
+  ///
+  /// \sa DependencyCache
+  std::string getDependencyCachePath() const {
+    assert(!CompilationRecordPath.empty());
+    return CompilationRecordPath + ".cache";
+  }
+
   void setLastBuildTime(llvm::sys::TimeValue time) {
     LastBuildTime = time;
   }
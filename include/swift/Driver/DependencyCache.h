@@ -0,0 +1,74 @@
+//===--- DependencyCache.h - Saved .swiftdeps of the last build -*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_DRIVER_DEPENDENCYCACHE_H
+#define SWIFT_DRIVER_DEPENDENCYCACHE_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TimeValue.h"
+
+#include <memory>
+
+namespace swift {
+namespace driver {
+
+/// The contents of every .swiftdeps file of a build, saved in one file next
+/// to the compilation record.
+///
+/// An incremental build has to load the .swiftdeps file of every input to
+/// build its dependency graph, even if nothing has changed. With the cache,
+/// that takes one read instead of one per input; only files that have been
+/// rewritten since the cache was saved are read individually.
+///
+/// Entries are keyed by the path of the .swiftdeps file, and are used only
+/// while that file still has the size and modification time it had when
+/// the cache was written.
+class DependencyCache {
+  struct Entry {
+    StringRef Data;
+    uint64_t Size;
+    llvm::sys::TimeValue ModTime;
+  };
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  llvm::StringMap<Entry> Entries;
+
+  DependencyCache() = default;
+
+public:
+  /// Loads the cache at \p Path.
+  ///
+  /// \returns null if there is no cache, or if it is malformed.
+  static std::unique_ptr<DependencyCache> loadFromPath(StringRef Path);
+
+  /// Returns the saved contents of the .swiftdeps file at \p DepsPath, or
+  /// None if the file has changed since it was saved.
+  ///
+  /// The data is followed by a null character.
+  Optional<StringRef> lookup(StringRef DepsPath) const;
+
+  /// Saves the current contents of the .swiftdeps files \p DepsPaths to a
+  /// cache at \p Path.
+  ///
+  /// Files that \p Previous holds an up-to-date copy of are not read again.
+  /// If that is true of every file, the cache is left alone.
+  static void write(StringRef Path, ArrayRef<StringRef> DepsPaths,
+                    const DependencyCache *Previous);
+};
+
+} // end namespace driver
+} // end namespace swift
+
+#endif
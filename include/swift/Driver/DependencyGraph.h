@@ -129,6 +129,20 @@ private:
   /// \sa SourceFile::getInterfaceHash
   llvm::DenseMap<const void *, std::string> InterfaceHashes;
 
+  /// The fingerprint of each name provided by each node, keyed by the kind
+  /// of the name followed by the name itself.
+  ///
+  /// A fingerprint summarizes the declarations that provide a name. When the
+  /// interface of a node changes, only the names whose fingerprints changed
+  /// need to be followed to other nodes. Nodes whose dependency files have no
+  /// fingerprints have no entry.
+  llvm::DenseMap<const void *, llvm::StringMap<std::string>> Fingerprints;
+
+  /// For nodes whose interface changed when they were last loaded, the
+  /// provided names whose fingerprints changed. The next markTransitive
+  /// starting from such a node only follows these names out of it.
+  llvm::DenseMap<const void *, std::vector<ProvidesEntryTy>> ChangedProvides;
+
   LoadResult loadFromBuffer(const void *node, llvm::MemoryBuffer &buffer);
 
   // FIXME: We should be able to use llvm::mapped_iterator for this, but
@@ -243,14 +257,21 @@ public:
   /// ("depends") are not cleared; new dependencies are considered additive.
   ///
   /// If \p node has already been marked, only its outgoing edges are updated.
+  ///
+  /// If the file has fingerprints for the names \p node provides, a change
+  /// in its interface only affects downstream nodes if some fingerprint
+  /// changed, and the next markTransitive from \p node only follows the
+  /// names whose fingerprints changed.
   LoadResult loadFromPath(T node, StringRef path) {
     return DependencyGraphImpl::loadFromPath(Traits::getAsVoidPointer(node),
                                              path);
   }
 
-  /// Load "depends" and "provides" data for \p node from a plain string.
+  /// Load "depends" and "provides" data for \p node from a plain string,
+  /// which must be followed by a null character.
   ///
-  /// This is only intended for testing purposes.
+  /// This is used for the contents of .swiftdeps files that have already been
+  /// read, such as those saved in a DependencyCache, and for testing.
   ///
   /// \sa loadFromPath
   LoadResult loadFromString(T node, StringRef data) {
@@ -66,10 +66,23 @@ protected:
     /// This just caches C.getArgs().
     const llvm::opt::ArgList &Args;
 
+    /// For a batch job, the compile jobs it performs in a single frontend
+    /// invocation, in input order. Empty for every other job.
+    ArrayRef<const Job *> BatchedJobs;
+
   public:
     JobContext(Compilation &C, ArrayRef<const Job *> Inputs,
                ArrayRef<const Action *> InputActions,
-               const CommandOutput &Output, const OutputInfo &OI);
+               const CommandOutput &Output, const OutputInfo &OI,
+               ArrayRef<const Job *> BatchedJobs = {});
+
+    /// Returns the outputs of each primary file, in the order of
+    /// InputActions.
+    ///
+    /// For a batch job these are the outputs of each of the BatchedJobs, and
+    /// Output only lists their primary outputs together. For every other job
+    /// this is just Output.
+    SmallVector<const CommandOutput *, 1> getPrimaryFileOutputs() const;
 
     /// Forwards to Compilation::getInputFiles.
     ArrayRef<InputPair> getTopLevelInputFiles() const;
@@ -142,6 +155,10 @@ protected:
   /// This method is invoked by findProgramRelativeToSwift().
   virtual std::string findProgramRelativeToSwiftImpl(StringRef name) const;
 
+  /// Returns the path of the executable named by an InvocationInfo.
+  const char *getExecutablePath(const InvocationInfo &invocationInfo,
+                                Compilation &C) const;
+
 public:
   virtual ~ToolChain() = default;
 
@@ -160,6 +177,16 @@ public:
                                     std::unique_ptr<CommandOutput> output,
                                     const OutputInfo &OI) const;
 
+  /// Construct a Job that performs all of the compile jobs \p jobs in a
+  /// single frontend invocation, with each of their inputs as a primary file.
+  ///
+  /// \p jobs must be jobs for CompileJobActions with a single input each and
+  /// no input jobs, in input order. Their command lines are built through
+  /// the same \c constructInvocation method as for a single primary file.
+  std::unique_ptr<Job> constructBatchJob(ArrayRef<const Job *> jobs,
+                                         Compilation &C,
+                                         const OutputInfo &OI) const;
+
   /// Return the default language type to use for the given extension.
   virtual types::ID lookupTypeForExtension(StringRef Ext) const;
 };
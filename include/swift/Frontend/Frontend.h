@@ -307,7 +307,6 @@ class CompilerInstance {
   std::unique_ptr<SILModule> TheSILModule;
 
   DependencyTracker *DepTracker = nullptr;
-  ReferencedNameTracker *NameTracker = nullptr;
 
   Module *MainModule = nullptr;
   SerializedModuleLoader *SML = nullptr;
@@ -328,10 +327,21 @@ class CompilerInstance {
   unsigned MainBufferID = NO_SUCH_BUFFER;
   unsigned PrimaryBufferID = NO_SUCH_BUFFER;
 
-  SourceFile *PrimarySourceFile = nullptr;
+  /// The buffer IDs of the primary inputs, in the order of
+  /// FrontendOptions::BatchPrimaries. Outside of batch mode, this holds just
+  /// PrimaryBufferID, if there is one.
+  SmallVector<unsigned, 1> PrimaryBufferIDs;
+
+  /// The source files for PrimaryBufferIDs, in the same order.
+  SmallVector<SourceFile *, 1> PrimarySourceFiles;
+
+  /// The name trackers for the primary source files, in the same order.
+  SmallVector<ReferencedNameTracker *, 1> NameTrackers;
 
   void createSILModule(bool WholeModule = false);
+  bool isPrimaryBuffer(unsigned BufferID) const;
   void setPrimarySourceFile(SourceFile *SF);
+  bool isPrimarySourceFile(const SourceFile *SF) const;
 
 public:
   SourceManager &getSourceMgr() { return SourceMgr; }
@@ -359,11 +369,17 @@ public:
   }
 
   void setReferencedNameTracker(ReferencedNameTracker *tracker) {
-    assert(!PrimarySourceFile && "must be called before performSema()");
-    NameTracker = tracker;
+    setReferencedNameTrackers(tracker);
   }
   ReferencedNameTracker *getReferencedNameTracker() {
-    return NameTracker;
+    return NameTrackers.empty() ? nullptr : NameTrackers.front();
+  }
+
+  /// Sets the name tracker for each primary input, in the order of
+  /// FrontendOptions::BatchPrimaries.
+  void setReferencedNameTrackers(ArrayRef<ReferencedNameTracker *> trackers) {
+    assert(PrimarySourceFiles.empty() && "must be called before performSema()");
+    NameTrackers.assign(trackers.begin(), trackers.end());
   }
 
   /// Set the SIL module for this compilation instance.
@@ -400,8 +416,17 @@ public:
   }
 
   /// Gets the SourceFile which is the primary input for this CompilerInstance.
+  /// In batch mode, this is the first of the primary source files.
   /// \returns the primary SourceFile, or nullptr if there is no primary input
-  SourceFile *getPrimarySourceFile() { return PrimarySourceFile; }
+  SourceFile *getPrimarySourceFile() {
+    return PrimarySourceFiles.empty() ? nullptr : PrimarySourceFiles.front();
+  }
+
+  /// Gets the SourceFiles for all primary inputs, in the order of
+  /// FrontendOptions::BatchPrimaries.
+  ArrayRef<SourceFile *> getPrimarySourceFiles() const {
+    return PrimarySourceFiles;
+  }
 
   /// \brief Returns true if there was an error during setup.
   bool setup(const CompilerInvocation &Invocation);
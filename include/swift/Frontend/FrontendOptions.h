@@ -72,8 +72,29 @@ public:
 
   /// The input for which output should be generated. If not set, output will
   /// be generated for the whole module.
+  ///
+  /// In batch mode, this is the first of the BatchPrimaries.
   Optional<SelectedInput> PrimaryInput;
 
+  /// The outputs for one primary input of a batch.
+  struct BatchPrimary {
+    /// The index of the primary input in InputFilenames.
+    unsigned InputIndex;
+
+    std::string OutputFilename;
+    std::string ModuleOutputPath;
+    std::string ModuleDocOutputPath;
+    std::string SerializedDiagnosticsPath;
+    std::string DependenciesFilePath;
+    std::string ReferenceDependenciesFilePath;
+  };
+
+  /// When more than one primary input is given (batch mode), the primary
+  /// inputs in input order, each with its own outputs.
+  ///
+  /// Empty if there is at most one primary input.
+  std::vector<BatchPrimary> BatchPrimaries;
+
   /// The kind of input on which the frontend should operate.
   InputFileKind InputKind = InputFileKind::IFK_Swift;
 
@@ -112,6 +133,10 @@ public:
   /// The path to which we should output a Swift reference dependencies file.
   std::string ReferenceDependenciesFilePath;
 
+  /// Whether the reference dependencies file should be written in the binary
+  /// form the driver reads fastest, rather than as YAML.
+  bool EmitBinaryReferenceDependencies = false;
+
   /// The path to which we should output fixits as source edits.
   std::string FixitsOutputPath;
 
@@ -258,6 +283,14 @@ public:
   bool actionIsImmediate() const;
 
   void forAllOutputPaths(std::function<void(const std::string &)> fn) const;
+
+  /// Indicates whether several primary inputs are compiled by this
+  /// invocation.
+  bool isBatchMode() const { return !BatchPrimaries.empty(); }
+
+  /// Returns the options for compiling the \p Index'th primary input of a
+  /// batch as if it were the only primary input.
+  FrontendOptions getOptionsForBatchPrimary(unsigned Index) const;
   
   /// Gets the name of the specified output filename.
   /// If multiple files are specified, the last one is returned.
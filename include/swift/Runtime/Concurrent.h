@@ -13,7 +13,12 @@
 #define SWIFT_RUNTIME_CONCURRENTUTILS_H
 #include <iterator>
 #include <atomic>
+#include <cassert>
+#include <new>
 #include <stdint.h>
+#include <string.h>
+#include <utility>
+#include "swift/Runtime/Mutex.h"
 
 #if defined(__FreeBSD__)
 #include <stdio.h>
@@ -340,6 +345,288 @@ public:
   }
 };
 
+/// A concurrent map that is implemented as an open-addressed hash table of
+/// entry pointers. It supports the same operations as ConcurrentMap and is
+/// meant for read-mostly caches that are looked up far more often than they
+/// are extended.
+///
+/// Lookups take no lock. Insertions are serialized by a lock, but new entries
+/// are constructed before taking it, so constructing an entry may look up or
+/// insert other entries in the same map. When the table needs to grow, its
+/// entry pointers are rehashed into a table of twice the size, which is then
+/// published atomically; old tables are only reclaimed when the map is
+/// destroyed, since a reader may still be probing them. Entries themselves
+/// never move.
+///
+/// In addition to what ConcurrentMap requires, the entry type must provide:
+///
+///   /// Hash a key. Keys that compare equal must have equal hashes, and the
+///   /// low bits of the hash should be well distributed.
+///   static size_t getKeyHash(const KeyTy &key);
+template <class EntryTy>
+class ConcurrentHashMap {
+  struct Slot {
+    /// The hash of the entry's key. This is written before the entry is
+    /// published and never changes afterwards.
+    size_t Hash = 0;
+    std::atomic<EntryTy *> Entry{nullptr};
+  };
+
+  struct Table {
+    /// The previous, smaller table, kept alive for readers that loaded it
+    /// before we grew.
+    Table *Previous;
+    size_t Mask;
+    /// The number of entries in the table. Only accessed under the lock.
+    size_t Count;
+
+    Slot *slots() { return reinterpret_cast<Slot *>(this + 1); }
+
+    static Table *allocate(size_t capacity, Table *previous) {
+      void *memory = ::operator new(sizeof(Table) + capacity * sizeof(Slot));
+      auto table = reinterpret_cast<Table *>(memory);
+      table->Previous = previous;
+      table->Mask = capacity - 1;
+      table->Count = 0;
+      auto slots = table->slots();
+      for (size_t i = 0; i != capacity; ++i)
+        ::new (&slots[i]) Slot();
+      return table;
+    }
+  };
+
+  enum : size_t { InitialCapacity = 16 };
+
+  std::atomic<Table *> Entries;
+  StaticMutex WriterLock;
+
+  template <class KeyTy>
+  static EntryTy *findInTable(Table *table, const KeyTy &key, size_t hash) {
+    auto slots = table->slots();
+    for (size_t i = hash & table->Mask; ; i = (i + 1) & table->Mask) {
+      auto entry = slots[i].Entry.load(std::memory_order_acquire);
+      if (!entry)
+        return nullptr;
+      if (slots[i].Hash == hash && entry->compareWithKey(key) == 0)
+        return entry;
+    }
+  }
+
+  /// Add an entry to a table that has room for it and doesn't contain it.
+  /// Must be called with the lock held.
+  static void insertInTable(Table *table, EntryTy *entry, size_t hash) {
+    auto slots = table->slots();
+    size_t i = hash & table->Mask;
+    while (slots[i].Entry.load(std::memory_order_relaxed))
+      i = (i + 1) & table->Mask;
+    slots[i].Hash = hash;
+    slots[i].Entry.store(entry, std::memory_order_release);
+    ++table->Count;
+  }
+
+  /// Make a table twice the size of the given one, holding the same
+  /// entries. Must be called with the lock held.
+  static Table *grow(Table *table) {
+    if (!table)
+      return Table::allocate(InitialCapacity, nullptr);
+
+    size_t capacity = table->Mask + 1;
+    auto newTable = Table::allocate(capacity * 2, table);
+    auto slots = table->slots();
+    for (size_t i = 0; i != capacity; ++i) {
+      if (auto entry = slots[i].Entry.load(std::memory_order_relaxed))
+        insertInTable(newTable, entry, slots[i].Hash);
+    }
+    return newTable;
+  }
+
+  static void destroyEntry(EntryTy *entry) {
+    entry->~EntryTy();
+    ::operator delete(entry);
+  }
+
+public:
+  constexpr ConcurrentHashMap() : Entries(nullptr) {}
+
+  ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+  ConcurrentHashMap &operator=(const ConcurrentHashMap &) = delete;
+
+  ~ConcurrentHashMap() {
+    // This can use relaxed memory order because the client has to ensure
+    // that all accesses are safely completed before destruction occurs.
+    auto table = Entries.load(std::memory_order_relaxed);
+    if (!table)
+      return;
+
+    auto slots = table->slots();
+    for (size_t i = 0, e = table->Mask + 1; i != e; ++i) {
+      if (auto entry = slots[i].Entry.load(std::memory_order_relaxed))
+        destroyEntry(entry);
+    }
+    while (table) {
+      auto previous = table->Previous;
+      ::operator delete(table);
+      table = previous;
+    }
+  }
+
+  /// Search for a value by key \p Key.
+  /// \returns a pointer to the value or null if the value is not in the map.
+  template <class KeyTy>
+  EntryTy *find(const KeyTy &key) {
+    auto table = Entries.load(std::memory_order_acquire);
+    if (!table)
+      return nullptr;
+    return findInTable(table, key, EntryTy::getKeyHash(key));
+  }
+
+  /// Get or create an entry in the map.
+  ///
+  /// \returns the entry in the map and whether a new entry was added (true)
+  ///   or already existed (false)
+  template <class KeyTy, class... ArgTys>
+  std::pair<EntryTy*, bool> getOrInsert(KeyTy key, ArgTys &&... args) {
+    size_t hash = EntryTy::getKeyHash(key);
+    if (auto table = Entries.load(std::memory_order_acquire)) {
+      if (auto entry = findInTable(table, key, hash))
+        return { entry, false };
+    }
+
+    // Construct the new entry before taking the lock.
+    size_t allocSize =
+      sizeof(EntryTy) + EntryTy::getExtraAllocationSize(key, args...);
+    void *memory = ::operator new(allocSize);
+    auto newEntry = ::new (memory) EntryTy(key, std::forward<ArgTys>(args)...);
+
+    StaticScopedLock guard(WriterLock);
+
+    // Another thread may have inserted the key while we weren't holding
+    // the lock.
+    auto table = Entries.load(std::memory_order_relaxed);
+    if (table) {
+      if (auto entry = findInTable(table, key, hash)) {
+        destroyEntry(newEntry);
+        return { entry, false };
+      }
+    }
+
+    // Keep the table at most three-quarters full so probe sequences stay
+    // short and always terminate.
+    if (!table || (table->Count + 1) * 4 > (table->Mask + 1) * 3) {
+      table = grow(table);
+      Entries.store(table, std::memory_order_release);
+    }
+
+    insertInTable(table, newEntry, hash);
+    return { newEntry, true };
+  }
+};
+
+/// An append-only array that supports lock-free reads concurrently with
+/// appends.
+///
+/// Readers take a snapshot, which is a stable prefix of the array that
+/// remains valid for the lifetime of the array. Appends must be serialized
+/// by the client. When the array needs to grow, the elements are copied into
+/// a new storage block which is then published atomically; old storage
+/// blocks are only reclaimed when the array is destroyed, since a reader may
+/// still be iterating over them.
+///
+/// The element type must be trivially copyable.
+template <class ElemTy> class ConcurrentReadableArray {
+  struct Storage {
+    /// The previous, smaller storage block, kept alive for readers that
+    /// took a snapshot before we grew.
+    Storage *Previous;
+    size_t Capacity;
+    std::atomic<size_t> Count;
+
+    ElemTy *data() { return reinterpret_cast<ElemTy *>(this + 1); }
+
+    static Storage *allocate(size_t capacity, Storage *previous) {
+      void *memory = ::operator new(sizeof(Storage) +
+                                    capacity * sizeof(ElemTy));
+      auto storage = reinterpret_cast<Storage *>(memory);
+      storage->Previous = previous;
+      storage->Capacity = capacity;
+      new (&storage->Count) std::atomic<size_t>(0);
+      return storage;
+    }
+  };
+
+  std::atomic<Storage *> Elements;
+
+public:
+  /// A stable view of the elements that were in the array when the
+  /// snapshot was taken.
+  class Snapshot {
+    const ElemTy *Start;
+    size_t Count;
+
+  public:
+    Snapshot(const ElemTy *start, size_t count) : Start(start), Count(count) {}
+
+    const ElemTy *begin() const { return Start; }
+    const ElemTy *end() const { return Start + Count; }
+    size_t size() const { return Count; }
+    const ElemTy &operator[](size_t i) const {
+      assert(i < Count && "index out of range");
+      return Start[i];
+    }
+  };
+
+  constexpr ConcurrentReadableArray() : Elements(nullptr) {}
+
+  ConcurrentReadableArray(const ConcurrentReadableArray &) = delete;
+  ConcurrentReadableArray &operator=(const ConcurrentReadableArray &) = delete;
+
+  ~ConcurrentReadableArray() {
+    // This can use relaxed memory order because the client has to ensure
+    // that all accesses are safely completed before destruction occurs.
+    auto storage = Elements.load(std::memory_order_relaxed);
+    while (storage) {
+      auto previous = storage->Previous;
+      ::operator delete(storage);
+      storage = previous;
+    }
+  }
+
+  /// Returns the number of elements currently published.
+  size_t size() const {
+    auto storage = Elements.load(std::memory_order_acquire);
+    return storage ? storage->Count.load(std::memory_order_acquire) : 0;
+  }
+
+  /// Take a snapshot of the currently published elements.
+  Snapshot snapshot() const {
+    auto storage = Elements.load(std::memory_order_acquire);
+    if (!storage)
+      return Snapshot(nullptr, 0);
+    auto count = storage->Count.load(std::memory_order_acquire);
+    return Snapshot(storage->data(), count);
+  }
+
+  /// Append an element. Calls to push_back must be serialized by the client.
+  void push_back(const ElemTy &elem) {
+    auto storage = Elements.load(std::memory_order_relaxed);
+    size_t count =
+      storage ? storage->Count.load(std::memory_order_relaxed) : 0;
+
+    if (!storage || count >= storage->Capacity) {
+      size_t newCapacity = storage ? storage->Capacity * 2 : 16;
+      auto newStorage = Storage::allocate(newCapacity, storage);
+      if (storage)
+        memcpy(newStorage->data(), storage->data(), count * sizeof(ElemTy));
+      newStorage->Count.store(count, std::memory_order_relaxed);
+      Elements.store(newStorage, std::memory_order_release);
+      storage = newStorage;
+    }
+
+    new (&storage->data()[count]) ElemTy(elem);
+    storage->Count.store(count + 1, std::memory_order_release);
+  }
+};
+
 } // end namespace swift
 
 #endif // SWIFT_RUNTIME_CONCURRENTUTILS_H
@@ -72,6 +72,19 @@
 #error Masking ISAs are incompatible with opaque ISAs
 #endif
 
+/// Can swift_slowAlloc use the thread-caching small-object allocator?  It
+/// needs a large reserved address range and pthread thread-specific data, so
+/// it is only available on 64-bit POSIX platforms.  Even where available, it
+/// is only used when selected at startup.
+#ifndef SWIFT_THREAD_CACHE_ALLOCATOR_AVAILABLE
+#if defined(__LP64__) && \
+    (defined(__APPLE__) || defined(__linux__) || defined(__FreeBSD__))
+#define SWIFT_THREAD_CACHE_ALLOCATOR_AVAILABLE 1
+#else
+#define SWIFT_THREAD_CACHE_ALLOCATOR_AVAILABLE 0
+#endif
+#endif
+
 // We try to avoid global constructors in the runtime as much as possible.
 // These macros delimit allowed global ctors.
 #if __clang__
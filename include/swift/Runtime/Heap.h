@@ -18,5 +18,24 @@
 #define SWIFT_RUNTIME_HEAP_H
 
 #include <llvm/Support/Compiler.h>
+#include <stddef.h>
+
+#include "swift/Runtime/Config.h"
+
+namespace swift {
+
+/// If \p ptr was allocated by swift_slowAlloc from the runtime's small-object
+/// allocator, return the number of usable bytes in the block. Otherwise,
+/// return 0; the block came from malloc.
+size_t _swift_slowAllocGetUsableSize(const void *ptr);
+
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+/// Return the distance from the start of the allocation of the heap object
+/// \p object to the object itself, or 0 if the object is not preceded by a
+/// biased reference count.
+size_t _swift_getHeapObjectAllocationOffset(const void *object);
+#endif
+
+} // end namespace swift
 
 #endif /* SWIFT_RUNTIME_HEAP_H */
@@ -351,6 +351,20 @@ SWIFT_RUNTIME_EXPORT
 extern "C" void (*SWIFT_CC(RegisterPreservingCC)
                      _swift_nonatomic_release_n)(HeapObject *object, uint32_t n);
 
+/// Make \p object immortal. Retains and releases of an immortal object
+/// return without touching its reference count, and it is never
+/// deallocated. This is meant for objects that live for the rest of the
+/// process and are retained and released by many threads.
+///
+/// The caller must hold a strong reference to \p object, and \p object
+/// must not be pinned.
+SWIFT_RUNTIME_EXPORT
+extern "C" void swift_setImmortal(HeapObject *object);
+
+/// Is \p object immortal?
+SWIFT_RUNTIME_EXPORT
+extern "C" bool swift_isImmortal(HeapObject *object);
+
 // Refcounting observation hooks for memory tools. Don't use these.
 SWIFT_RUNTIME_EXPORT
 extern "C" size_t swift_retainCount(HeapObject *object);
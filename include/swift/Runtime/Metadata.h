@@ -3453,6 +3453,13 @@ extern "C"
 void swift_registerTypeMetadataRecords(const TypeMetadataRecord *begin,
                                        const TypeMetadataRecord *end);
 
+/// Print the statistics collected for the runtime's metadata caches to
+/// stderr. Statistics are only collected if
+/// SWIFT_DEBUG_METADATA_CACHE_STATISTICS is set in the environment.
+SWIFT_RUNTIME_EXPORT
+extern "C"
+void swift_dumpMetadataCacheStatistics();
+
 /// Return the type name for a given type metadata.
 std::string nameForMetadata(const Metadata *type,
                             bool qualified = true);
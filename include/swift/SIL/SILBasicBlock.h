@@ -19,6 +19,7 @@
 
 #include "swift/Basic/Range.h"
 #include "swift/SIL/SILInstruction.h"
+#include "llvm/ADT/Optional.h"
 
 namespace swift {
 class SILFunction;
@@ -45,6 +46,10 @@ private:
   /// The ordered set of instructions in the SILBasicBlock.
   InstListType InstList;
 
+  /// The number of times this block was executed according to the profile
+  /// data passed with -profile-use, if there is any for it.
+  Optional<uint64_t> ProfileCount;
+
   friend struct llvm::ilist_sentinel_traits<SILBasicBlock>;
   friend struct llvm::ilist_traits<SILBasicBlock>;
   SILBasicBlock() : Parent(0) {}
@@ -73,6 +78,11 @@ public:
   /// Returns true if this BB is the entry BB of its parent.
   bool isEntry() const;
 
+  /// Returns the number of times this block was executed according to
+  /// profile data, or None if it has no profile count.
+  Optional<uint64_t> getProfileCount() const { return ProfileCount; }
+  void setProfileCount(uint64_t Count) { ProfileCount = Count; }
+
   //===--------------------------------------------------------------------===//
   // SILInstruction List Inspection and Manipulation
   //===--------------------------------------------------------------------===//
@@ -130,7 +140,8 @@ public:
   ///
   /// Note that all the instructions BEFORE the specified iterator
   /// stay as part of the original basic block. The old basic block is left
-  /// without a terminator.
+  /// without a terminator. The new basic block gets the old one's profile
+  /// count.
   SILBasicBlock *splitBasicBlock(iterator I);
 
   /// \brief Move the basic block to after the specified basic block in the IR.
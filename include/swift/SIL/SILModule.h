@@ -182,6 +182,10 @@ private:
   /// optimizations can assume that they see the whole module.
   bool wholeModule;
 
+  /// The largest function entry count in the profile data attached to this
+  /// module's basic blocks, or zero if there is no profile data.
+  uint64_t MaxProfileEntryCount = 0;
+
   /// The options passed into this SILModule.
   SILOptions &Options;
 
@@ -545,6 +549,16 @@ public:
     Stage = s;
   }
 
+  /// Returns the largest function entry count in the module's profile data,
+  /// which is what the hotness of other profile counts is relative to.
+  uint64_t getMaxProfileEntryCount() const { return MaxProfileEntryCount; }
+
+  /// Records that a function in the module was entered \p Count times
+  /// according to profile data.
+  void noteProfileEntryCount(uint64_t Count) {
+    MaxProfileEntryCount = std::max(MaxProfileEntryCount, Count);
+  }
+
   /// \brief Run the SIL verifier to make sure that all Functions follow
   /// invariants.
   void verify() const;
@@ -587,6 +601,9 @@ public:
   /// Allocate memory using the module's internal allocator.
   void *allocate(unsigned Size, unsigned Align) const;
 
+  /// Returns the number of bytes allocated with allocate() so far.
+  size_t getNumAllocatedBytes() const { return BPA.getBytesAllocated(); }
+
   /// Allocate memory for an instruction using the module's internal allocator.
   void *allocateInst(unsigned Size, unsigned Align) const;
 
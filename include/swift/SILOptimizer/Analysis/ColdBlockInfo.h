@@ -22,6 +22,9 @@ class SILBasicBlock;
 
 /// Cache a set of basic blocks that have been determined to be cold or hot.
 ///
+/// A block is cold if it is dominated by a _slowPath branch hint, or if the
+/// profile data passed with -profile-use says that it was never executed.
+///
 /// This does not inherit from SILAnalysis because it is not worth preserving
 /// across passes.
 class ColdBlockInfo {
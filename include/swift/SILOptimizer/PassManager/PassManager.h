@@ -17,6 +17,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
 #include <vector>
 
 #ifndef SWIFT_SILOPTIMIZER_PASSMANAGER_PASSMANAGER_H
@@ -67,13 +68,28 @@ class SILPassManager {
   /// Number of optimization iterations run.
   unsigned NumOptimizationIterations = 0;
 
-  /// A mask which has one bit for each pass. A one for a pass-bit means that
-  /// the pass doesn't need to run, because nothing has changed since the
-  /// previous run of that pass.
-  typedef std::bitset<(size_t)PassKind::AllPasses_Last + 1> CompletedPasses;
-  
-  /// A completed-passes mask for each function.
-  llvm::DenseMap<SILFunction *, CompletedPasses> CompletedPassesMap;
+  /// A counter that is incremented whenever a function, or the whole module,
+  /// is changed. It orders the changes with respect to the runs of passes.
+  unsigned CurrentEpoch = 0;
+
+  /// The epoch of the last change to the whole module.
+  unsigned ModuleEpoch = 0;
+
+  /// The epoch of the last change to each function.
+  llvm::DenseMap<SILFunction *, unsigned> FunctionEpochs;
+
+  /// For each function and pass, the epoch at which rerunning the pass on the
+  /// function was known not to change anything. The pass doesn't need to run
+  /// again until the function's epoch changes.
+  llvm::DenseMap<std::pair<SILFunction *, unsigned>, unsigned> CompletedEpochs;
+
+  /// Returns the epoch of the last change to \p F.
+  unsigned getModificationEpoch(SILFunction *F) const {
+    return std::max(ModuleEpoch, FunctionEpochs.lookup(F));
+  }
+
+  /// Records that \p F has changed.
+  void markModified(SILFunction *F) { FunctionEpochs[F] = ++CurrentEpoch; }
 
   /// Stores for each function the number of levels of specializations it is
   /// derived from an original function. E.g. if a function is a signature
@@ -85,6 +101,9 @@ class SILPassManager {
   /// Set to true when a pass invalidates an analysis.
   bool CurrentPassHasInvalidated = false;
 
+  /// The number of times the current pass has invalidated analyses.
+  unsigned NumCurrentPassInvalidations = 0;
+
   /// True if we need to stop running passes and restart again on the
   /// same function.
   bool RestartPipeline = false;
@@ -132,9 +151,10 @@ public:
         AP->invalidate(K);
 
     CurrentPassHasInvalidated = true;
+    ++NumCurrentPassInvalidations;
 
-    // Assume that all functions have changed. Clear all masks of all functions.
-    CompletedPassesMap.clear();
+    // Assume that all functions have changed.
+    ModuleEpoch = ++CurrentEpoch;
   }
 
   /// \brief Add the function \p F to the function pass worklist.
@@ -150,6 +170,10 @@ public:
   void notifyAnalysisOfFunction(SILFunction *F) {
     for (auto AP : Analysis)
       AP->notifyAnalysisOfFunction(F);
+
+    // The function may reuse the memory of a deleted one. Don't let it
+    // inherit what was known about that one.
+    markModified(F);
   }
 
   /// \brief Broadcast the invalidation of the function to all analysis.
@@ -161,8 +185,9 @@ public:
         AP->invalidate(F, K);
     
     CurrentPassHasInvalidated = true;
+    ++NumCurrentPassInvalidations;
     // Any change let all passes run again.
-    CompletedPassesMap[F].reset();
+    markModified(F);
   }
 
   /// \brief Broadcast the invalidation of the function to all analysis.
@@ -176,8 +201,9 @@ public:
         AP->invalidateForDeadFunction(F, K);
     
     CurrentPassHasInvalidated = true;
+    ++NumCurrentPassInvalidations;
     // Any change let all passes run again.
-    CompletedPassesMap[F].reset();
+    markModified(F);
   }
 
   /// \brief Reset the state of the pass manager and remove all transformation
@@ -94,6 +94,15 @@ namespace swift {
       return S->getKind() == TransformKind::Function;
     }
 
+    /// Returns true if running the pass on a function it has just run on
+    /// never changes anything.
+    ///
+    /// The pass manager doesn't rerun a pass on a function that hasn't
+    /// changed since the pass last ran on it without changing it. If the pass
+    /// is idempotent, it also isn't rerun if it was the pass that made the
+    /// last change.
+    virtual bool isIdempotent() { return false; }
+
     void injectFunction(SILFunction *Func) { F = Func; }
 
     /// \brief Notify the pass manager of a function \p F that needs to be
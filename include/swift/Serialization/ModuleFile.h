@@ -27,6 +27,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/MemoryBuffer.h"
 
 namespace llvm {
@@ -236,21 +237,74 @@ public:
     }
   };
 
+  /// An array of entries indexed by ID, created from the bit offsets
+  /// stored in the index block.
+  ///
+  /// The offsets are kept as a reference into the module's buffer until one
+  /// of the entries is first accessed, so that modules which are imported
+  /// but barely used don't pay for decoding their tables.
+  template <typename T>
+  class LazyOffsetArray {
+    /// Little-endian uint32_t bit offsets, one per entry.
+    StringRef RawOffsets;
+    std::vector<T> Entries;
+
+    void load() {
+      Entries.reserve(size());
+      for (const char *next = RawOffsets.begin(), *end = RawOffsets.end();
+           next != end; next += sizeof(uint32_t)) {
+        Entries.emplace_back(llvm::support::endian::read32le(next));
+      }
+    }
+
+  public:
+    /// Sets the offsets to create entries from.
+    ///
+    /// \returns false if \p rawOffsets is not a whole number of offsets.
+    bool setRawOffsets(StringRef rawOffsets) {
+      assert(Entries.empty() && "entries already loaded");
+      if (rawOffsets.size() % sizeof(uint32_t) != 0)
+        return false;
+      RawOffsets = rawOffsets;
+      return true;
+    }
+
+    size_t size() const {
+      return RawOffsets.size() / sizeof(uint32_t);
+    }
+
+    T &operator[](size_t index) {
+      if (Entries.empty())
+        load();
+      assert(index < Entries.size());
+      return Entries[index];
+    }
+
+    /// Iterates over the entries that have been loaded, which is either all
+    /// of them or none.
+    typename std::vector<T>::const_iterator begin() const {
+      return Entries.begin();
+    }
+    typename std::vector<T>::const_iterator end() const {
+      return Entries.end();
+    }
+  };
+
 private:
   /// Decls referenced by this module.
-  std::vector<Serialized<Decl*>> Decls;
+  LazyOffsetArray<Serialized<Decl*>> Decls;
 
   /// DeclContexts referenced by this module.
-  std::vector<Serialized<DeclContext*>> DeclContexts;
+  LazyOffsetArray<Serialized<DeclContext*>> DeclContexts;
 
   /// Local DeclContexts referenced by this module.
-  std::vector<Serialized<DeclContext*>> LocalDeclContexts;
+  LazyOffsetArray<Serialized<DeclContext*>> LocalDeclContexts;
 
   /// Normal protocol conformances referenced by this module.
-  std::vector<Serialized<NormalProtocolConformance *>> NormalConformances;
+  LazyOffsetArray<Serialized<NormalProtocolConformance *>> NormalConformances;
 
   /// Types referenced by this module.
-  std::vector<Serialized<Type>> Types;
+  LazyOffsetArray<Serialized<Type>> Types;
 
   /// Represents an identifier that may or may not have been deserialized yet.
   ///
@@ -268,12 +322,16 @@ private:
   };
 
   /// Identifiers referenced by this module.
-  std::vector<SerializedIdentifier> Identifiers;
+  LazyOffsetArray<SerializedIdentifier> Identifiers;
 
   class DeclTableInfo;
   using SerializedDeclTable =
       llvm::OnDiskIterableChainedHashTable<DeclTableInfo>;
 
+  class DeclStringTableInfo;
+  using SerializedDeclStringTable =
+      llvm::OnDiskIterableChainedHashTable<DeclStringTableInfo>;
+
   class LocalDeclTableInfo;
   using SerializedLocalDeclTable =
       llvm::OnDiskIterableChainedHashTable<LocalDeclTableInfo>;
@@ -281,8 +339,9 @@ private:
   std::unique_ptr<SerializedDeclTable> TopLevelDecls;
   std::unique_ptr<SerializedDeclTable> OperatorDecls;
   std::unique_ptr<SerializedDeclTable> PrecedenceGroupDecls;
-  std::unique_ptr<SerializedDeclTable> ExtensionDecls;
+  std::unique_ptr<SerializedDeclStringTable> ExtensionDecls;
   std::unique_ptr<SerializedDeclTable> ClassMembersByName;
+  std::unique_ptr<SerializedDeclStringTable> ClassMembersByTypeAndName;
   std::unique_ptr<SerializedDeclTable> OperatorMethodDecls;
   std::unique_ptr<SerializedLocalDeclTable> LocalTypeDecls;
 
@@ -390,6 +449,11 @@ private:
   std::unique_ptr<SerializedDeclTable>
   readDeclTable(ArrayRef<uint64_t> fields, StringRef blobData);
 
+  /// Read an on-disk decl hash table with string keys stored in
+  /// index_block::DeclListLayout format.
+  std::unique_ptr<SerializedDeclStringTable>
+  readDeclStringTable(ArrayRef<uint64_t> fields, StringRef blobData);
+
   /// Read an on-disk local decl hash table stored in
   /// index_block::DeclListLayout format.
   std::unique_ptr<SerializedLocalDeclTable>
@@ -573,8 +637,12 @@ public:
 
   /// Loads extensions for the given decl.
   ///
+  /// \p extensionTableKey must be serialization::getExtensionTableKey of
+  /// \p nominal; it is passed in so that it can be computed once for all the
+  /// modules that are searched.
+  ///
   /// Note that this may cause other decls to load as well.
-  void loadExtensions(NominalTypeDecl *nominal);
+  void loadExtensions(NominalTypeDecl *nominal, StringRef extensionTableKey);
 
   /// \brief Load the methods within the given class that produce
   /// Objective-C class or instance methods with the given selector.
@@ -20,6 +20,7 @@
 #define SWIFT_SERIALIZATION_MODULEFORMAT_H
 
 #include "swift/AST/Decl.h"
+#include "swift/AST/Mangle.h"
 #include "llvm/Bitcode/RecordLayout.h"
 #include "llvm/Bitcode/BitCodes.h"
 #include "llvm/ADT/PointerEmbeddedInt.h"
@@ -53,7 +54,7 @@ const uint16_t VERSION_MAJOR = 0;
 /// in source control, you should also update the comment to briefly
 /// describe what change you made. The content of this comment isn't important;
 /// it just ensures a conflict if two people change the module format.
-const uint16_t VERSION_MINOR = 264; // Last change: remove AllArchetypes
+const uint16_t VERSION_MINOR = 266; // Last change: extension/member tables
 
 using DeclID = PointerEmbeddedInt<unsigned, 31>;
 using DeclIDField = BCFixed<31>;
@@ -1426,6 +1427,28 @@ static inline decls_block::RecordKind getKindForTable(const Decl *D) {
   }
 }
 
+/// Returns the key that extensions of \p nominal are listed under in the
+/// EXTENSIONS table.
+///
+/// This is the mangled name of \p nominal, so that looking up the extensions
+/// of one type doesn't find those of every other type with the same name.
+static inline std::string getExtensionTableKey(const NominalTypeDecl *nominal) {
+  Mangle::Mangler mangler;
+  mangler.mangleContext(nominal);
+  return mangler.finalize();
+}
+
+/// Returns the key that the members named \p memberName of the top-level
+/// type \p typeName, or of the types nested within it, are listed under in
+/// the CLASS_MEMBERS_BY_TYPE table.
+static inline std::string getClassMemberTableKey(StringRef typeName,
+                                                 StringRef memberName) {
+  std::string key = typeName.str();
+  key += '\0';
+  key += memberName;
+  return key;
+}
+
 /// The record types within the identifier block.
 ///
 /// \sa IDENTIFIER_BLOCK_ID
@@ -1449,7 +1472,12 @@ namespace index_block {
     IDENTIFIER_OFFSETS,
     TOP_LEVEL_DECLS,
     OPERATORS,
+
+    /// The extensions in the module, listed by the type they extend.
+    ///
+    /// \sa getExtensionTableKey
     EXTENSIONS,
+
     CLASS_MEMBERS,
     OPERATOR_METHODS,
 
@@ -1465,11 +1493,17 @@ namespace index_block {
     NORMAL_CONFORMANCE_OFFSETS,
 
     PRECEDENCE_GROUPS,
+
+    /// The class members that CLASS_MEMBERS lists by name, listed by the
+    /// name of the top-level type they belong to and their own name.
+    ///
+    /// \sa getClassMemberTableKey
+    CLASS_MEMBERS_BY_TYPE,
   };
 
   using OffsetsLayout = BCGenericRecordLayout<
     BCFixed<4>,  // record ID
-    BCArray<BitOffsetField>
+    BCBlob  // array of little-endian uint32_t bit offsets
   >;
 
   using DeclListLayout = BCGenericRecordLayout<
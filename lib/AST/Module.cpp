@@ -538,6 +538,25 @@ void Module::getTopLevelDecls(SmallVectorImpl<Decl*> &Results) const {
   FORWARD(getTopLevelDecls, (Results));
 }
 
+void SourceFile::endDeclFingerprint(ArrayRef<const Decl *> decls) {
+  assert(!DeclInterfaceHashes.empty() && "no declaration being hashed");
+  llvm::MD5::MD5Result result;
+  DeclInterfaceHashes.back().final(result);
+  DeclInterfaceHashes.pop_back();
+
+  llvm::SmallString<32> str;
+  llvm::MD5::stringifyResult(result, str);
+  bool isOutermost = DeclInterfaceHashes.empty();
+  for (auto D : decls) {
+    auto &fingerprint = DeclFingerprints[D];
+    fingerprint.Hash = str.str();
+    if (isOutermost)
+      fingerprint.ReferencedNames = DeclReferencedNames;
+  }
+  if (isOutermost)
+    DeclReferencedNames.clear();
+}
+
 void SourceFile::getTopLevelDecls(SmallVectorImpl<Decl*> &Results) const {
   Results.append(Decls.begin(), Decls.end());
 }
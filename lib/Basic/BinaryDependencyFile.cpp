@@ -0,0 +1,211 @@
+//===--- BinaryDependencyFile.cpp - Binary .swiftdeps format --------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/BinaryDependencyFile.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace swift;
+using namespace llvm::support;
+
+static const char Signature[] = { '\xE2', 'S', 'D', 'B' };
+
+namespace {
+enum : uint32_t {
+  KindMask = 0xFF,
+  ProvidesBit = 1 << 8,
+  CascadingBit = 1 << 9,
+};
+
+/// The sizes in bytes of the header, of each string or record entry, and of
+/// each fingerprint entry.
+enum : size_t {
+  HeaderSize = 6 * sizeof(uint32_t),
+  EntrySize = 2 * sizeof(uint32_t),
+  FingerprintEntrySize = 3 * sizeof(uint32_t),
+};
+} // end anonymous namespace
+
+static uint32_t readWord(const char *ptr, size_t index) {
+  return endian::read32le(ptr + index * sizeof(uint32_t));
+}
+
+bool BinaryDependencyFile::hasSignature(StringRef data) {
+  return data.startswith(StringRef(Signature, sizeof(Signature)));
+}
+
+bool BinaryDependencyFile::read(StringRef data, BinaryDependencyFile &result) {
+  if (!hasSignature(data) || data.size() < HeaderSize)
+    return false;
+
+  const char *header = data.data();
+  if (readWord(header, 1) != Version)
+    return false;
+
+  uint64_t numStrings = readWord(header, 2);
+  uint64_t numRecords = readWord(header, 3);
+  uint64_t numFingerprints = readWord(header, 4);
+  uint32_t interfaceHash = readWord(header, 5);
+
+  // Use 64-bit arithmetic so that a corrupt header can't wrap around.
+  uint64_t stringDataOffset =
+    HeaderSize + (numStrings + numRecords) * EntrySize +
+    numFingerprints * FingerprintEntrySize;
+  if (stringDataOffset > data.size())
+    return false;
+  StringRef stringData = data.substr(stringDataOffset);
+
+  const char *stringEntries = header + HeaderSize;
+  for (uint64_t i = 0; i != numStrings; ++i) {
+    uint64_t offset = readWord(stringEntries, 2 * i);
+    uint64_t length = readWord(stringEntries, 2 * i + 1);
+    if (offset + length > stringData.size())
+      return false;
+  }
+
+  const char *records = stringEntries + numStrings * EntrySize;
+  for (uint64_t i = 0; i != numRecords; ++i) {
+    uint32_t name = readWord(records, 2 * i);
+    uint32_t flags = readWord(records, 2 * i + 1);
+    if (name >= numStrings)
+      return false;
+    if ((flags & KindMask) > uint32_t(Kind::Last_Kind))
+      return false;
+    if (flags & ~(KindMask | ProvidesBit | CascadingBit))
+      return false;
+    if ((flags & ProvidesBit) && !(flags & CascadingBit))
+      return false;
+  }
+
+  const char *fingerprints = records + numRecords * EntrySize;
+  for (uint64_t i = 0; i != numFingerprints; ++i) {
+    uint32_t name = readWord(fingerprints, 3 * i);
+    uint32_t kind = readWord(fingerprints, 3 * i + 1);
+    uint32_t value = readWord(fingerprints, 3 * i + 2);
+    if (name >= numStrings || value >= numStrings)
+      return false;
+    if (kind >= uint32_t(Kind::DynamicLookup))
+      return false;
+  }
+
+  if (interfaceHash != NoString && interfaceHash >= numStrings)
+    return false;
+
+  result.StringEntries = stringEntries;
+  result.Records = records;
+  result.Fingerprints = fingerprints;
+  result.StringData = stringData;
+  result.NumStrings = numStrings;
+  result.NumRecords = numRecords;
+  result.NumFingerprints = numFingerprints;
+  result.InterfaceHash = interfaceHash;
+  return true;
+}
+
+StringRef BinaryDependencyFile::getString(uint32_t index) const {
+  assert(index < NumStrings && "string index out of range");
+  return StringData.substr(readWord(StringEntries, 2 * index),
+                           readWord(StringEntries, 2 * index + 1));
+}
+
+BinaryDependencyFile::Record
+BinaryDependencyFile::getRecord(unsigned index) const {
+  assert(index < NumRecords && "record index out of range");
+  uint32_t flags = readWord(Records, 2 * index + 1);
+  return { getString(readWord(Records, 2 * index)), Kind(flags & KindMask),
+           bool(flags & ProvidesBit), bool(flags & CascadingBit) };
+}
+
+BinaryDependencyFile::Fingerprint
+BinaryDependencyFile::getFingerprint(unsigned index) const {
+  assert(index < NumFingerprints && "fingerprint index out of range");
+  return { getString(readWord(Fingerprints, 3 * index)),
+           Kind(readWord(Fingerprints, 3 * index + 1)),
+           getString(readWord(Fingerprints, 3 * index + 2)) };
+}
+
+uint32_t BinaryDependencyFileWriter::intern(StringRef name) {
+  auto insertResult =
+    StringIndices.insert(std::make_pair(name, uint32_t(Strings.size())));
+  if (insertResult.second)
+    Strings.push_back(insertResult.first->getKey());
+  return insertResult.first->getValue();
+}
+
+void BinaryDependencyFileWriter::addRecord(StringRef name, Kind kind,
+                                           bool isProvides,
+                                           bool isCascading) {
+  uint32_t flags = uint32_t(kind);
+  if (isProvides)
+    flags |= ProvidesBit;
+  if (isCascading)
+    flags |= CascadingBit;
+  Records.push_back({intern(name), flags});
+}
+
+static void getMemberKey(StringRef baseName, StringRef memberName,
+                         SmallVectorImpl<char> &key) {
+  key.append(baseName.begin(), baseName.end());
+  key.push_back('\0');
+  key.append(memberName.begin(), memberName.end());
+}
+
+void BinaryDependencyFileWriter::addMember(StringRef baseName,
+                                           StringRef memberName,
+                                           bool isProvides,
+                                           bool isCascading) {
+  SmallString<64> key;
+  getMemberKey(baseName, memberName, key);
+  addRecord(key, Kind::Member, isProvides, isCascading);
+}
+
+void BinaryDependencyFileWriter::addMemberFingerprint(StringRef baseName,
+                                                      StringRef memberName,
+                                                      StringRef fingerprint) {
+  SmallString<64> key;
+  getMemberKey(baseName, memberName, key);
+  addFingerprint(Kind::Member, key, fingerprint);
+}
+
+void BinaryDependencyFileWriter::write(raw_ostream &out) const {
+  endian::Writer<little> writer(out);
+
+  out.write(Signature, sizeof(Signature));
+  writer.write<uint32_t>(BinaryDependencyFile::Version);
+  writer.write<uint32_t>(Strings.size());
+  writer.write<uint32_t>(Records.size());
+  writer.write<uint32_t>(Fingerprints.size());
+  writer.write<uint32_t>(InterfaceHash);
+
+  uint32_t offset = 0;
+  for (StringRef string : Strings) {
+    writer.write<uint32_t>(offset);
+    writer.write<uint32_t>(string.size());
+    offset += string.size();
+  }
+
+  for (auto &record : Records) {
+    writer.write<uint32_t>(record.first);
+    writer.write<uint32_t>(record.second);
+  }
+
+  for (auto &fingerprint : Fingerprints) {
+    writer.write<uint32_t>(std::get<0>(fingerprint));
+    writer.write<uint32_t>(uint32_t(std::get<1>(fingerprint)));
+    writer.write<uint32_t>(std::get<2>(fingerprint));
+  }
+
+  for (StringRef string : Strings)
+    out << string;
+}
@@ -42,8 +42,10 @@ DummyTaskQueue::DummyTaskQueue(unsigned NumberOfParallelTasks)
 DummyTaskQueue::~DummyTaskQueue() = default;
 
 void DummyTaskQueue::addTask(const char *ExecPath, ArrayRef<const char *> Args,
-                             ArrayRef<const char *> Env, void *Context) {
+                             ArrayRef<const char *> Env, void *Context,
+                             unsigned Priority) {
   QueuedTasks.emplace(
+    Priority,
     std::unique_ptr<DummyTask>(new DummyTask(ExecPath, Args, Env, Context)));
 }
 
@@ -65,8 +67,8 @@ bool DummyTaskQueue::execute(TaskQueue::TaskBeganCallback Began,
     // at the parallel limit, and no earlier subtasks have failed.
     while (!SubtaskFailed && !QueuedTasks.empty() &&
            ExecutingTasks.size() < MaxNumberOfParallelTasks) {
-      std::unique_ptr<DummyTask> T(QueuedTasks.front().release());
-      QueuedTasks.pop();
+      std::unique_ptr<DummyTask> T(std::move(QueuedTasks.begin()->second));
+      QueuedTasks.erase(QueuedTasks.begin());
 
       if (Began)
         Began(++Pid, T->Context);
@@ -16,14 +16,17 @@
 #include "swift/AST/DiagnosticsDriver.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/Program.h"
+#include "swift/Basic/Range.h"
 #include "swift/Basic/TaskQueue.h"
 #include "swift/Basic/Version.h"
 #include "swift/Basic/type_traits.h"
 #include "swift/Driver/Action.h"
+#include "swift/Driver/DependencyCache.h"
 #include "swift/Driver/DependencyGraph.h"
 #include "swift/Driver/Driver.h"
 #include "swift/Driver/Job.h"
 #include "swift/Driver/ParseableOutput.h"
+#include "swift/Driver/ToolChain.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringExtras.h"
@@ -31,6 +34,7 @@
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Timer.h"
@@ -86,11 +90,26 @@ namespace {
     ///
     /// Only intended for source files.
     llvm::SmallDenseMap<const Job *, bool, 16> UnfinishedCommands;
+
+    /// When each job that ran began and finished execution. The jobs in a
+    /// batch share the batch's times.
+    llvm::SmallDenseMap<const Job *,
+                        std::pair<llvm::sys::TimeValue, llvm::sys::TimeValue>,
+                        16> ExecutionTimes;
+
+    /// How long each job that ran successfully took. The jobs in a batch
+    /// split the batch's time evenly.
+    llvm::SmallDenseMap<const Job *, llvm::sys::TimeValue, 16> Durations;
   };
 }
 
 Compilation::~Compilation() = default;
 
+void Compilation::enableBatchMode(const ToolChain &TC, const OutputInfo &OI) {
+  BatchModeToolChain = &TC;
+  BatchModeOutputInfo.reset(new OutputInfo(OI));
+}
+
 Job *Compilation::addJob(std::unique_ptr<Job> J) {
   Job *result = J.get();
   Jobs.emplace_back(std::move(J));
@@ -111,12 +130,23 @@ using InputInfoMap =
 
 static void populateInputInfoMap(InputInfoMap &inputs,
                                  const PerformJobsState &endState) {
+  // Jobs that didn't run this time keep the duration of the last build.
+  auto getDuration = [&endState](const Job *cmd) -> llvm::sys::TimeValue {
+    auto found = endState.Durations.find(cmd);
+    if (found != endState.Durations.end())
+      return found->second;
+    if (auto *compileAction = dyn_cast<CompileJobAction>(&cmd->getSource()))
+      return compileAction->getInputInfo().previousDuration;
+    return llvm::sys::TimeValue();
+  };
+
   for (auto &entry : endState.UnfinishedCommands) {
     for (auto *action : entry.first->getSource().getInputs()) {
       auto inputFile = cast<InputAction>(action);
 
       CompileJobAction::InputInfo info;
       info.previousModTime = entry.first->getInputModTime();
+      info.previousDuration = getDuration(entry.first);
       info.status = entry.second ?
           CompileJobAction::InputInfo::NeedsCascadingBuild :
           CompileJobAction::InputInfo::NeedsNonCascadingBuild;
@@ -134,6 +164,7 @@ static void populateInputInfoMap(InputInfoMap &inputs,
 
       CompileJobAction::InputInfo info;
       info.previousModTime = entry->getInputModTime();
+      info.previousDuration = getDuration(entry);
       info.status = CompileJobAction::InputInfo::UpToDate;
       inputs[&inputFile->getInputArg()] = info;
     }
@@ -216,6 +247,22 @@ static void writeCompilationRecord(StringRef path, StringRef argsHash,
     writeTimeValue(out, entry.second.previousModTime);
     out << "\n";
   }
+
+  // Record how long each input took to compile, so that the next build can
+  // start the slowest ones first. An empty mapping would be read as null, so
+  // leave the key out if there is nothing to record.
+  bool wroteDurationsKey = false;
+  for (auto &entry : inputs) {
+    if (entry.second.previousDuration == llvm::sys::TimeValue())
+      continue;
+    if (!wroteDurationsKey) {
+      out << "job_durations:\n";
+      wroteDurationsKey = true;
+    }
+    out << "  \"" << llvm::yaml::escape(entry.first->getValue()) << "\": ";
+    writeTimeValue(out, entry.second.previousDuration);
+    out << "\n";
+  }
 }
 
 static bool writeFilelistIfNecessary(const Job *job, DiagnosticEngine &diags) {
@@ -255,21 +302,169 @@ static bool writeFilelistIfNecessary(const Job *job, DiagnosticEngine &diags) {
   return true;
 }
 
+static const Arg &getPrimaryInputArg(const Job *compileJob) {
+  auto *input = cast<InputAction>(compileJob->getSource().getInputs().front());
+  return input->getInputArg();
+}
+
+/// Returns true if \p Cmd can be performed as part of a batch.
+static bool isBatchable(const Job *Cmd) {
+  return isa<CompileJobAction>(Cmd->getSource()) &&
+         Cmd->getSource().getInputs().size() == 1 &&
+         Cmd->getInputs().empty() &&
+         Cmd->getExtraEnvironment().empty();
+}
+
+/// Returns the priority with which each of \p C's jobs should be run: the
+/// expected duration, in milliseconds, of the longest chain of jobs that
+/// begins with it, where each job is an input of the next.
+///
+/// Compile jobs are expected to take as long as they did in the last build.
+/// Those that weren't timed are expected to take the average time of those
+/// that were; every other job counts as one millisecond. Without any timings,
+/// the priority is just the number of jobs in the chain.
+///
+/// Starting the jobs at the head of long chains first keeps the jobs at the
+/// end of them, like merging modules and linking, from waiting on a single
+/// late input; starting the slowest compile jobs first keeps them from
+/// being left until the end of the build.
+static llvm::DenseMap<const Job *, unsigned>
+computeCriticalPathPriorities(const Compilation &C) {
+  auto Jobs = C.getJobs();
+
+  llvm::DenseMap<const Job *, unsigned> PreviousDurations;
+  uint64_t TotalPreviousDuration = 0;
+  for (const Job *Cmd : Jobs) {
+    auto *CompileAction = dyn_cast<CompileJobAction>(&Cmd->getSource());
+    if (!CompileAction)
+      continue;
+    uint64_t Duration = CompileAction->getInputInfo().previousDuration.msec();
+    if (Duration == 0)
+      continue;
+    PreviousDurations[Cmd] = Duration;
+    TotalPreviousDuration += Duration;
+  }
+  unsigned DefaultCompileDuration = 1;
+  if (!PreviousDurations.empty())
+    DefaultCompileDuration = std::max<uint64_t>(
+      TotalPreviousDuration / PreviousDurations.size(), 1);
+
+  auto getExpectedDuration = [&](const Job *Cmd) -> unsigned {
+    auto Found = PreviousDurations.find(Cmd);
+    if (Found != PreviousDurations.end())
+      return Found->second;
+    if (isa<CompileJobAction>(Cmd->getSource()))
+      return DefaultCompileDuration;
+    return 1;
+  };
+
+  llvm::DenseMap<const Job *, unsigned> Priorities;
+  // Jobs are added to the Compilation after their inputs, so visiting them
+  // in reverse finishes each job before any of its inputs.
+  for (size_t i = Jobs.size(); i != 0; --i) {
+    const Job *Cmd = Jobs[i - 1];
+    unsigned Priority = Priorities[Cmd] + getExpectedDuration(Cmd);
+    Priorities[Cmd] = Priority;
+    for (const Job *Input : Cmd->getInputs()) {
+      unsigned &InputPriority = Priorities[Input];
+      InputPriority = std::max(InputPriority, Priority);
+    }
+  }
+  return Priorities;
+}
+
+/// Prints the chain of jobs that determined how long the build took: the job
+/// that finished last, preceded by its input that finished last, and so on.
+static void printCriticalPath(raw_ostream &out,
+                              const PerformJobsState &endState) {
+  // Returns whichever of \p jobs finished last, or null if none of them ran.
+  auto findLastFinished = [&endState](ArrayRef<const Job *> jobs) {
+    const Job *last = nullptr;
+    llvm::sys::TimeValue lastEnd;
+    for (const Job *cmd : jobs) {
+      auto found = endState.ExecutionTimes.find(cmd);
+      if (found == endState.ExecutionTimes.end())
+        continue;
+      if (!last || found->second.second > lastEnd) {
+        last = cmd;
+        lastEnd = found->second.second;
+      }
+    }
+    return last;
+  };
+
+  SmallVector<const Job *, 16> ranCommands;
+  for (auto &entry : endState.ExecutionTimes)
+    ranCommands.push_back(entry.first);
+
+  SmallVector<const Job *, 8> path;
+  for (const Job *cmd = findLastFinished(ranCommands); cmd;
+       cmd = findLastFinished(cmd->getInputs()))
+    path.push_back(cmd);
+  if (path.empty())
+    return;
+
+  auto toSeconds = [](llvm::sys::TimeValue time) -> double {
+    return time.usec() / 1e6;
+  };
+
+  llvm::sys::TimeValue total =
+    endState.ExecutionTimes.lookup(path.front()).second -
+    endState.ExecutionTimes.lookup(path.back()).first;
+  out << "Critical path: " << llvm::format("%.3f", toSeconds(total)) << "s\n";
+  for (const Job *cmd : reversed(path)) {
+    auto times = endState.ExecutionTimes.lookup(cmd);
+    out << "  " << cmd->getSource().getClassName();
+    for (const Action *A : cmd->getSource().getInputs())
+      if (auto *IA = dyn_cast<InputAction>(A))
+        out << " " << llvm::sys::path::filename(IA->getInputArg().getValue());
+    out << ": " << llvm::format("%.3f", toSeconds(times.second - times.first))
+        << "s\n";
+  }
+}
+
 int Compilation::performJobsImpl() {
   // Create a TaskQueue for execution.
   std::unique_ptr<TaskQueue> TQ;
-  if (SkipTaskExecution)
+  if (SkipTaskExecution) {
     TQ.reset(new DummyTaskQueue(NumberOfParallelCommands));
-  else
+  } else {
     TQ.reset(new TaskQueue(NumberOfParallelCommands));
+    TQ->setMaximumLoadAverage(MaximumLoadAverage);
+    TQ->setUsesJobserver();
+  }
 
   PerformJobsState State;
 
+  llvm::DenseMap<const Job *, unsigned> Priorities =
+    computeCriticalPathPriorities(*this);
+
   using DependencyGraph = DependencyGraph<const Job *>;
   DependencyGraph DepGraph;
+
+  // The .swiftdeps files saved at the end of the last build, if any.
+  std::unique_ptr<DependencyCache> DepCache;
+  if (getIncrementalBuildEnabled() && !CompilationRecordPath.empty())
+    DepCache = DependencyCache::loadFromPath(getDependencyCachePath());
   SmallPtrSet<const Job *, 16> DeferredCommands;
   SmallVector<const Job *, 16> InitialOutOfDateCommands;
 
+  // In batch mode, compile jobs that become ready to run wait here until the
+  // task queue is started or the task that unblocked them has been handled,
+  // and are then combined into batches.
+  SmallVector<const Job *, 16> PendingBatchableCommands;
+  SmallVector<std::unique_ptr<Job>, 4> BatchJobs;
+  llvm::SmallDenseMap<const Job *, SmallVector<const Job *, 4>, 4>
+    BatchConstituents;
+
+  // Returns the jobs performed by a batch, or nothing if \p Cmd isn't one.
+  auto getBatchConstituents = [&] (const Job *Cmd) -> ArrayRef<const Job *> {
+    auto found = BatchConstituents.find(Cmd);
+    if (found == BatchConstituents.end())
+      return None;
+    return found->second;
+  };
+
   DependencyGraph::MarkTracer ActualIncrementalTracer;
   DependencyGraph::MarkTracer *IncrementalTracer = nullptr;
   if (ShowIncrementalBuildDecisions)
@@ -302,6 +497,12 @@ int Compilation::performJobsImpl() {
       return;
     }
 
+    if (getBatchModeEnabled() && isBatchable(Cmd)) {
+      State.ScheduledCommands.insert(Cmd);
+      PendingBatchableCommands.push_back(Cmd);
+      return;
+    }
+
     // FIXME: Failing here should not take down the whole process.
     bool success = writeFilelistIfNecessary(Cmd, Diags);
     assert(success && "failed to write filelist");
@@ -311,7 +512,55 @@ int Compilation::performJobsImpl() {
            "not implemented for compilations with multiple jobs");
     State.ScheduledCommands.insert(Cmd);
     TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
-                (void *)Cmd);
+                (void *)Cmd, Priorities.lookup(Cmd));
+  };
+
+  // Split the pending compile jobs into about as many batches as we may run
+  // commands in parallel, and start them. This is done both before the task
+  // queue is started and after each finished task, so that compile jobs
+  // unblocked by one task don't wait for all the others to finish.
+  auto schedulePendingBatchableCommands = [&] {
+    if (PendingBatchableCommands.empty())
+      return;
+
+    // Keep each batch in input order; the frontend matches outputs to primary
+    // files in that order.
+    std::sort(PendingBatchableCommands.begin(), PendingBatchableCommands.end(),
+              [](const Job *lhs, const Job *rhs) {
+      return getPrimaryInputArg(lhs).getIndex() <
+             getPrimaryInputArg(rhs).getIndex();
+    });
+
+    size_t NumPending = PendingBatchableCommands.size();
+    size_t NumBatches =
+      std::min<size_t>(std::max(NumberOfParallelCommands, 1U), NumPending);
+    for (size_t i = 0; i != NumBatches; ++i) {
+      size_t Begin = NumPending * i / NumBatches;
+      size_t End = NumPending * (i + 1) / NumBatches;
+      auto Batch = llvm::makeArrayRef(PendingBatchableCommands)
+                     .slice(Begin, End - Begin);
+
+      const Job *Cmd = Batch.front();
+      unsigned Priority = 0;
+      for (const Job *Constituent : Batch)
+        Priority = std::max(Priority, Priorities.lookup(Constituent));
+      if (Batch.size() > 1) {
+        BatchJobs.push_back(
+          BatchModeToolChain->constructBatchJob(Batch, *this,
+                                                *BatchModeOutputInfo));
+        Cmd = BatchJobs.back().get();
+        BatchConstituents[Cmd].assign(Batch.begin(), Batch.end());
+      }
+
+      // FIXME: Failing here should not take down the whole process.
+      bool success = writeFilelistIfNecessary(Cmd, Diags);
+      assert(success && "failed to write filelist");
+      (void)success;
+
+      TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
+                  (void *)Cmd, Priority);
+    }
+    PendingBatchableCommands.clear();
   };
 
   // When a task finishes, we need to reevaluate the other commands that
@@ -347,7 +596,13 @@ int Compilation::performJobsImpl() {
       if (Cmd->getCondition() == Job::Condition::NewlyAdded) {
         DepGraph.addIndependentNode(Cmd);
       } else {
-        switch (DepGraph.loadFromPath(Cmd, DependenciesFile)) {
+        Optional<StringRef> CachedDependencies;
+        if (DepCache)
+          CachedDependencies = DepCache->lookup(DependenciesFile);
+        auto DepsLoadResult =
+          CachedDependencies ? DepGraph.loadFromString(Cmd, *CachedDependencies)
+                             : DepGraph.loadFromPath(Cmd, DependenciesFile);
+        switch (DepsLoadResult) {
         case DependencyGraphImpl::LoadResult::HadError:
           disableIncrementalBuild();
           for (const Job *Cmd : DeferredCommands)
@@ -427,6 +682,7 @@ int Compilation::performJobsImpl() {
   llvm::TimerGroup DriverTimerGroup("Driver Time Compilation");
   llvm::SmallDenseMap<const Job *, std::unique_ptr<llvm::Timer>, 16>
     DriverTimers;
+  llvm::SmallDenseMap<const Job *, llvm::sys::TimeValue, 16> StartTimes;
 
   // Set up a callback which will be called immediately after a task has
   // started. This callback may be used to provide output indicating that the
@@ -434,23 +690,30 @@ int Compilation::performJobsImpl() {
   auto taskBegan = [&] (ProcessId Pid, void *Context) {
     // TODO: properly handle task began.
     const Job *BeganCmd = (const Job *)Context;
+    ArrayRef<const Job *> BeganCmds = getBatchConstituents(BeganCmd);
+    if (BeganCmds.empty())
+      BeganCmds = BeganCmd;
+
+    StartTimes[BeganCmd] = llvm::sys::TimeValue::now();
 
     if (ShowDriverTimeCompilation) {
       llvm::SmallString<128> TimerName;
       llvm::raw_svector_ostream OS(TimerName);
 
       OS << BeganCmd->getSource().getClassName();
-      for (auto A : BeganCmd->getSource().getInputs()) {
-        if (const InputAction *IA = dyn_cast<InputAction>(A)) {
-          OS << " " << IA->getInputArg().getValue();
-        }
-      }
-      for (auto J : BeganCmd->getInputs()) {
-        for (auto A : J->getSource().getInputs()) {
+      for (const Job *Cmd : BeganCmds) {
+        for (auto A : Cmd->getSource().getInputs()) {
           if (const InputAction *IA = dyn_cast<InputAction>(A)) {
             OS << " " << IA->getInputArg().getValue();
           }
         }
+        for (auto J : Cmd->getInputs()) {
+          for (auto A : J->getSource().getInputs()) {
+            if (const InputAction *IA = dyn_cast<InputAction>(A)) {
+              OS << " " << IA->getInputArg().getValue();
+            }
+          }
+        }
       }
 
       DriverTimers.insert({
@@ -462,10 +725,12 @@ int Compilation::performJobsImpl() {
     }
 
     // For verbose output, print out each command as it begins execution.
-    if (Level == OutputLevel::Verbose)
+    if (Level == OutputLevel::Verbose) {
       BeganCmd->printCommandLine(llvm::errs());
-    else if (Level == OutputLevel::Parseable)
-      parseable_output::emitBeganMessage(llvm::errs(), *BeganCmd, Pid);
+    } else if (Level == OutputLevel::Parseable) {
+      for (const Job *Cmd : BeganCmds)
+        parseable_output::emitBeganMessage(llvm::errs(), *Cmd, Pid);
+    }
   };
 
   // Set up a callback which will be called immediately after a task has
@@ -475,16 +740,35 @@ int Compilation::performJobsImpl() {
   // to run.
   auto taskFinished = [&] (ProcessId Pid, int ReturnCode, StringRef Output,
                            void *Context) -> TaskFinishedResponse {
-    const Job *FinishedCmd = (const Job *)Context;
+    const Job *FinishedTask = (const Job *)Context;
+    ArrayRef<const Job *> FinishedCmds = getBatchConstituents(FinishedTask);
+    if (FinishedCmds.empty())
+      FinishedCmds = FinishedTask;
 
     if (ShowDriverTimeCompilation) {
-      DriverTimers[FinishedCmd]->stopTimer();
+      DriverTimers[FinishedTask]->stopTimer();
+    }
+
+    // Record how long the task took. Failed tasks may have stopped early, so
+    // only successful ones are used to plan the next build.
+    llvm::sys::TimeValue StartTime = StartTimes.lookup(FinishedTask);
+    llvm::sys::TimeValue EndTime = llvm::sys::TimeValue::now();
+    uint64_t DurationShare = (EndTime - StartTime).usec() / FinishedCmds.size();
+    for (const Job *FinishedCmd : FinishedCmds) {
+      State.ExecutionTimes[FinishedCmd] = { StartTime, EndTime };
+      if (ReturnCode == EXIT_SUCCESS)
+        State.Durations[FinishedCmd] = llvm::sys::TimeValue(
+          DurationShare / 1000000, (DurationShare % 1000000) * 1000);
     }
 
     if (Level == OutputLevel::Parseable) {
-      // Parseable output was requested.
-      parseable_output::emitFinishedMessage(llvm::errs(), *FinishedCmd, Pid,
-                                            ReturnCode, Output);
+      // Parseable output was requested. A batch's output is reported with
+      // its first job.
+      for (const Job *FinishedCmd : FinishedCmds) {
+        parseable_output::emitFinishedMessage(
+          llvm::errs(), *FinishedCmd, Pid, ReturnCode,
+          FinishedCmd == FinishedCmds.front() ? Output : StringRef());
+      }
     } else {
       // Otherwise, send the buffered output to stderr, though only if we
       // support getting buffered output.
@@ -496,7 +780,10 @@ int Compilation::performJobsImpl() {
     // dependencies that have arisen, we need to reload the dependency file.
     // Do this whether or not the build succeeded.
     SmallVector<const Job *, 16> Dependents;
-    if (getIncrementalBuildEnabled()) {
+    for (const Job *FinishedCmd : FinishedCmds) {
+      if (!getIncrementalBuildEnabled())
+        break;
+
       const CommandOutput &Output = FinishedCmd->getOutput();
       StringRef DependenciesFile =
         Output.getAdditionalOutputForType(types::TY_SwiftDeps);
@@ -579,10 +866,10 @@ int Compilation::performJobsImpl() {
       if (Result == EXIT_SUCCESS)
         Result = ReturnCode;
 
-      if (!isa<CompileJobAction>(FinishedCmd->getSource()) ||
+      if (!isa<CompileJobAction>(FinishedTask->getSource()) ||
           ReturnCode != EXIT_FAILURE) {
         Diags.diagnose(SourceLoc(), diag::error_command_failed,
-                       FinishedCmd->getSource().getClassName(),
+                       FinishedTask->getSource().getClassName(),
                        ReturnCode);
       }
 
@@ -593,7 +880,8 @@ int Compilation::performJobsImpl() {
 
     // When a task finishes, we need to reevaluate the other commands that
     // might have been blocked.
-    markFinished(FinishedCmd);
+    for (const Job *FinishedCmd : FinishedCmds)
+      markFinished(FinishedCmd);
 
     for (const Job *Cmd : Dependents) {
       DeferredCommands.erase(Cmd);
@@ -601,12 +889,17 @@ int Compilation::performJobsImpl() {
       scheduleCommandIfNecessaryAndPossible(Cmd);
     }
 
+    schedulePendingBatchableCommands();
+
     return TaskFinishedResponse::ContinueExecution;
   };
 
   auto taskSignalled = [&] (ProcessId Pid, StringRef ErrorMsg, StringRef Output,
                             void *Context) -> TaskFinishedResponse {
     const Job *SignalledCmd = (const Job *)Context;
+    ArrayRef<const Job *> SignalledCmds = getBatchConstituents(SignalledCmd);
+    if (SignalledCmds.empty())
+      SignalledCmds = SignalledCmd;
 
     if (ShowDriverTimeCompilation) {
       DriverTimers[SignalledCmd]->stopTimer();
@@ -614,8 +907,11 @@ int Compilation::performJobsImpl() {
 
     if (Level == OutputLevel::Parseable) {
       // Parseable output was requested.
-      parseable_output::emitSignalledMessage(llvm::errs(), *SignalledCmd, Pid,
-                                             ErrorMsg, Output);
+      for (const Job *Cmd : SignalledCmds) {
+        parseable_output::emitSignalledMessage(
+          llvm::errs(), *Cmd, Pid, ErrorMsg,
+          Cmd == SignalledCmds.front() ? Output : StringRef());
+      }
     } else {
       // Otherwise, send the buffered output to stderr, though only if we
       // support getting buffered output.
@@ -637,6 +933,8 @@ int Compilation::performJobsImpl() {
   };
 
   do {
+    schedulePendingBatchableCommands();
+
     // Ask the TaskQueue to execute.
     TQ->execute(taskBegan, taskFinished, taskSignalled);
 
@@ -653,7 +951,8 @@ int Compilation::performJobsImpl() {
     }
 
     // ...which may allow us to go on and do later tasks.
-  } while (Result == 0 && TQ->hasRemainingTasks());
+  } while (Result == 0 &&
+           (TQ->hasRemainingTasks() || !PendingBatchableCommands.empty()));
 
   if (Result == 0) {
     assert(State.BlockingCommands.empty() &&
@@ -680,12 +979,29 @@ int Compilation::performJobsImpl() {
     }
   }
 
+  if (ShowCriticalPath)
+    printCriticalPath(llvm::outs(), State);
+
   if (!CompilationRecordPath.empty() && !SkipTaskExecution) {
     InputInfoMap InputInfo;
     populateInputInfoMap(InputInfo, State);
     checkForOutOfDateInputs(Diags, InputInfo);
     writeCompilationRecord(CompilationRecordPath, ArgsHash, BuildStartTime,
                            InputInfo);
+
+    if (getIncrementalBuildEnabled()) {
+      SmallVector<StringRef, 16> DependenciesFiles;
+      for (const Job *Cmd : getJobs()) {
+        StringRef DependenciesFile =
+          Cmd->getOutput().getAdditionalOutputForType(types::TY_SwiftDeps);
+        if (!DependenciesFile.empty())
+          DependenciesFiles.push_back(DependenciesFile);
+      }
+      DependencyCache::write(getDependencyCachePath(), DependenciesFiles,
+                             DepCache.get());
+    } else {
+      llvm::sys::fs::remove(getDependencyCachePath());
+    }
   }
 
   if (Result == 0)
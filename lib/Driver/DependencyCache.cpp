@@ -0,0 +1,188 @@
+//===--- DependencyCache.cpp - Saved .swiftdeps of the last build ---------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// The cache is a header followed by one record per .swiftdeps file. All
+// integers are little-endian.
+//
+//   magic      "\xE2SDC"
+//   version    uint32
+//   numEntries uint32
+//   entries    numEntries x {
+//                pathLength uint32, dataLength uint32, size uint64,
+//                modTimeSeconds int64, modTimeNanoseconds int32,
+//                path, data, '\0'
+//              }
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Driver/DependencyCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace swift;
+using namespace swift::driver;
+using namespace llvm::support;
+
+static const char Signature[] = { '\xE2', 'S', 'D', 'C' };
+static const uint32_t Version = 1;
+
+/// The size of the fixed-length part of each entry.
+static const size_t EntryHeaderSize = 4 + 4 + 8 + 8 + 4;
+
+std::unique_ptr<DependencyCache>
+DependencyCache::loadFromPath(StringRef Path) {
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return nullptr;
+
+  std::unique_ptr<DependencyCache> Result(new DependencyCache());
+  Result->Buffer = std::move(Buffer.get());
+
+  StringRef Data = Result->Buffer->getBuffer();
+  if (!Data.startswith(StringRef(Signature, sizeof(Signature))))
+    return nullptr;
+  Data = Data.drop_front(sizeof(Signature));
+  if (Data.size() < 8 || endian::read32le(Data.data()) != Version)
+    return nullptr;
+  uint32_t NumEntries = endian::read32le(Data.data() + 4);
+  Data = Data.drop_front(8);
+
+  for (uint32_t i = 0; i != NumEntries; ++i) {
+    if (Data.size() < EntryHeaderSize)
+      return nullptr;
+    const char *Header = Data.data();
+    uint64_t PathLength = endian::read32le(Header);
+    uint64_t DataLength = endian::read32le(Header + 4);
+    uint64_t Size = endian::read64le(Header + 8);
+    int64_t Seconds = endian::read64le(Header + 16);
+    int32_t Nanoseconds = endian::read32le(Header + 24);
+    Data = Data.drop_front(EntryHeaderSize);
+
+    if (Data.size() < PathLength + DataLength + 1 ||
+        Data[PathLength + DataLength] != '\0')
+      return nullptr;
+
+    StringRef DepsPath = Data.take_front(PathLength);
+    StringRef Contents = Data.substr(PathLength, DataLength);
+    Result->Entries[DepsPath] = {
+      Contents, Size, llvm::sys::TimeValue(Seconds, Nanoseconds)
+    };
+    Data = Data.drop_front(PathLength + DataLength + 1);
+  }
+
+  return Result;
+}
+
+Optional<StringRef> DependencyCache::lookup(StringRef DepsPath) const {
+  auto Found = Entries.find(DepsPath);
+  if (Found == Entries.end())
+    return None;
+
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(DepsPath, Status))
+    return None;
+  if (Status.getSize() != Found->second.Size ||
+      Status.getLastModificationTime() != Found->second.ModTime)
+    return None;
+
+  return Found->second.Data;
+}
+
+void DependencyCache::write(StringRef Path, ArrayRef<StringRef> DepsPaths,
+                            const DependencyCache *Previous) {
+  struct NewEntry {
+    StringRef DepsPath;
+    StringRef Data;
+    uint64_t Size;
+    llvm::sys::TimeValue ModTime;
+  };
+  SmallVector<NewEntry, 16> NewEntries;
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> NewBuffers;
+
+  bool Changed = !Previous || Previous->Entries.size() != DepsPaths.size();
+  llvm::sys::TimeValue Now = llvm::sys::TimeValue::now();
+
+  for (StringRef DepsPath : DepsPaths) {
+    llvm::sys::fs::file_status Status;
+    if (llvm::sys::fs::status(DepsPath, Status)) {
+      Changed = true;
+      continue;
+    }
+    uint64_t Size = Status.getSize();
+    llvm::sys::TimeValue ModTime = Status.getLastModificationTime();
+
+    if (Previous) {
+      auto Found = Previous->Entries.find(DepsPath);
+      if (Found != Previous->Entries.end() && Found->second.Size == Size &&
+          Found->second.ModTime == ModTime) {
+        NewEntries.push_back({DepsPath, Found->second.Data, Size, ModTime});
+        continue;
+      }
+    }
+    Changed = true;
+
+    // A file written within the last second could be written again without
+    // its modification time changing, on file systems that only record
+    // whole seconds. Leave it to be read from disk next time.
+    if (ModTime.seconds() + 1 >= Now.seconds())
+      continue;
+
+    auto Buffer = llvm::MemoryBuffer::getFile(DepsPath);
+    if (!Buffer || Buffer.get()->getBufferSize() != Size)
+      continue;
+    NewEntries.push_back({DepsPath, Buffer.get()->getBuffer(), Size, ModTime});
+    NewBuffers.push_back(std::move(Buffer.get()));
+  }
+
+  if (!Changed)
+    return;
+
+  // Write to a temporary file first, so that a build that is interrupted
+  // doesn't leave a truncated cache behind.
+  SmallString<128> TempPath(Path);
+  TempPath += ".tmp";
+  {
+    std::error_code Error;
+    llvm::raw_fd_ostream Out(TempPath, Error, llvm::sys::fs::F_None);
+    if (Out.has_error() || Error) {
+      Out.clear_error();
+      return;
+    }
+
+    endian::Writer<little> Writer(Out);
+    Out.write(Signature, sizeof(Signature));
+    Writer.write<uint32_t>(Version);
+    Writer.write<uint32_t>(NewEntries.size());
+    for (const NewEntry &Entry : NewEntries) {
+      Writer.write<uint32_t>(Entry.DepsPath.size());
+      Writer.write<uint32_t>(Entry.Data.size());
+      Writer.write<uint64_t>(Entry.Size);
+      Writer.write<int64_t>(Entry.ModTime.seconds());
+      Writer.write<int32_t>(Entry.ModTime.nanoseconds());
+      Out << Entry.DepsPath << Entry.Data;
+      Out.write('\0');
+    }
+
+    if (Out.has_error()) {
+      Out.clear_error();
+      Out.close();
+      llvm::sys::fs::remove(TempPath);
+      return;
+    }
+  }
+
+  if (llvm::sys::fs::rename(TempPath, Path))
+    llvm::sys::fs::remove(TempPath);
+}
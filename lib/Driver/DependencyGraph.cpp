@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "swift/Driver/DependencyGraph.h"
+#include "swift/Basic/BinaryDependencyFile.h"
 #include "swift/Basic/DemangleWrappers.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
@@ -48,12 +49,14 @@ using LoadResult = DependencyGraphImpl::LoadResult;
 using DependencyKind = DependencyGraphImpl::DependencyKind;
 using DependencyCallbackTy = LoadResult(StringRef, DependencyKind, bool);
 using InterfaceHashCallbackTy = LoadResult(StringRef);
+using FingerprintCallbackTy = void(StringRef, DependencyKind, StringRef);
 
 static LoadResult
 parseDependencyFile(llvm::MemoryBuffer &buffer,
                     llvm::function_ref<DependencyCallbackTy> providesCallback,
                     llvm::function_ref<DependencyCallbackTy> dependsCallback,
-                    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+                    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback,
+                    llvm::function_ref<FingerprintCallbackTy> fingerprintCallback) {
   namespace yaml = llvm::yaml;
 
   // FIXME: Switch to a format other than YAML.
@@ -105,6 +108,51 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
       StringRef valueString = value->getValue(scratch);
       UPDATE_RESULT(interfaceHashCallback(valueString));
 
+    } else if (keyString.startswith("fingerprint-")) {
+      DependencyKind kind = llvm::StringSwitch<DependencyKind>(keyString)
+        .Case("fingerprint-top-level", DependencyKind::TopLevelName)
+        .Case("fingerprint-nominal", DependencyKind::NominalType)
+        .Case("fingerprint-member", DependencyKind::NominalTypeMember)
+        .Default(DependencyKind());
+      if (kind == DependencyKind())
+        return LoadResult::HadError;
+
+      auto *entries = dyn_cast<yaml::SequenceNode>(i->getValue());
+      if (!entries)
+        return LoadResult::HadError;
+
+      // Entries come in the form ["name", "fingerprint"], or for members
+      // ["{MangledBaseName}", "memberName", "fingerprint"].
+      unsigned numParts = kind == DependencyKind::NominalTypeMember ? 3 : 2;
+      for (yaml::Node &rawEntry : *entries) {
+        auto *entry = dyn_cast<yaml::SequenceNode>(&rawEntry);
+        if (!entry)
+          return LoadResult::HadError;
+
+        SmallString<64> name;
+        SmallString<32> fingerprint;
+        unsigned index = 0;
+        for (yaml::Node &rawPart : *entry) {
+          auto *part = dyn_cast<yaml::ScalarNode>(&rawPart);
+          if (!part || index == numParts)
+            return LoadResult::HadError;
+          ++index;
+
+          if (index == numParts) {
+            fingerprint = part->getValue(scratch);
+          } else {
+            // Smash member names together, as for the dependencies below.
+            if (index > 1)
+              name.push_back('\0');
+            name += part->getValue(scratch);
+          }
+        }
+        if (index != numParts)
+          return LoadResult::HadError;
+
+        fingerprintCallback(name.str(), kind, fingerprint.str());
+      }
+
     } else {
       enum class DependencyDirection : bool {
         Depends,
@@ -206,6 +254,88 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
   return result;
 }
 
+static LoadResult
+parseBinaryDependencyFile(llvm::MemoryBuffer &buffer,
+                          llvm::function_ref<DependencyCallbackTy> providesCallback,
+                          llvm::function_ref<DependencyCallbackTy> dependsCallback,
+                          llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback,
+                          llvm::function_ref<FingerprintCallbackTy> fingerprintCallback) {
+  using Kind = BinaryDependencyFile::Kind;
+
+  BinaryDependencyFile file;
+  if (!BinaryDependencyFile::read(buffer.getBuffer(), file))
+    return LoadResult::HadError;
+
+  LoadResult result = LoadResult::UpToDate;
+  auto updateResult = [&result](LoadResult update) -> bool {
+    if (update == LoadResult::HadError)
+      return false;
+    if (update == LoadResult::AffectsDownstream)
+      result = LoadResult::AffectsDownstream;
+    return true;
+  };
+
+  // The names point straight into the buffer; nothing is copied until the
+  // callbacks decide to keep them.
+  for (unsigned i = 0, e = file.getNumRecords(); i != e; ++i) {
+    auto record = file.getRecord(i);
+
+    DependencyKind kind;
+    switch (record.RecordKind) {
+    case Kind::TopLevel:
+      kind = DependencyKind::TopLevelName;
+      break;
+    case Kind::Nominal:
+      kind = DependencyKind::NominalType;
+      break;
+    case Kind::Member:
+      kind = DependencyKind::NominalTypeMember;
+      break;
+    case Kind::DynamicLookup:
+      kind = DependencyKind::DynamicLookupName;
+      break;
+    case Kind::External:
+      if (record.IsProvides)
+        return LoadResult::HadError;
+      kind = DependencyKind::ExternalFile;
+      break;
+    }
+
+    auto &callback = record.IsProvides ? providesCallback : dependsCallback;
+    if (!updateResult(callback(record.Name, kind, record.IsCascading)))
+      return LoadResult::HadError;
+  }
+
+  for (unsigned i = 0, e = file.getNumFingerprints(); i != e; ++i) {
+    auto fingerprint = file.getFingerprint(i);
+
+    DependencyKind kind;
+    switch (fingerprint.FingerprintKind) {
+    case Kind::TopLevel:
+      kind = DependencyKind::TopLevelName;
+      break;
+    case Kind::Nominal:
+      kind = DependencyKind::NominalType;
+      break;
+    case Kind::Member:
+      kind = DependencyKind::NominalTypeMember;
+      break;
+    case Kind::DynamicLookup:
+    case Kind::External:
+      llvm_unreachable("rejected by BinaryDependencyFile::read");
+    }
+
+    fingerprintCallback(fingerprint.Name, kind, fingerprint.Value);
+  }
+
+  StringRef interfaceHash = file.getInterfaceHash();
+  if (!interfaceHash.empty() &&
+      !updateResult(interfaceHashCallback(interfaceHash)))
+    return LoadResult::HadError;
+
+  return result;
+}
+
 LoadResult DependencyGraphImpl::loadFromPath(const void *node, StringRef path) {
   auto buffer = llvm::MemoryBuffer::getFile(path);
   if (!buffer)
@@ -219,12 +349,24 @@ DependencyGraphImpl::loadFromString(const void *node, StringRef data) {
   return loadFromBuffer(node, *buffer);
 }
 
+/// Appends the key used for the fingerprint of (\p kind, \p name) to \p key.
+static void getFingerprintKey(DependencyKind kind, StringRef name,
+                              SmallVectorImpl<char> &key) {
+  key.push_back(static_cast<char>(kind));
+  key.append(name.begin(), name.end());
+}
+
 LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
                                                llvm::MemoryBuffer &buffer) {
   auto &provides = Provides[node];
+  ChangedProvides.erase(node);
 
-  auto dependsCallback = [this, node](StringRef name, DependencyKind kind,
-                                      bool isCascading) -> LoadResult {
+  // Set if the node now depends on something that has already been marked,
+  // which affects everything downstream regardless of fingerprints.
+  bool dependsAffectDownstream = false;
+
+  auto dependsCallback = [this, node, &dependsAffectDownstream](
+      StringRef name, DependencyKind kind, bool isCascading) -> LoadResult {
     if (kind == DependencyKind::ExternalFile)
       ExternalDependencies.insert(name);
 
@@ -245,8 +387,10 @@ LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
       iter->flags |= flags;
     }
 
-    if (isCascading && (entries.second & kind))
+    if (isCascading && (entries.second & kind)) {
+      dependsAffectDownstream = true;
       return LoadResult::AffectsDownstream;
+    }
     return LoadResult::UpToDate;
   };
 
@@ -285,8 +429,66 @@ LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
     return LoadResult::UpToDate;
   };
 
-  return parseDependencyFile(buffer, providesCallback, dependsCallback,
-                             interfaceHashCallback);
+  llvm::StringMap<std::string> newFingerprints;
+  auto fingerprintCallback = [&newFingerprints](StringRef name,
+                                                DependencyKind kind,
+                                                StringRef fingerprint) {
+    SmallString<64> key;
+    getFingerprintKey(kind, name, key);
+    newFingerprints[key] = fingerprint;
+  };
+
+  LoadResult result;
+  if (BinaryDependencyFile::hasSignature(buffer.getBuffer())) {
+    result = parseBinaryDependencyFile(buffer, providesCallback,
+                                       dependsCallback, interfaceHashCallback,
+                                       fingerprintCallback);
+  } else {
+    result = parseDependencyFile(buffer, providesCallback, dependsCallback,
+                                 interfaceHashCallback, fingerprintCallback);
+  }
+  if (result == LoadResult::HadError)
+    return result;
+
+  // Files without fingerprints are handled a whole node at a time.
+  if (newFingerprints.empty()) {
+    Fingerprints.erase(node);
+    return result;
+  }
+
+  auto &oldFingerprints = Fingerprints[node];
+  if (result == LoadResult::AffectsDownstream && !dependsAffectDownstream) {
+    // The interface changed. Work out which of the provided names it changed
+    // for: those whose fingerprints differ from last time, and those that
+    // have no fingerprint now, including names the node no longer provides.
+    std::vector<ProvidesEntryTy> changed;
+    for (const auto &provided : provides) {
+      DependencyMaskTy changedKinds;
+      for (auto kind : { DependencyKind::TopLevelName,
+                         DependencyKind::DynamicLookupName,
+                         DependencyKind::NominalType,
+                         DependencyKind::NominalTypeMember }) {
+        if (!provided.kindMask.contains(kind))
+          continue;
+        SmallString<64> key;
+        getFingerprintKey(kind, provided.name, key);
+        auto newFingerprint = newFingerprints.find(key);
+        if (newFingerprint == newFingerprints.end() ||
+            oldFingerprints.lookup(key) != newFingerprint->getValue())
+          changedKinds |= kind;
+      }
+      if (changedKinds)
+        changed.push_back({provided.name, changedKinds});
+    }
+
+    if (changed.empty())
+      result = LoadResult::UpToDate;
+    else
+      ChangedProvides[node] = std::move(changed);
+  }
+
+  oldFingerprints = std::move(newFingerprints);
+  return result;
 }
 
 void DependencyGraphImpl::markExternal(SmallVectorImpl<const void *> &visited,
@@ -322,12 +524,9 @@ DependencyGraphImpl::markTransitive(SmallVectorImpl<const void *> &visited,
   SmallPtrSet<const void *, 16> visitedSet;
 
   auto addDependentsToWorklist = [&](const void *next,
+                                     ArrayRef<ProvidesEntryTy> allProvided,
                                      ArrayRef<MarkTracerImpl::Entry> reason) {
-    auto allProvided = Provides.find(next);
-    if (allProvided == Provides.end())
-      return;
-
-    for (const auto &provided : allProvided->second) {
+    for (const auto &provided : allProvided) {
       auto allDependents = Dependencies.find(provided.name);
       if (allDependents == Dependencies.end())
         continue;
@@ -373,8 +572,17 @@ DependencyGraphImpl::markTransitive(SmallVectorImpl<const void *> &visited,
   };
 
   // Always mark through the starting node, even if it's already marked.
+  // If its fingerprints say that only some of its declarations changed, only
+  // follow the names those declarations provide.
   markIntransitive(node);
-  addDependentsToWorklist(node, {});
+  auto changedProvides = ChangedProvides.find(node);
+  if (changedProvides != ChangedProvides.end()) {
+    std::vector<ProvidesEntryTy> changed = std::move(changedProvides->second);
+    ChangedProvides.erase(changedProvides);
+    addDependentsToWorklist(node, changed, {});
+  } else {
+    addDependentsToWorklist(node, Provides[node], {});
+  }
 
   while (!worklist.empty()) {
     auto next = worklist.pop_back_val();
@@ -386,7 +594,9 @@ DependencyGraphImpl::markTransitive(SmallVectorImpl<const void *> &visited,
       continue;
     }
 
-    addDependentsToWorklist(next.Node, next.Reason);
+    auto allProvided = Provides.find(next.Node);
+    if (allProvided != Provides.end())
+      addDependentsToWorklist(next.Node, allProvided->second, next.Reason);
     if (!markIntransitive(next.Node))
       continue;
     record(next);
@@ -52,6 +52,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <cstdlib>
 #include <memory>
 
 using namespace swift;
@@ -216,6 +217,7 @@ static bool populateOutOfDateMap(InputInfoMap &map, StringRef argsHashStr,
   SmallString<64> scratch;
 
   llvm::StringMap<InputInfo> previousInputs;
+  llvm::StringMap<llvm::sys::TimeValue> previousDurations;
   bool versionValid = false;
   bool optionsMatch = true;
 
@@ -317,6 +319,25 @@ static bool populateOutOfDateMap(InputInfoMap &map, StringRef argsHashStr,
         auto inputName = key->getValue(scratch);
         previousInputs[inputName] = { *previousBuildState, timeValue };
       }
+
+    } else if (keyStr == "job_durations") {
+      auto *durationMap = dyn_cast<yaml::MappingNode>(i->getValue());
+      if (!durationMap)
+        return true;
+
+      // FIXME: LLVM's YAML support does incremental parsing in such a way that
+      // for-range loops break.
+      for (auto i = durationMap->begin(), e = durationMap->end(); i != e; ++i) {
+        auto *key = dyn_cast<yaml::ScalarNode>(i->getKey());
+        if (!key)
+          return true;
+
+        llvm::sys::TimeValue duration;
+        if (readTimeValue(i->getValue(), duration))
+          return true;
+
+        previousDurations[key->getValue(scratch)] = duration;
+      }
     }
   }
 
@@ -331,7 +352,11 @@ static bool populateOutOfDateMap(InputInfoMap &map, StringRef argsHashStr,
       continue;
     }
     ++numInputsFromPrevious;
-    map[inputPair.second] = iter->getValue();
+    InputInfo &info = map[inputPair.second];
+    info = iter->getValue();
+    auto durationIter = previousDurations.find(inputPair.second->getValue());
+    if (durationIter != previousDurations.end())
+      info.previousDuration = durationIter->getValue();
   }
 
   // If a file was removed, we've lost its dependency info. Rebuild everything.
@@ -361,6 +386,8 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
     ArgList->hasArg(options::OPT_driver_skip_execution);
   bool ShowIncrementalBuildDecisions =
     ArgList->hasArg(options::OPT_driver_show_incremental);
+  bool ShowCriticalPath =
+    ArgList->hasArg(options::OPT_driver_show_critical_path);
 
   bool Incremental = ArgList->hasArg(options::OPT_incremental) &&
     !ArgList->hasArg(options::OPT_whole_module_optimization) &&
@@ -371,6 +398,7 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
     ArgList->hasArg(options::OPT_continue_building_after_errors);
   bool ShowDriverTimeCompilation =
     ArgList->hasArg(options::OPT_driver_time_compilation);
+  bool BatchMode = ArgList->hasArg(options::OPT_enable_batch_mode);
 
   std::unique_ptr<DerivedArgList> TranslatedArgList(
     translateInputArgs(*ArgList));
@@ -486,6 +514,17 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
     }
   }
 
+  double MaximumLoadAverage = 0;
+  if (const Arg *A = ArgList->getLastArg(options::OPT_load_average)) {
+    char *End;
+    MaximumLoadAverage = strtod(A->getValue(), &End);
+    if (*End != '\0' || End == A->getValue() || MaximumLoadAverage < 0) {
+      Diags.diagnose(SourceLoc(), diag::error_invalid_arg_value,
+                     A->getAsString(*ArgList), A->getValue());
+      return nullptr;
+    }
+  }
+
   OutputLevel Level = OutputLevel::Normal;
   if (const Arg *A = ArgList->getLastArg(options::OPT_v,
                                          options::OPT_parseable_output)) {
@@ -521,6 +560,29 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
   if (ShowIncrementalBuildDecisions)
     C->setShowsIncrementalBuildDecisions();
 
+  if (ShowCriticalPath)
+    C->setShowsCriticalPath();
+
+  C->setMaximumLoadAverage(MaximumLoadAverage);
+
+  // Only compiles that produce a single output per primary file can be
+  // batched; see CompilerInvocation's handling of multiple -primary-files.
+  if (BatchMode && OI.CompilerMode == OutputInfo::Mode::StandardCompile &&
+      !OI.ShouldGenerateFixitEdits) {
+    switch (OI.CompilerOutputType) {
+    case types::TY_Object:
+    case types::TY_Assembly:
+    case types::TY_LLVM_IR:
+    case types::TY_LLVM_BC:
+    case types::TY_RawSIL:
+    case types::TY_SIL:
+      C->enableBatchMode(*TC, OI);
+      break;
+    default:
+      break;
+    }
+  }
+
   // This has to happen after building jobs, because otherwise we won't even
   // emit .swiftdeps files for the next build.
   if (rebuildEverything)
@@ -37,9 +37,22 @@ ToolChain::JobContext::JobContext(Compilation &C,
                                   ArrayRef<const Job *> Inputs,
                                   ArrayRef<const Action *> InputActions,
                                   const CommandOutput &Output,
-                                  const OutputInfo &OI)
+                                  const OutputInfo &OI,
+                                  ArrayRef<const Job *> BatchedJobs)
   : C(C), Inputs(Inputs), InputActions(InputActions), Output(Output),
-    OI(OI), Args(C.getArgs()) {}
+    OI(OI), Args(C.getArgs()), BatchedJobs(BatchedJobs) {}
+
+SmallVector<const CommandOutput *, 1>
+ToolChain::JobContext::getPrimaryFileOutputs() const {
+  SmallVector<const CommandOutput *, 1> outputs;
+  if (BatchedJobs.empty()) {
+    outputs.push_back(&Output);
+    return outputs;
+  }
+  for (const Job *batchedJob : BatchedJobs)
+    outputs.push_back(&batchedJob->getOutput());
+  return outputs;
+}
 
 ArrayRef<InputPair> ToolChain::JobContext::getTopLevelInputFiles() const {
   return C.getInputFiles();
@@ -93,34 +106,70 @@ ToolChain::constructJob(const JobAction &JA,
     }
   }();
 
-  // Special-case the Swift frontend.
-  const char *executablePath = nullptr;
-  if (StringRef(SWIFT_EXECUTABLE_NAME) == invocationInfo.ExecutableName) {
-    executablePath = getDriver().getSwiftProgramPath().c_str();
-  } else {
-    std::string relativePath =
-        findProgramRelativeToSwift(invocationInfo.ExecutableName);
-    if (!relativePath.empty()) {
-      executablePath = C.getArgs().MakeArgString(relativePath);
-    } else {
-      auto systemPath =
-          llvm::sys::findProgramByName(invocationInfo.ExecutableName);
-      if (systemPath) {
-        executablePath = C.getArgs().MakeArgString(systemPath.get());
-      } else {
-        // For debugging purposes.
-        executablePath = invocationInfo.ExecutableName;
-      }
+  return llvm::make_unique<Job>(JA, std::move(inputs), std::move(output),
+                                getExecutablePath(invocationInfo, C),
+                                std::move(invocationInfo.Arguments),
+                                std::move(invocationInfo.ExtraEnvironment),
+                                std::move(invocationInfo.FilelistInfo));
+}
+
+std::unique_ptr<Job>
+ToolChain::constructBatchJob(ArrayRef<const Job *> jobs,
+                             Compilation &C,
+                             const OutputInfo &OI) const {
+  assert(!jobs.empty() && "a batch needs at least one job");
+  auto &JA = cast<CompileJobAction>(jobs.front()->getSource());
+
+  SmallVector<const Action *, 16> inputActions;
+  std::unique_ptr<CommandOutput> output(
+      new CommandOutput(jobs.front()->getOutput().getPrimaryOutputType()));
+  for (const Job *batchedJob : jobs) {
+    assert(isa<CompileJobAction>(batchedJob->getSource()) &&
+           batchedJob->getSource().getInputs().size() == 1 &&
+           batchedJob->getInputs().empty() &&
+           "only compile jobs for a single primary file can be batched");
+    inputActions.push_back(batchedJob->getSource().getInputs().front());
+
+    const CommandOutput &batchedOutput = batchedJob->getOutput();
+    for (size_t i = 0, e = batchedOutput.getPrimaryOutputFilenames().size();
+         i != e; ++i) {
+      output->addPrimaryOutput(batchedOutput.getPrimaryOutputFilenames()[i],
+                               batchedOutput.getBaseInput(i));
     }
   }
 
-  return llvm::make_unique<Job>(JA, std::move(inputs), std::move(output),
-                                executablePath,
+  JobContext context{C, {}, inputActions, *output, OI, jobs};
+  auto invocationInfo = constructInvocation(JA, context);
+
+  SmallVector<const Job *, 1> noInputs;
+  return llvm::make_unique<Job>(JA, std::move(noInputs), std::move(output),
+                                getExecutablePath(invocationInfo, C),
                                 std::move(invocationInfo.Arguments),
                                 std::move(invocationInfo.ExtraEnvironment),
                                 std::move(invocationInfo.FilelistInfo));
 }
 
+const char *
+ToolChain::getExecutablePath(const InvocationInfo &invocationInfo,
+                             Compilation &C) const {
+  // Special-case the Swift frontend.
+  if (StringRef(SWIFT_EXECUTABLE_NAME) == invocationInfo.ExecutableName)
+    return getDriver().getSwiftProgramPath().c_str();
+
+  std::string relativePath =
+      findProgramRelativeToSwift(invocationInfo.ExecutableName);
+  if (!relativePath.empty())
+    return C.getArgs().MakeArgString(relativePath);
+
+  auto systemPath =
+      llvm::sys::findProgramByName(invocationInfo.ExecutableName);
+  if (systemPath)
+    return C.getArgs().MakeArgString(systemPath.get());
+
+  // For debugging purposes.
+  return invocationInfo.ExecutableName;
+}
+
 std::string
 ToolChain::findProgramRelativeToSwift(StringRef executableName) const {
   auto insertionResult =
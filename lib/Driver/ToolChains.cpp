@@ -25,6 +25,7 @@
 #include "swift/Config.h"
 #include "clang/Basic/Version.h"
 #include "clang/Driver/Util.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
@@ -76,11 +77,28 @@ static void addPrimaryInputsOfType(ArgStringList &Arguments,
   }
 }
 
+/// Adds \p optionName followed by the additional output of type \p type of
+/// each of \p outputs that has one.
+///
+/// A frontend invocation with several primary files expects each
+/// supplementary output path once per primary file, in the same order.
+static void addOutputsOfType(ArgStringList &arguments,
+                             ArrayRef<const CommandOutput *> outputs,
+                             types::ID type, const char *optionName) {
+  for (const CommandOutput *output : outputs) {
+    const std::string &path = output->getAdditionalOutputForType(type);
+    if (path.empty())
+      continue;
+    arguments.push_back(optionName);
+    arguments.push_back(path.c_str());
+  }
+}
+
 /// Handle arguments common to all invocations of the frontend (compilation,
 /// module-merging, LLDB's REPL, etc).
 static void addCommonFrontendArgs(const ToolChain &TC,
                                   const OutputInfo &OI,
-                                  const CommandOutput &output,
+                                  ArrayRef<const CommandOutput *> outputs,
                                   const ArgList &inputArgs,
                                   ArgStringList &arguments) {
   arguments.push_back("-target");
@@ -130,6 +148,7 @@ static void addCommonFrontendArgs(const ToolChain &TC,
   inputArgs.AddLastArg(arguments, options::OPT_suppress_warnings);
   inputArgs.AddLastArg(arguments, options::OPT_profile_generate);
   inputArgs.AddLastArg(arguments, options::OPT_profile_coverage_mapping);
+  inputArgs.AddLastArg(arguments, options::OPT_profile_use);
   inputArgs.AddLastArg(arguments, options::OPT_warnings_as_errors);
   inputArgs.AddLastArg(arguments, options::OPT_sanitize_EQ);
   inputArgs.AddLastArg(arguments, options::OPT_sanitize_coverage_EQ);
@@ -144,12 +163,8 @@ static void addCommonFrontendArgs(const ToolChain &TC,
   inputArgs.AddAllArgs(arguments, options::OPT_Xllvm);
   inputArgs.AddAllArgs(arguments, options::OPT_Xcc);
 
-  const std::string &moduleDocOutputPath =
-      output.getAdditionalOutputForType(types::TY_SwiftModuleDocFile);
-  if (!moduleDocOutputPath.empty()) {
-    arguments.push_back("-emit-module-doc-path");
-    arguments.push_back(moduleDocOutputPath.c_str());
-  }
+  addOutputsOfType(arguments, outputs, types::TY_SwiftModuleDocFile,
+                   "-emit-module-doc-path");
 
   if (llvm::sys::Process::StandardErrHasColors())
     arguments.push_back("-color-diagnostics");
@@ -247,30 +262,32 @@ ToolChain::constructInvocation(const CompileJobAction &job,
   switch (context.OI.CompilerMode) {
   case OutputInfo::Mode::StandardCompile:
   case OutputInfo::Mode::UpdateCode: {
-    assert(context.InputActions.size() == 1 &&
-           "The Swift frontend expects exactly one input (the primary file)!");
-
-    auto *IA = cast<InputAction>(context.InputActions[0]);
-    const Arg &PrimaryInputArg = IA->getInputArg();
+    assert((context.InputActions.size() == 1 ||
+            context.BatchedJobs.size() == context.InputActions.size()) &&
+           "The Swift frontend expects exactly one input (the primary file), "
+           "or one per job in a batch!");
 
     if (context.Args.hasArg(options::OPT_driver_use_filelists) ||
         context.getTopLevelInputFiles().size() > TOO_MANY_FILES) {
       Arguments.push_back("-filelist");
       Arguments.push_back(context.getAllSourcesPath());
-      Arguments.push_back("-primary-file");
-      PrimaryInputArg.render(context.Args, Arguments);
+      for (const Action *A : context.InputActions) {
+        Arguments.push_back("-primary-file");
+        cast<InputAction>(A)->getInputArg().render(context.Args, Arguments);
+      }
     } else {
-      bool FoundPrimaryInput = false;
+      llvm::SmallDenseSet<unsigned, 4> PrimaryInputIndices;
+      for (const Action *A : context.InputActions)
+        PrimaryInputIndices.insert(
+          cast<InputAction>(A)->getInputArg().getIndex());
+
       for (auto inputPair : context.getTopLevelInputFiles()) {
         if (!types::isPartOfSwiftCompilation(inputPair.first))
           continue;
 
         // See if this input should be passed with -primary-file.
-        if (!FoundPrimaryInput &&
-            PrimaryInputArg.getIndex() == inputPair.second->getIndex()) {
+        if (PrimaryInputIndices.erase(inputPair.second->getIndex()))
           Arguments.push_back("-primary-file");
-          FoundPrimaryInput = true;
-        }
         Arguments.push_back(inputPair.second->getValue());
       }
     }
@@ -297,7 +314,8 @@ ToolChain::constructInvocation(const CompileJobAction &job,
   if (context.Args.hasArg(options::OPT_parse_stdlib))
     Arguments.push_back("-disable-objc-attr-requires-foundation-module");
 
-  addCommonFrontendArgs(*this, context.OI, context.Output, context.Args,
+  auto PrimaryFileOutputs = context.getPrimaryFileOutputs();
+  addCommonFrontendArgs(*this, context.OI, PrimaryFileOutputs, context.Args,
                         Arguments);
 
   // Pass the optimization level down to the frontend.
@@ -312,12 +330,8 @@ ToolChain::constructInvocation(const CompileJobAction &job,
   Arguments.push_back("-module-name");
   Arguments.push_back(context.Args.MakeArgString(context.OI.ModuleName));
 
-  const std::string &ModuleOutputPath =
-    context.Output.getAdditionalOutputForType(types::ID::TY_SwiftModuleFile);
-  if (!ModuleOutputPath.empty()) {
-    Arguments.push_back("-emit-module-path");
-    Arguments.push_back(ModuleOutputPath.c_str());
-  }
+  addOutputsOfType(Arguments, PrimaryFileOutputs, types::TY_SwiftModuleFile,
+                   "-emit-module-path");
 
   const std::string &ObjCHeaderOutputPath =
     context.Output.getAdditionalOutputForType(types::ID::TY_ObjCHeader);
@@ -330,33 +344,25 @@ ToolChain::constructInvocation(const CompileJobAction &job,
     Arguments.push_back(ObjCHeaderOutputPath.c_str());
   }
 
-  const std::string &SerializedDiagnosticsPath =
-    context.Output.getAdditionalOutputForType(types::TY_SerializedDiagnostics);
-  if (!SerializedDiagnosticsPath.empty()) {
-    Arguments.push_back("-serialize-diagnostics-path");
-    Arguments.push_back(SerializedDiagnosticsPath.c_str());
-  }
+  addOutputsOfType(Arguments, PrimaryFileOutputs,
+                   types::TY_SerializedDiagnostics,
+                   "-serialize-diagnostics-path");
+  addOutputsOfType(Arguments, PrimaryFileOutputs, types::TY_Dependencies,
+                   "-emit-dependencies-path");
 
-  const std::string &DependenciesPath =
-    context.Output.getAdditionalOutputForType(types::TY_Dependencies);
-  if (!DependenciesPath.empty()) {
-    Arguments.push_back("-emit-dependencies-path");
-    Arguments.push_back(DependenciesPath.c_str());
-  }
-
-  const std::string &ReferenceDependenciesPath =
-    context.Output.getAdditionalOutputForType(types::TY_SwiftDeps);
-  if (!ReferenceDependenciesPath.empty()) {
-    Arguments.push_back("-emit-reference-dependencies-path");
-    Arguments.push_back(ReferenceDependenciesPath.c_str());
-  }
+  addOutputsOfType(Arguments, PrimaryFileOutputs, types::TY_SwiftDeps,
+                   "-emit-reference-dependencies-path");
+  bool EmitsReferenceDependencies =
+    std::any_of(PrimaryFileOutputs.begin(), PrimaryFileOutputs.end(),
+                [](const CommandOutput *Output) {
+      return !Output->getAdditionalOutputForType(types::TY_SwiftDeps).empty();
+    });
+  if (EmitsReferenceDependencies &&
+      !context.Args.hasArg(options::OPT_driver_emit_yaml_dependencies))
+    Arguments.push_back("-emit-binary-reference-dependencies");
 
-  const std::string &FixitsPath =
-    context.Output.getAdditionalOutputForType(types::TY_Remapping);
-  if (!FixitsPath.empty()) {
-    Arguments.push_back("-emit-fixits-path");
-    Arguments.push_back(FixitsPath.c_str());
-  }
+  addOutputsOfType(Arguments, PrimaryFileOutputs, types::TY_Remapping,
+                   "-emit-fixits-path");
 
   if (context.OI.numThreads > 0) {
     Arguments.push_back("-num-threads");
@@ -406,7 +412,7 @@ ToolChain::constructInvocation(const InterpretJobAction &job,
   if (context.Args.hasArg(options::OPT_parse_stdlib))
     Arguments.push_back("-disable-objc-attr-requires-foundation-module");
 
-  addCommonFrontendArgs(*this, context.OI, context.Output, context.Args,
+  addCommonFrontendArgs(*this, context.OI, {&context.Output}, context.Args,
                         Arguments);
 
   // Pass the optimization level down to the frontend.
@@ -597,7 +603,7 @@ ToolChain::constructInvocation(const MergeModuleJobAction &job,
   // serialized ASTs.
   Arguments.push_back("-parse-as-library");
 
-  addCommonFrontendArgs(*this, context.OI, context.Output, context.Args,
+  addCommonFrontendArgs(*this, context.OI, {&context.Output}, context.Args,
                         Arguments);
 
   Arguments.push_back("-module-name");
@@ -663,7 +669,7 @@ ToolChain::constructInvocation(const REPLJobAction &job,
   }
 
   ArgStringList FrontendArgs;
-  addCommonFrontendArgs(*this, context.OI, context.Output, context.Args,
+  addCommonFrontendArgs(*this, context.OI, {&context.Output}, context.Args,
                         FrontendArgs);
   context.Args.AddAllArgs(FrontendArgs, options::OPT_l, options::OPT_framework,
                           options::OPT_L);
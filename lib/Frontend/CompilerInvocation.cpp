@@ -18,6 +18,7 @@
 #include "swift/Option/Options.h"
 #include "swift/Option/SanitizerOptions.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
@@ -98,10 +99,11 @@ static void debugFailWithCrash() {
 static bool readFileList(DiagnosticEngine &diags,
                          std::vector<std::string> &inputFiles,
                          const llvm::opt::Arg *filelistPath,
-                         const llvm::opt::Arg *primaryFileArg = nullptr,
-                         unsigned *primaryFileIndex = nullptr) {
-  assert((primaryFileArg == nullptr) || (primaryFileIndex != nullptr) &&
-         "did not provide argument for primary file index");
+                         ArrayRef<const llvm::opt::Arg *> primaryFileArgs = {},
+                         SmallVectorImpl<unsigned> *primaryFileIndices =
+                           nullptr) {
+  assert((primaryFileArgs.empty() || primaryFileIndices != nullptr) &&
+         "did not provide argument for primary file indices");
 
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
       llvm::MemoryBuffer::getFile(filelistPath->getValue());
@@ -111,27 +113,135 @@ static bool readFileList(DiagnosticEngine &diags,
     return false;
   }
 
-  bool foundPrimaryFile = false;
-  if (primaryFileIndex) *primaryFileIndex = 0;
+  llvm::StringMap<bool> foundPrimaryFiles;
+  for (const llvm::opt::Arg *primaryFileArg : primaryFileArgs)
+    foundPrimaryFiles[primaryFileArg->getValue()] = false;
 
   for (StringRef line : make_range(llvm::line_iterator(*buffer.get()), {})) {
+    if (!foundPrimaryFiles.empty()) {
+      auto found = foundPrimaryFiles.find(line);
+      if (found != foundPrimaryFiles.end() && !found->second) {
+        found->second = true;
+        primaryFileIndices->push_back(inputFiles.size());
+      }
+    }
     inputFiles.push_back(line);
-
-    if (foundPrimaryFile || primaryFileArg == nullptr)
-      continue;
-    if (line == primaryFileArg->getValue())
-      foundPrimaryFile = true;
-    else
-      ++*primaryFileIndex;
   }
 
-  if (primaryFileArg && !foundPrimaryFile) {
+  bool foundAllPrimaryFiles = true;
+  for (const llvm::opt::Arg *primaryFileArg : primaryFileArgs) {
+    if (foundPrimaryFiles[primaryFileArg->getValue()])
+      continue;
     diags.diagnose(SourceLoc(), diag::error_primary_file_not_found,
                    primaryFileArg->getValue(), filelistPath->getValue());
-    return false;
+    foundAllPrimaryFiles = false;
+  }
+
+  return foundAllPrimaryFiles;
+}
+
+/// Sets up FrontendOptions::BatchPrimaries when more than one primary input
+/// was given, matching the i'th output of each kind to the i'th primary
+/// input.
+///
+/// \returns true on error.
+static bool setUpBatchPrimaries(FrontendOptions &Opts,
+                                ArrayRef<unsigned> PrimaryIndices,
+                                ArgList &Args, DiagnosticEngine &Diags) {
+  using namespace options;
+
+  switch (Opts.RequestedAction) {
+  case FrontendOptions::EmitSILGen:
+  case FrontendOptions::EmitSIL:
+  case FrontendOptions::EmitIR:
+  case FrontendOptions::EmitBC:
+  case FrontendOptions::EmitAssembly:
+  case FrontendOptions::EmitObject:
+    break;
+  case FrontendOptions::NoneAction:
+  case FrontendOptions::Parse:
+  case FrontendOptions::DumpParse:
+  case FrontendOptions::DumpInterfaceHash:
+  case FrontendOptions::DumpAST:
+  case FrontendOptions::PrintAST:
+  case FrontendOptions::DumpTypeRefinementContexts:
+  case FrontendOptions::EmitModuleOnly:
+  case FrontendOptions::EmitSIBGen:
+  case FrontendOptions::EmitSIB:
+  case FrontendOptions::Immediate:
+  case FrontendOptions::REPL:
+    Diags.diagnose(SourceLoc(), diag::error_mode_cannot_batch);
+    return true;
   }
 
-  return true;
+  unsigned NumPrimaries = PrimaryIndices.size();
+  bool HadError = false;
+
+  auto checkCount = [&](StringRef Option, unsigned Count) {
+    if (Count == NumPrimaries)
+      return;
+    Diags.diagnose(SourceLoc(), diag::error_batch_output_count, Option,
+                   NumPrimaries, Count);
+    HadError = true;
+  };
+
+  checkCount(Args.hasArg(OPT_output_filelist) ? "-output-filelist" : "-o",
+             Opts.OutputFilenames.size());
+
+  // Supplementary outputs must either be absent or given for every primary.
+  // Deriving their names from the main output is left to the single-primary
+  // case.
+  auto getPerPrimaryPaths = [&](const std::string &SinglePath,
+                                OptSpecifier OptWithPath,
+                                StringRef Spelling) {
+    std::vector<std::string> Paths = Args.getAllArgValues(OptWithPath);
+    if (!SinglePath.empty() || !Paths.empty())
+      checkCount(Spelling, Paths.size());
+    Paths.resize(NumPrimaries);
+    return Paths;
+  };
+
+  auto ModulePaths =
+    getPerPrimaryPaths(Opts.ModuleOutputPath, OPT_emit_module_path,
+                       "-emit-module-path");
+  auto ModuleDocPaths =
+    getPerPrimaryPaths(Opts.ModuleDocOutputPath, OPT_emit_module_doc_path,
+                       "-emit-module-doc-path");
+  auto DiagnosticsPaths =
+    getPerPrimaryPaths(Opts.SerializedDiagnosticsPath,
+                       OPT_serialize_diagnostics_path,
+                       "-serialize-diagnostics-path");
+  auto DependenciesPaths =
+    getPerPrimaryPaths(Opts.DependenciesFilePath, OPT_emit_dependencies_path,
+                       "-emit-dependencies-path");
+  auto ReferenceDependenciesPaths =
+    getPerPrimaryPaths(Opts.ReferenceDependenciesFilePath,
+                       OPT_emit_reference_dependencies_path,
+                       "-emit-reference-dependencies-path");
+
+  if (HadError)
+    return true;
+
+  for (unsigned i = 0; i != NumPrimaries; ++i) {
+    FrontendOptions::BatchPrimary Primary;
+    Primary.InputIndex = PrimaryIndices[i];
+    Primary.OutputFilename = Opts.OutputFilenames[i];
+    Primary.ModuleOutputPath = ModulePaths[i];
+    Primary.ModuleDocOutputPath = ModuleDocPaths[i];
+    Primary.SerializedDiagnosticsPath = DiagnosticsPaths[i];
+    Primary.DependenciesFilePath = DependenciesPaths[i];
+    Primary.ReferenceDependenciesFilePath = ReferenceDependenciesPaths[i];
+    Opts.BatchPrimaries.push_back(std::move(Primary));
+  }
+
+  // Code that only knows about a single primary input sees the first one.
+  const FrontendOptions::BatchPrimary &First = Opts.BatchPrimaries.front();
+  Opts.ModuleOutputPath = First.ModuleOutputPath;
+  Opts.ModuleDocOutputPath = First.ModuleDocOutputPath;
+  Opts.SerializedDiagnosticsPath = First.SerializedDiagnosticsPath;
+  Opts.DependenciesFilePath = First.DependenciesFilePath;
+  Opts.ReferenceDependenciesFilePath = First.ReferenceDependenciesFilePath;
+  return false;
 }
 
 static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
@@ -165,6 +275,8 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
 
   Opts.EmitVerboseSIL |= Args.hasArg(OPT_emit_verbose_sil);
   Opts.EmitSortedSIL |= Args.hasArg(OPT_emit_sorted_sil);
+  Opts.EmitBinaryReferenceDependencies |=
+    Args.hasArg(OPT_emit_binary_reference_dependencies);
 
   Opts.DelayedFunctionBodyParsing |= Args.hasArg(OPT_delayed_function_body_parsing);
   Opts.EnableTesting |= Args.hasArg(OPT_enable_testing);
@@ -201,13 +313,13 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     }
   }
 
+  // The indices of the primary inputs, in input order.
+  SmallVector<unsigned, 1> PrimaryIndices;
   if (const Arg *A = Args.getLastArg(OPT_filelist)) {
-    const Arg *primaryFileArg = Args.getLastArg(OPT_primary_file);
-    unsigned primaryFileIndex = 0;
+    SmallVector<const Arg *, 1> primaryFileArgs(
+      Args.filtered_begin(OPT_primary_file), Args.filtered_end());
     if (readFileList(Diags, Opts.InputFilenames, A,
-                     primaryFileArg, &primaryFileIndex)) {
-      if (primaryFileArg)
-        Opts.PrimaryInput = SelectedInput(primaryFileIndex);
+                     primaryFileArgs, &PrimaryIndices)) {
       assert(!Args.hasArg(OPT_INPUT) && "mixing -filelist with inputs");
     }
   } else {
@@ -217,13 +329,15 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
       if (A->getOption().matches(OPT_INPUT)) {
         Opts.InputFilenames.push_back(A->getValue());
       } else if (A->getOption().matches(OPT_primary_file)) {
-        Opts.PrimaryInput = SelectedInput(Opts.InputFilenames.size());
+        PrimaryIndices.push_back(Opts.InputFilenames.size());
         Opts.InputFilenames.push_back(A->getValue());
       } else {
         llvm_unreachable("Unknown input-related argument!");
       }
     }
   }
+  if (!PrimaryIndices.empty())
+    Opts.PrimaryInput = SelectedInput(PrimaryIndices.front());
 
   Opts.ParseStdlib |= Args.hasArg(OPT_parse_stdlib);
 
@@ -615,6 +729,10 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
                           SERIALIZED_MODULE_DOC_EXTENSION,
                           false);
 
+  if (PrimaryIndices.size() > 1 &&
+      setUpBatchPrimaries(Opts, PrimaryIndices, Args, Diags))
+    return true;
+
   if (!Opts.DependenciesFilePath.empty()) {
     switch (Opts.RequestedAction) {
     case FrontendOptions::NoneAction:
@@ -1076,6 +1194,8 @@ static bool ParseSILArgs(SILOptions &Opts, ArgList &Args,
 
   Opts.GenerateProfile |= Args.hasArg(OPT_profile_generate);
   Opts.EmitProfileCoverageMapping |= Args.hasArg(OPT_profile_coverage_mapping);
+  if (const Arg *A = Args.getLastArg(OPT_profile_use))
+    Opts.UseProfile = A->getValue();
   Opts.EnableGuaranteedClosureContexts |=
     Args.hasArg(OPT_enable_guaranteed_closure_contexts);
 
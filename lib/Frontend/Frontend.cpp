@@ -42,14 +42,37 @@ void CompilerInstance::createSILModule(bool WholeModule) {
                                               WholeModule);
 }
 
+bool CompilerInstance::isPrimaryBuffer(unsigned BufferID) const {
+  return std::find(PrimaryBufferIDs.begin(), PrimaryBufferIDs.end(), BufferID)
+           != PrimaryBufferIDs.end();
+}
+
 void CompilerInstance::setPrimarySourceFile(SourceFile *SF) {
   assert(SF);
   assert(MainModule && "main module not created yet");
-  assert(!PrimarySourceFile && "already has a primary source file");
-  assert(PrimaryBufferID == NO_SUCH_BUFFER || !SF->getBufferID().hasValue() ||
-         SF->getBufferID().getValue() == PrimaryBufferID);
-  PrimarySourceFile = SF;
-  PrimarySourceFile->setReferencedNameTracker(NameTracker);
+
+  unsigned Index = 0;
+  if (auto BufferID = SF->getBufferID()) {
+    auto Found = std::find(PrimaryBufferIDs.begin(), PrimaryBufferIDs.end(),
+                           BufferID.getValue());
+    assert((PrimaryBufferIDs.empty() || Found != PrimaryBufferIDs.end()) &&
+           "not a primary input");
+    if (Found != PrimaryBufferIDs.end())
+      Index = Found - PrimaryBufferIDs.begin();
+  }
+
+  if (PrimarySourceFiles.size() <= Index)
+    PrimarySourceFiles.resize(Index + 1);
+  assert(!PrimarySourceFiles[Index] && "already has a primary source file");
+  PrimarySourceFiles[Index] = SF;
+
+  if (Index < NameTrackers.size())
+    SF->setReferencedNameTracker(NameTrackers[Index]);
+}
+
+bool CompilerInstance::isPrimarySourceFile(const SourceFile *SF) const {
+  return std::find(PrimarySourceFiles.begin(), PrimarySourceFiles.end(), SF)
+           != PrimarySourceFiles.end();
 }
 
 bool CompilerInstance::setup(const CompilerInvocation &Invok) {
@@ -132,6 +155,14 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
 
   const Optional<SelectedInput> &PrimaryInput =
     Invocation.getFrontendOptions().PrimaryInput;
+  const auto &BatchPrimaries = Invocation.getFrontendOptions().BatchPrimaries;
+  PrimaryBufferIDs.assign(BatchPrimaries.size(), NO_SUCH_BUFFER);
+
+  auto recordBatchPrimaryBuffer = [&](unsigned InputIndex, unsigned BufferID) {
+    for (unsigned i = 0, e = BatchPrimaries.size(); i != e; ++i)
+      if (BatchPrimaries[i].InputIndex == InputIndex)
+        PrimaryBufferIDs[i] = BufferID;
+  };
 
   // Add the memory buffers first, these will be associated with a filename
   // and they can replace the contents of an input filename.
@@ -169,6 +200,7 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
       if (PrimaryInput && PrimaryInput->isFilename() &&
           PrimaryInput->Index == i)
         PrimaryBufferID = ExistingBufferID.getValue();
+      recordBatchPrimaryBuffer(i, ExistingBufferID.getValue());
 
       continue; // replaced by a memory buffer.
     }
@@ -211,12 +243,16 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
 
     if (PrimaryInput && PrimaryInput->isFilename() && PrimaryInput->Index == i)
       PrimaryBufferID = BufferID;
+    recordBatchPrimaryBuffer(i, BufferID);
   }
 
   // Set the primary file to the code-completion point if one exists.
   if (CodeCompletionBufferID.hasValue())
     PrimaryBufferID = *CodeCompletionBufferID;
 
+  if (PrimaryBufferIDs.empty() && PrimaryBufferID != NO_SUCH_BUFFER)
+    PrimaryBufferIDs.push_back(PrimaryBufferID);
+
   if (MainMode && MainBufferID == NO_SUCH_BUFFER && BufferIDs.size() == 1)
     MainBufferID = BufferIDs.front();
 
@@ -401,7 +437,7 @@ void CompilerInstance::performSema() {
     MainModule->addFile(*MainFile);
     addAdditionalInitialImports(MainFile);
 
-    if (MainBufferID == PrimaryBufferID)
+    if (isPrimaryBuffer(MainBufferID))
       setPrimarySourceFile(MainFile);
   }
 
@@ -427,13 +463,13 @@ void CompilerInstance::performSema() {
     MainModule->addFile(*NextInput);
     addAdditionalInitialImports(NextInput);
 
-    if (BufferID == PrimaryBufferID)
+    if (isPrimaryBuffer(BufferID))
       setPrimarySourceFile(NextInput);
 
     auto &Diags = NextInput->getASTContext().Diags;
     auto DidSuppressWarnings = Diags.getSuppressWarnings();
     auto IsPrimary
-      = PrimaryBufferID == NO_SUCH_BUFFER || BufferID == PrimaryBufferID;
+      = PrimaryBufferID == NO_SUCH_BUFFER || isPrimaryBuffer(BufferID);
     Diags.setSuppressWarnings(DidSuppressWarnings || !IsPrimary);
 
     bool Done;
@@ -475,7 +511,7 @@ void CompilerInstance::performSema() {
   // Parse the main file last.
   if (MainBufferID != NO_SUCH_BUFFER) {
     bool mainIsPrimary =
-      (PrimaryBufferID == NO_SUCH_BUFFER || MainBufferID == PrimaryBufferID);
+      (PrimaryBufferID == NO_SUCH_BUFFER || isPrimaryBuffer(MainBufferID));
 
     SourceFile &MainFile =
       MainModule->getMainSourceFile(Invocation.getSourceFileKind());
@@ -515,7 +551,7 @@ void CompilerInstance::performSema() {
   // Type-check each top-level input besides the main source file.
   for (auto File : MainModule->getFiles())
     if (auto SF = dyn_cast<SourceFile>(File))
-      if (PrimaryBufferID == NO_SUCH_BUFFER || SF == PrimarySourceFile)
+      if (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(SF))
         performTypeChecking(*SF, PersistentState.getTopLevelContext(),
                             TypeCheckOptions, /*curElem*/0,
                             options.WarnLongFunctionBodies);
@@ -539,7 +575,7 @@ void CompilerInstance::performSema() {
 
   for (auto File : MainModule->getFiles())
     if (auto SF = dyn_cast<SourceFile>(File))
-      if (PrimaryBufferID == NO_SUCH_BUFFER || SF == PrimarySourceFile)
+      if (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(SF))
         finishTypeChecking(*SF);
 }
 
@@ -88,3 +88,19 @@ void FrontendOptions::forAllOutputPaths(
       fn(*next);
   }
 }
+
+FrontendOptions
+FrontendOptions::getOptionsForBatchPrimary(unsigned Index) const {
+  const BatchPrimary &primary = BatchPrimaries[Index];
+
+  FrontendOptions result = *this;
+  result.BatchPrimaries.clear();
+  result.PrimaryInput = SelectedInput(primary.InputIndex);
+  result.setSingleOutputFilename(primary.OutputFilename);
+  result.ModuleOutputPath = primary.ModuleOutputPath;
+  result.ModuleDocOutputPath = primary.ModuleDocOutputPath;
+  result.SerializedDiagnosticsPath = primary.SerializedDiagnosticsPath;
+  result.DependenciesFilePath = primary.DependenciesFilePath;
+  result.ReferenceDependenciesFilePath = primary.ReferenceDependenciesFilePath;
+  return result;
+}
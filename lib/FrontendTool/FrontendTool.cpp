@@ -30,6 +30,7 @@
 #include "swift/AST/NameLookup.h"
 #include "swift/AST/ReferencedNameTracker.h"
 #include "swift/AST/TypeRefinementContext.h"
+#include "swift/Basic/BinaryDependencyFile.h"
 #include "swift/Basic/Dwarf.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/FileSystem.h"
@@ -49,6 +50,7 @@
 // This API should be sunk down to LLVM.
 #include "clang/Frontend/CompilerInstance.h"
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -56,6 +58,7 @@
 #include "llvm/Option/Option.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
@@ -197,11 +200,247 @@ static std::string mangleTypeAsContext(const NominalTypeDecl *type) {
   return mangler.finalize();
 }
 
+namespace {
+/// Receives the contents of a reference dependencies file one section at a
+/// time, and writes it out in either the YAML or the binary form.
+class ReferenceDependencyEmitter {
+public:
+  using Kind = BinaryDependencyFile::Kind;
+
+  virtual ~ReferenceDependencyEmitter() = default;
+
+  virtual void beginSection(Kind kind, bool isProvides) = 0;
+  virtual void emitName(StringRef name, bool isCascading = true) = 0;
+  virtual void emitMember(StringRef baseName, StringRef memberName,
+                          bool isCascading = true) = 0;
+  virtual void emitInterfaceHash(StringRef hash) = 0;
+
+  virtual void beginFingerprintSection(Kind kind) = 0;
+  virtual void emitFingerprint(StringRef name, StringRef fingerprint) = 0;
+  virtual void emitMemberFingerprint(StringRef baseName, StringRef memberName,
+                                     StringRef fingerprint) = 0;
+};
+
+class YAMLReferenceDependencyEmitter : public ReferenceDependencyEmitter {
+  raw_ostream &out;
+
+  static StringRef getSectionName(Kind kind) {
+    switch (kind) {
+    case Kind::TopLevel: return "top-level";
+    case Kind::Nominal: return "nominal";
+    case Kind::Member: return "member";
+    case Kind::DynamicLookup: return "dynamic-lookup";
+    case Kind::External: return "external";
+    }
+    llvm_unreachable("unhandled kind");
+  }
+
+  void emitTag(bool isCascading) {
+    out << "- ";
+    if (!isCascading)
+      out << "!private ";
+  }
+
+public:
+  explicit YAMLReferenceDependencyEmitter(raw_ostream &out) : out(out) {
+    out << "### Swift dependencies file v0 ###\n";
+  }
+
+  void beginSection(Kind kind, bool isProvides) override {
+    out << (isProvides ? "provides-" : "depends-") << getSectionName(kind)
+        << ":\n";
+  }
+
+  void emitName(StringRef name, bool isCascading) override {
+    emitTag(isCascading);
+    out << "\"" << llvm::yaml::escape(name) << "\"\n";
+  }
+
+  void emitMember(StringRef baseName, StringRef memberName,
+                  bool isCascading) override {
+    emitTag(isCascading);
+    out << "[\"" << llvm::yaml::escape(baseName) << "\", \""
+        << llvm::yaml::escape(memberName) << "\"]\n";
+  }
+
+  void emitInterfaceHash(StringRef hash) override {
+    out << "interface-hash: \"" << hash << "\"\n";
+  }
+
+  void beginFingerprintSection(Kind kind) override {
+    out << "fingerprint-" << getSectionName(kind) << ":\n";
+  }
+
+  void emitFingerprint(StringRef name, StringRef fingerprint) override {
+    out << "- [\"" << llvm::yaml::escape(name) << "\", \"" << fingerprint
+        << "\"]\n";
+  }
+
+  void emitMemberFingerprint(StringRef baseName, StringRef memberName,
+                             StringRef fingerprint) override {
+    out << "- [\"" << llvm::yaml::escape(baseName) << "\", \""
+        << llvm::yaml::escape(memberName) << "\", \"" << fingerprint
+        << "\"]\n";
+  }
+};
+
+class BinaryReferenceDependencyEmitter : public ReferenceDependencyEmitter {
+  BinaryDependencyFileWriter writer;
+  Kind currentKind = Kind::TopLevel;
+  bool currentIsProvides = true;
+
+public:
+  void beginSection(Kind kind, bool isProvides) override {
+    currentKind = kind;
+    currentIsProvides = isProvides;
+  }
+
+  void emitName(StringRef name, bool isCascading) override {
+    if (currentIsProvides)
+      writer.addProvides(currentKind, name);
+    else
+      writer.addDepends(currentKind, name, isCascading);
+  }
+
+  void emitMember(StringRef baseName, StringRef memberName,
+                  bool isCascading) override {
+    assert(currentKind == Kind::Member);
+    writer.addMember(baseName, memberName, currentIsProvides, isCascading);
+  }
+
+  void emitInterfaceHash(StringRef hash) override {
+    writer.setInterfaceHash(hash);
+  }
+
+  void beginFingerprintSection(Kind kind) override {
+    currentKind = kind;
+  }
+
+  void emitFingerprint(StringRef name, StringRef fingerprint) override {
+    writer.addFingerprint(currentKind, name, fingerprint);
+  }
+
+  void emitMemberFingerprint(StringRef baseName, StringRef memberName,
+                             StringRef fingerprint) override {
+    assert(currentKind == Kind::Member);
+    writer.addMemberFingerprint(baseName, memberName, fingerprint);
+  }
+
+  void write(raw_ostream &out) const { writer.write(out); }
+};
+
+/// Computes the fingerprints of the names a file provides from the
+/// fingerprints the parser recorded for its declarations.
+///
+/// A declaration's interface can change without its own tokens changing,
+/// when it refers to another declaration in the same file that did change:
+/// a typealias in its signature, say, or a function whose result initializes
+/// it. So the fingerprint of a name covers the top-level declarations the
+/// declarations providing it refer to by name, transitively.
+class FingerprintCollector {
+  const SourceFile &SF;
+
+  /// The top-level declarations of the file that each name may refer to.
+  /// For types, this includes their extensions.
+  llvm::StringMap<SmallVector<const Decl *, 2>> DeclsByName;
+
+  static const Decl *getTopLevelDecl(const Decl *D) {
+    while (D && !D->getDeclContext()->isModuleScopeContext())
+      D = D->getDeclContext()->getInnermostDeclarationDeclContext();
+    return D;
+  }
+
+public:
+  using DeclSet = llvm::SmallPtrSet<const Decl *, 8>;
+
+  explicit FingerprintCollector(const SourceFile &SF) : SF(SF) {
+    for (const Decl *D : SF.Decls) {
+      if (auto *ED = dyn_cast<ExtensionDecl>(D)) {
+        // Register the extension under the names of the extended type and of
+        // the types it is nested in.
+        auto *NTD = ED->getExtendedType()->getAnyNominal();
+        for (const DeclContext *DC = NTD; DC && DC->isTypeContext();
+             DC = DC->getParent()) {
+          if (auto *outer = DC->getAsNominalTypeOrNominalTypeExtensionContext())
+            DeclsByName[outer->getName().str()].push_back(ED);
+        }
+      } else if (auto *VD = dyn_cast<ValueDecl>(D)) {
+        if (VD->hasName())
+          DeclsByName[VD->getName().str()].push_back(VD);
+      } else if (auto *OD = dyn_cast<OperatorDecl>(D)) {
+        DeclsByName[OD->getName().str()].push_back(OD);
+      } else if (auto *PGD = dyn_cast<PrecedenceGroupDecl>(D)) {
+        DeclsByName[PGD->getName().str()].push_back(PGD);
+      }
+    }
+  }
+
+  /// Adds the declarations that the top-level declaration \p D refers to,
+  /// transitively, to \p decls, but not \p D itself.
+  void addReferences(const Decl *D, DeclSet &decls) {
+    SmallVector<const Decl *, 8> worklist;
+    worklist.push_back(D);
+    while (!worklist.empty()) {
+      for (StringRef name : SF.getDeclReferencedNames(worklist.pop_back_val())) {
+        auto found = DeclsByName.find(name);
+        if (found == DeclsByName.end())
+          continue;
+        for (const Decl *referenced : found->second)
+          if (decls.insert(referenced).second)
+            worklist.push_back(referenced);
+      }
+    }
+  }
+
+  /// Adds \p D, and the declarations it refers to, to \p decls.
+  ///
+  /// Only the names referred to by top-level declarations are recorded, so a
+  /// member stands in for the whole top-level declaration it belongs to.
+  void addDecl(const Decl *D, DeclSet &decls) {
+    decls.insert(D);
+    const Decl *topLevel = getTopLevelDecl(D);
+    if (!topLevel)
+      return;
+    if (decls.insert(topLevel).second || topLevel == D)
+      addReferences(topLevel, decls);
+  }
+
+  /// Combines the fingerprints of \p decls, or returns an empty string if
+  /// one of them doesn't have a fingerprint.
+  ///
+  /// The result does not depend on the order of the declarations.
+  std::string getFingerprint(const DeclSet &decls) const {
+    SmallVector<StringRef, 8> fingerprints;
+    for (const Decl *D : decls) {
+      StringRef fingerprint = SF.getDeclFingerprint(D);
+      if (fingerprint.empty())
+        return std::string();
+      fingerprints.push_back(fingerprint);
+    }
+    llvm::array_pod_sort(fingerprints.begin(), fingerprints.end());
+
+    llvm::MD5 hash;
+    uint8_t separator[1] = {0};
+    for (StringRef fingerprint : fingerprints) {
+      hash.update(fingerprint);
+      hash.update(separator);
+    }
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+    llvm::SmallString<32> str;
+    llvm::MD5::stringifyResult(result, str);
+    return str.str();
+  }
+};
+} // end anonymous namespace
+
 /// Emits a Swift-style dependencies file.
 static bool emitReferenceDependencies(DiagnosticEngine &diags,
                                       SourceFile *SF,
                                       DependencyTracker &depTracker,
                                       const FrontendOptions &opts) {
+  using Kind = BinaryDependencyFile::Kind;
+
   if (!SF) {
     diags.diagnose(SourceLoc(),
                    diag::emit_reference_dependencies_without_primary_file);
@@ -219,17 +458,28 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     return true;
   }
 
-  auto escape = [](Identifier name) -> std::string {
-    return llvm::yaml::escape(name.str());
-  };
-
-  out << "### Swift dependencies file v0 ###\n";
+  // The binary form is collected in memory and written at the end.
+  Optional<YAMLReferenceDependencyEmitter> yamlEmitter;
+  Optional<BinaryReferenceDependencyEmitter> binaryEmitter;
+  ReferenceDependencyEmitter *emitter;
+  if (opts.EmitBinaryReferenceDependencies) {
+    binaryEmitter.emplace();
+    emitter = binaryEmitter.getPointer();
+  } else {
+    yamlEmitter.emplace(out);
+    emitter = yamlEmitter.getPointer();
+  }
 
   llvm::MapVector<const NominalTypeDecl *, bool> extendedNominals;
   llvm::SmallVector<const FuncDecl *, 8> memberOperatorDecls;
   llvm::SmallVector<const ExtensionDecl *, 8> extensionsWithJustMembers;
 
-  out << "provides-top-level:\n";
+  // The declarations behind each provided name, for computing fingerprints.
+  llvm::MapVector<StringRef, SmallVector<const Decl *, 1>> topLevelDecls;
+  llvm::DenseMap<const NominalTypeDecl *, SmallVector<const ExtensionDecl *, 1>>
+    extensionsByNominal;
+
+  emitter->beginSection(Kind::TopLevel, /*provides*/true);
   for (const Decl *D : SF->Decls) {
     switch (D->getKind()) {
     case DeclKind::Module:
@@ -261,6 +511,7 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
         }
       }
       extendedNominals[NTD] |= !justMembers;
+      extensionsByNominal[NTD].push_back(ED);
       findNominalsAndOperators(extendedNominals, memberOperatorDecls,
                                ED->getMembers());
       break;
@@ -268,13 +519,19 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
 
     case DeclKind::InfixOperator:
     case DeclKind::PrefixOperator:
-    case DeclKind::PostfixOperator:
-      out << "- \"" << escape(cast<OperatorDecl>(D)->getName()) << "\"\n";
+    case DeclKind::PostfixOperator: {
+      StringRef name = cast<OperatorDecl>(D)->getName().str();
+      emitter->emitName(name);
+      topLevelDecls[name].push_back(D);
       break;
+    }
 
-    case DeclKind::PrecedenceGroup:
-      out << "- \"" << escape(cast<PrecedenceGroupDecl>(D)->getName()) << "\"\n";
+    case DeclKind::PrecedenceGroup: {
+      StringRef name = cast<PrecedenceGroupDecl>(D)->getName().str();
+      emitter->emitName(name);
+      topLevelDecls[name].push_back(D);
       break;
+    }
 
     case DeclKind::Enum:
     case DeclKind::Struct:
@@ -287,7 +544,8 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           NTD->getFormalAccess() <= Accessibility::FilePrivate) {
         break;
       }
-      out << "- \"" << escape(NTD->getName()) << "\"\n";
+      emitter->emitName(NTD->getName().str());
+      topLevelDecls[NTD->getName().str()].push_back(NTD);
       extendedNominals[NTD] |= true;
       findNominalsAndOperators(extendedNominals, memberOperatorDecls,
                                NTD->getMembers());
@@ -304,7 +562,8 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           VD->getFormalAccess() <= Accessibility::FilePrivate) {
         break;
       }
-      out << "- \"" << escape(VD->getName()) << "\"\n";
+      emitter->emitName(VD->getName().str());
+      topLevelDecls[VD->getName().str()].push_back(VD);
       break;
     }
 
@@ -327,29 +586,29 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
   }
 
   // This is also part of "provides-top-level".
-  for (auto *operatorFunction : memberOperatorDecls)
-    out << "- \"" << escape(operatorFunction->getName()) << "\"\n";
+  for (auto *operatorFunction : memberOperatorDecls) {
+    emitter->emitName(operatorFunction->getName().str());
+    topLevelDecls[operatorFunction->getName().str()].push_back(
+      operatorFunction);
+  }
 
-  out << "provides-nominal:\n";
+  emitter->beginSection(Kind::Nominal, /*provides*/true);
   for (auto entry : extendedNominals) {
     if (!entry.second)
       continue;
-    out << "- \"";
-    out << mangleTypeAsContext(entry.first);
-    out << "\"\n";
+    emitter->emitName(mangleTypeAsContext(entry.first));
   }
 
-  out << "provides-member:\n";
-  for (auto entry : extendedNominals) {
-    out << "- [\"";
-    out << mangleTypeAsContext(entry.first);
-    out << "\", \"\"]\n";
-  }
+  emitter->beginSection(Kind::Member, /*provides*/true);
+  for (auto entry : extendedNominals)
+    emitter->emitMember(mangleTypeAsContext(entry.first), "");
 
   // This is also part of "provides-member".
+  using MemberKey = std::pair<const NominalTypeDecl *, StringRef>;
+  llvm::MapVector<MemberKey, SmallVector<const ValueDecl *, 1>> memberDecls;
   for (auto *ED : extensionsWithJustMembers) {
-    auto mangledName = mangleTypeAsContext(
-                                        ED->getExtendedType()->getAnyNominal());
+    auto *NTD = ED->getExtendedType()->getAnyNominal();
+    auto mangledName = mangleTypeAsContext(NTD);
 
     for (auto *member : ED->getMembers()) {
       auto *VD = dyn_cast<ValueDecl>(member);
@@ -357,8 +616,8 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           VD->getFormalAccess() <= Accessibility::FilePrivate) {
         continue;
       }
-      out << "- [\"" << mangledName << "\", \""
-          << escape(VD->getName()) << "\"]\n";
+      emitter->emitMember(mangledName, VD->getName().str());
+      memberDecls[{NTD, VD->getName().str()}].push_back(VD);
     }
   }
 
@@ -366,36 +625,32 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     // FIXME: This requires a traversal of the whole file to compute.
     // We should (a) see if there's a cheaper way to keep it up to date,
     // and/or (b) see if we can fast-path cases where there's no ObjC involved.
-    out << "provides-dynamic-lookup:\n";
+    emitter->beginSection(Kind::DynamicLookup, /*provides*/true);
     class ValueDeclPrinter : public VisibleDeclConsumer {
     private:
-      raw_ostream &out;
-      std::string (*escape)(Identifier);
+      ReferenceDependencyEmitter &emitter;
     public:
-      ValueDeclPrinter(raw_ostream &out, decltype(escape) escape)
-        : out(out), escape(escape) {}
+      explicit ValueDeclPrinter(ReferenceDependencyEmitter &emitter)
+        : emitter(emitter) {}
 
       void foundDecl(ValueDecl *VD, DeclVisibilityKind Reason) override {
-        out << "- \"" << escape(VD->getName()) << "\"\n";
+        emitter.emitName(VD->getName().str());
       }
     };
-    ValueDeclPrinter printer(out, escape);
+    ValueDeclPrinter printer(*emitter);
     SF->lookupClassMembers({}, printer);
   }
 
   ReferencedNameTracker *tracker = SF->getReferencedNameTracker();
 
   // FIXME: Sort these?
-  out << "depends-top-level:\n";
+  emitter->beginSection(Kind::TopLevel, /*provides*/false);
   for (auto &entry : tracker->getTopLevelNames()) {
     assert(!entry.first.empty());
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "\"" << escape(entry.first) << "\"\n";
+    emitter->emitName(entry.first.str(), entry.second);
   }
 
-  out << "depends-member:\n";
+  emitter->beginSection(Kind::Member, /*provides*/false);
   auto &memberLookupTable = tracker->getUsedMembers();
   using TableEntryTy = std::pair<ReferencedNameTracker::MemberPair, bool>;
   std::vector<TableEntryTy> sortedMembers{
@@ -422,18 +677,14 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
         entry.first.first->getFormalAccess() <= Accessibility::FilePrivate)
       continue;
 
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "[\"";
-    out << mangleTypeAsContext(entry.first.first);
-    out << "\", \"";
+    StringRef memberName;
     if (!entry.first.second.empty())
-      out << escape(entry.first.second);
-    out << "\"]\n";
+      memberName = entry.first.second.str();
+    emitter->emitMember(mangleTypeAsContext(entry.first.first), memberName,
+                        entry.second);
   }
 
-  out << "depends-nominal:\n";
+  emitter->beginSection(Kind::Nominal, /*provides*/false);
   for (auto i = sortedMembers.begin(), e = sortedMembers.end(); i != e; ++i) {
     bool isCascading = i->second;
     while (i+1 != e && i[0].first.first == i[1].first.first) {
@@ -445,32 +696,87 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
         i->first.first->getFormalAccess() <= Accessibility::FilePrivate)
       continue;
 
-    out << "- ";
-    if (!isCascading)
-      out << "!private ";
-    out << "\"";
-    out <<  mangleTypeAsContext(i->first.first);
-    out << "\"\n";
+    emitter->emitName(mangleTypeAsContext(i->first.first), isCascading);
   }
 
   // FIXME: Sort these?
-  out << "depends-dynamic-lookup:\n";
+  emitter->beginSection(Kind::DynamicLookup, /*provides*/false);
   for (auto &entry : tracker->getDynamicLookupNames()) {
     assert(!entry.first.empty());
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "\"" << escape(entry.first) << "\"\n";
+    emitter->emitName(entry.first.str(), entry.second);
+  }
+
+  // Fingerprints let the driver tell which of the provided names are
+  // affected when the interface hash changes. Names without one are always
+  // affected.
+  FingerprintCollector fingerprints(*SF);
+
+  emitter->beginFingerprintSection(Kind::TopLevel);
+  for (auto &entry : topLevelDecls) {
+    FingerprintCollector::DeclSet decls;
+    for (auto *D : entry.second)
+      fingerprints.addDecl(D, decls);
+    std::string fingerprint = fingerprints.getFingerprint(decls);
+    if (!fingerprint.empty())
+      emitter->emitFingerprint(entry.first, fingerprint);
+  }
+
+  // A type's fingerprint covers its declaration, its members, and its
+  // extensions in this file. It is also the fingerprint of the type's
+  // "all members" entry.
+  emitter->beginFingerprintSection(Kind::Nominal);
+  SmallVector<std::pair<std::string, std::string>, 8> nominalFingerprints;
+  for (auto entry : extendedNominals) {
+    FingerprintCollector::DeclSet decls;
+    if (entry.first->getDeclContext()->getParentSourceFile() == SF)
+      fingerprints.addDecl(entry.first, decls);
+    for (auto *ED : extensionsByNominal.lookup(entry.first))
+      fingerprints.addDecl(ED, decls);
+    std::string fingerprint = fingerprints.getFingerprint(decls);
+    if (fingerprint.empty())
+      continue;
+
+    std::string mangledName = mangleTypeAsContext(entry.first);
+    if (entry.second)
+      emitter->emitFingerprint(mangledName, fingerprint);
+    nominalFingerprints.push_back({mangledName, fingerprint});
   }
 
-  out << "depends-external:\n";
-  for (auto &entry : depTracker.getDependencies()) {
-    out << "- \"" << llvm::yaml::escape(entry) << "\"\n";
+  emitter->beginFingerprintSection(Kind::Member);
+  for (auto &entry : nominalFingerprints)
+    emitter->emitMemberFingerprint(entry.first, "", entry.second);
+
+  // Members added by extensions get their own fingerprints, which cover what
+  // their extensions refer to but not the other members. A 'where' clause
+  // decides which members apply, so an extension with one is included.
+  for (auto &entry : memberDecls) {
+    FingerprintCollector::DeclSet decls;
+    for (auto *VD : entry.second)
+      decls.insert(VD);
+    for (auto *VD : entry.second)
+      fingerprints.addReferences(cast<ExtensionDecl>(VD->getDeclContext()),
+                                 decls);
+    for (auto *ED : extensionsByNominal.lookup(entry.first.first)) {
+      if (!ED->getTrailingWhereClause())
+        decls.erase(ED);
+    }
+    std::string fingerprint = fingerprints.getFingerprint(decls);
+    if (!fingerprint.empty()) {
+      emitter->emitMemberFingerprint(mangleTypeAsContext(entry.first.first),
+                                     entry.first.second, fingerprint);
+    }
   }
 
+  emitter->beginSection(Kind::External, /*provides*/false);
+  for (auto &entry : depTracker.getDependencies())
+    emitter->emitName(entry);
+
   llvm::SmallString<32> interfaceHash;
   SF->getInterfaceHash(interfaceHash);
-  out << "interface-hash: \"" << interfaceHash << "\"\n";
+  emitter->emitInterfaceHash(interfaceHash);
+
+  if (binaryEmitter)
+    binaryEmitter->write(out);
 
   return false;
 }
@@ -677,6 +983,44 @@ private:
   }
 };
 
+/// In batch mode, sends each diagnostic to the serialized diagnostics file of
+/// the primary file it is located in.
+///
+/// Diagnostics without a location, or located outside every primary file, go
+/// to the first primary file's consumer. Notes go wherever the diagnostic
+/// they are attached to went.
+class BatchSerializedDiagnosticConsumer : public DiagnosticConsumer {
+  std::vector<std::pair<std::string, std::unique_ptr<DiagnosticConsumer>>>
+    Consumers;
+  DiagnosticConsumer *LastConsumer = nullptr;
+
+public:
+  void addConsumer(StringRef Filename,
+                   std::unique_ptr<DiagnosticConsumer> Consumer) {
+    Consumers.emplace_back(Filename, std::move(Consumer));
+  }
+
+  void handleDiagnostic(SourceManager &SM, SourceLoc Loc,
+                        DiagnosticKind Kind, StringRef Text,
+                        const DiagnosticInfo &Info) override {
+    assert(!Consumers.empty() && "no primary files");
+    if (Kind != DiagnosticKind::Note || !LastConsumer) {
+      LastConsumer = Consumers.front().second.get();
+      if (Loc.isValid()) {
+        StringRef Filename =
+          SM.getIdentifierForBuffer(SM.findBufferContainingLoc(Loc));
+        for (auto &Entry : Consumers) {
+          if (Entry.first == Filename) {
+            LastConsumer = Entry.second.get();
+            break;
+          }
+        }
+      }
+    }
+    LastConsumer->handleDiagnostic(SM, Loc, Kind, Text, Info);
+  }
+};
+
 } // anonymous namespace
 
 // This is a separate function so that it shows up in stack traces.
@@ -693,6 +1037,13 @@ static void debugFailWithCrash() {
   LLVM_BUILTIN_TRAP;
 }
 
+static bool performCompileStepsPostSema(CompilerInstance &Instance,
+                                        CompilerInvocation &Invocation,
+                                        const FrontendOptions &opts,
+                                        SourceFile *PrimarySourceFile,
+                                        int &ReturnValue,
+                                        FrontendObserver *observer);
+
 /// Performs the compile requested by the user.
 /// \returns true on error
 static bool performCompile(CompilerInstance &Instance,
@@ -743,10 +1094,20 @@ static bool performCompile(CompilerInstance &Instance,
     return performLLVM(IRGenOpts, Instance.getASTContext(), Module.get());
   }
 
-  ReferencedNameTracker nameTracker;
-  bool shouldTrackReferences = !opts.ReferenceDependenciesFilePath.empty();
-  if (shouldTrackReferences)
-    Instance.setReferencedNameTracker(&nameTracker);
+  // Each primary file records the names it references separately.
+  std::vector<ReferencedNameTracker> nameTrackers;
+  if (opts.isBatchMode()) {
+    if (!opts.BatchPrimaries.front().ReferenceDependenciesFilePath.empty())
+      nameTrackers.resize(opts.BatchPrimaries.size());
+  } else if (!opts.ReferenceDependenciesFilePath.empty()) {
+    nameTrackers.resize(1);
+  }
+  if (!nameTrackers.empty()) {
+    SmallVector<ReferencedNameTracker *, 1> trackerPointers;
+    for (auto &tracker : nameTrackers)
+      trackerPointers.push_back(&tracker);
+    Instance.setReferencedNameTrackers(trackerPointers);
+  }
 
   if (Action == FrontendOptions::DumpParse ||
       Action == FrontendOptions::DumpInterfaceHash)
@@ -802,12 +1163,49 @@ static bool performCompile(CompilerInstance &Instance,
   if (opts.PrintClangStats && Context.getClangModuleLoader())
     Context.getClangModuleLoader()->printStatistics();
 
+  if (!opts.isBatchMode())
+    return performCompileStepsPostSema(Instance, Invocation, opts,
+                                       PrimarySourceFile, ReturnValue,
+                                       observer);
+
+  // In batch mode, each primary file goes through the rest of the pipeline
+  // on its own, writing its own outputs.
+  ArrayRef<SourceFile *> PrimarySourceFiles = Instance.getPrimarySourceFiles();
+  assert(PrimarySourceFiles.size() == opts.BatchPrimaries.size());
+  bool HadError = false;
+  for (unsigned i = 0, e = opts.BatchPrimaries.size(); i != e; ++i) {
+    assert(PrimarySourceFiles[i] && "batch primary is not a source file");
+    HadError |= performCompileStepsPostSema(Instance, Invocation,
+                                            opts.getOptionsForBatchPrimary(i),
+                                            PrimarySourceFiles[i],
+                                            ReturnValue, observer);
+  }
+  return HadError;
+}
+
+/// Emits the dependency files and runs SIL generation, optimization, and
+/// IR generation for \p PrimarySourceFile, or for the whole module if it is
+/// null, according to \p opts.
+/// \returns true on error
+static bool performCompileStepsPostSema(CompilerInstance &Instance,
+                                        CompilerInvocation &Invocation,
+                                        const FrontendOptions &opts,
+                                        SourceFile *PrimarySourceFile,
+                                        int &ReturnValue,
+                                        FrontendObserver *observer) {
+  FrontendOptions::ActionType Action = opts.RequestedAction;
+  ASTContext &Context = Instance.getASTContext();
+
+  // Take a copy, so that changes made for one primary file of a batch don't
+  // carry over to the next.
+  IRGenOptions IRGenOpts = Invocation.getIRGenOptions();
+
   if (!opts.DependenciesFilePath.empty())
     (void)emitMakeDependencies(Context.Diags, *Instance.getDependencyTracker(),
                                opts);
 
-  if (shouldTrackReferences)
-    emitReferenceDependencies(Context.Diags, Instance.getPrimarySourceFile(),
+  if (!opts.ReferenceDependenciesFilePath.empty())
+    emitReferenceDependencies(Context.Diags, PrimarySourceFile,
                               *Instance.getDependencyTracker(), opts);
 
   if (Context.hadError())
@@ -1168,9 +1566,9 @@ int swift::performFrontend(ArrayRef<const char *> Args,
   // CompilerInvocation::parseArgs are included in the serialized file.
   std::unique_ptr<DiagnosticConsumer> SerializedConsumer;
   {
-    const std::string &SerializedDiagnosticsPath =
-      Invocation.getFrontendOptions().SerializedDiagnosticsPath;
-    if (!SerializedDiagnosticsPath.empty()) {
+    auto createSerializedConsumer =
+        [&](const std::string &SerializedDiagnosticsPath)
+          -> std::unique_ptr<DiagnosticConsumer> {
       std::error_code EC;
       std::unique_ptr<llvm::raw_fd_ostream> OS;
       OS.reset(new llvm::raw_fd_ostream(SerializedDiagnosticsPath,
@@ -1181,11 +1579,31 @@ int swift::performFrontend(ArrayRef<const char *> Args,
         Instance.getDiags().diagnose(SourceLoc(),
                                      diag::cannot_open_serialized_file,
                                      SerializedDiagnosticsPath, EC.message());
-        return 1;
+        return nullptr;
       }
 
-      SerializedConsumer.reset(
+      return std::unique_ptr<DiagnosticConsumer>(
           serialized_diagnostics::createConsumer(std::move(OS)));
+    };
+
+    const FrontendOptions &opts = Invocation.getFrontendOptions();
+    if (opts.isBatchMode() && !opts.SerializedDiagnosticsPath.empty()) {
+      auto *BatchConsumer = new BatchSerializedDiagnosticConsumer();
+      SerializedConsumer.reset(BatchConsumer);
+      for (auto &primary : opts.BatchPrimaries) {
+        auto consumer =
+          createSerializedConsumer(primary.SerializedDiagnosticsPath);
+        if (!consumer)
+          return 1;
+        BatchConsumer->addConsumer(opts.InputFilenames[primary.InputIndex],
+                                   std::move(consumer));
+      }
+      Instance.addDiagnosticConsumer(SerializedConsumer.get());
+    } else if (!opts.SerializedDiagnosticsPath.empty()) {
+      SerializedConsumer =
+        createSerializedConsumer(opts.SerializedDiagnosticsPath);
+      if (!SerializedConsumer)
+        return 1;
       Instance.addDiagnosticConsumer(SerializedConsumer.get());
     }
   }
@@ -22,6 +22,7 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/TinyPtrVector.h"
@@ -2999,6 +3000,42 @@ void IRGenSILFunction::visitBranchInst(swift::BranchInst *i) {
   Builder.CreateBr(lbb.bb);
 }
 
+/// Returns the number of times the edge from \p From to \p To was taken
+/// according to profile data. That is only known if \p To has no other
+/// predecessors.
+static Optional<uint64_t> getEdgeProfileCount(SILBasicBlock *From,
+                                              SILBasicBlock *To) {
+  if (To->getSinglePredecessor() != From)
+    return None;
+  return To->getProfileCount();
+}
+
+/// Returns branch weights for \p i from profile data, or null if there are
+/// no counts for it.
+static llvm::MDNode *getBranchWeights(IRGenModule &IGM, CondBranchInst *i) {
+  SILBasicBlock *BB = i->getParent();
+  Optional<uint64_t> TrueCount = getEdgeProfileCount(BB, i->getTrueBB());
+  Optional<uint64_t> FalseCount = getEdgeProfileCount(BB, i->getFalseBB());
+
+  // If only one edge has a count, the other was taken the remaining times.
+  if (auto Count = BB->getProfileCount()) {
+    if (TrueCount && !FalseCount && *TrueCount <= *Count)
+      FalseCount = *Count - *TrueCount;
+    else if (FalseCount && !TrueCount && *FalseCount <= *Count)
+      TrueCount = *Count - *FalseCount;
+  }
+  if (!TrueCount || !FalseCount)
+    return nullptr;
+
+  // Branch weights are 32 bits wide; scale larger counts down.
+  unsigned Shift = 0;
+  while ((std::max(*TrueCount, *FalseCount) >> Shift) > UINT32_MAX)
+    ++Shift;
+  return llvm::MDBuilder(IGM.getLLVMContext())
+      .createBranchWeights(uint32_t(*TrueCount >> Shift),
+                           uint32_t(*FalseCount >> Shift));
+}
+
 void IRGenSILFunction::visitCondBranchInst(swift::CondBranchInst *i) {
   LoweredBB &trueBB = getLoweredBB(i->getTrueBB());
   LoweredBB &falseBB = getLoweredBB(i->getFalseBB());
@@ -3008,7 +3045,8 @@ void IRGenSILFunction::visitCondBranchInst(swift::CondBranchInst *i) {
   addIncomingSILArgumentsToPHINodes(*this, trueBB, i->getTrueArgs());
   addIncomingSILArgumentsToPHINodes(*this, falseBB, i->getFalseArgs());
 
-  Builder.CreateCondBr(condValue, trueBB.bb, falseBB.bb);
+  Builder.CreateCondBr(condValue, trueBB.bb, falseBB.bb,
+                       getBranchWeights(IGM, i));
 }
 
 void IRGenSILFunction::visitRetainValueInst(swift::RetainValueInst *i) {
@@ -1808,9 +1808,23 @@ ParserStatus Parser::parseDecl(ParseDeclOptions Flags,
     return IfConfigResult;
   }
 
+  // Fingerprints are only needed to track dependencies, so only record them
+  // for files whose references are being tracked.
+  bool RecordFingerprint =
+      IsParsingInterfaceTokens && SF.getReferencedNameTracker();
+  SmallVector<const Decl *, 2> FingerprintedDecls;
+  if (RecordFingerprint)
+    SF.beginDeclFingerprint();
+  SWIFT_DEFER {
+    if (RecordFingerprint)
+      SF.endDeclFingerprint(FingerprintedDecls);
+  };
+
   Decl* LastDecl = nullptr;
   auto InternalHandler  = [&](Decl *D) {
     LastDecl = D;
+    if (RecordFingerprint)
+      FingerprintedDecls.push_back(D);
     Handler(D);
   };
 
@@ -333,6 +333,14 @@ SourceLoc Parser::consumeToken() {
 
   if (IsParsingInterfaceTokens && !Tok.getText().empty()) {
     SF.recordInterfaceToken(Tok.getText());
+    if (Tok.is(tok::identifier)) {
+      StringRef Name = Tok.getText();
+      if (Tok.isEscapedIdentifier())
+        Name = Name.drop_front().drop_back();
+      SF.recordInterfaceReference(Name);
+    } else if (Tok.isAnyOperator()) {
+      SF.recordInterfaceReference(Tok.getText());
+    }
   }
 
   L->lex(Tok);
@@ -156,6 +156,7 @@ SILBasicBlock *SILBasicBlock::splitBasicBlock(iterator I) {
   // Move all of the specified instructions from the original basic block into
   // the new basic block.
   New->InstList.splice(New->end(), InstList, I, end());
+  New->ProfileCount = ProfileCount;
   return New;
 }
 
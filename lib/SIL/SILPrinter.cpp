@@ -403,6 +403,7 @@ class SILPrinter : public SILVisitor<SILPrinter> {
   }
   SIMPLE_PRINTER(char)
   SIMPLE_PRINTER(unsigned)
+  SIMPLE_PRINTER(uint64_t)
   SIMPLE_PRINTER(StringRef)
   SIMPLE_PRINTER(Identifier)
   SIMPLE_PRINTER(ID)
@@ -535,6 +536,14 @@ public:
       for (auto Id : PredIDs)
         *this << ' ' << Id;
     }
+
+    if (auto Count = BB->getProfileCount()) {
+      if (BB->pred_empty())
+        PrintState.OS.PadToColumn(50);
+      else
+        *this << ' ';
+      *this << "// count: " << *Count;
+    }
     *this << '\n';
 
     for (const SILInstruction &I : *BB) {
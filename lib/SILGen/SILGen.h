@@ -25,6 +25,10 @@
 #include "llvm/ADT/DenseMap.h"
 #include <deque>
 
+namespace llvm {
+  class IndexedInstrProfReader;
+}
+
 namespace swift {
   class SILBasicBlock;
 
@@ -59,6 +63,10 @@ public:
   /// disabled.
   std::unique_ptr<SILGenProfiling> Profiler;
 
+  /// The reader for the profile data passed with -profile-use, or null if
+  /// there is none.
+  std::unique_ptr<llvm::IndexedInstrProfReader> PGOReader;
+
   /// Mapping from SILDeclRefs to emitted SILFunctions.
   llvm::DenseMap<SILDeclRef, SILFunction*> emittedFunctions;
   /// Mapping from ProtocolConformances to emitted SILWitnessTables.
@@ -23,6 +23,7 @@
 #include "llvm/ProfileData/CoverageMapping.h"
 #include "llvm/ProfileData/CoverageMappingWriter.h"
 #include "llvm/ProfileData/InstrProf.h"
+#include "llvm/ProfileData/InstrProfReader.h"
 
 #include <forward_list>
 
@@ -63,7 +64,7 @@ static void walkForProfiling(AbstractFunctionDecl *Root, ASTWalker &Walker) {
 ProfilerRAII::ProfilerRAII(SILGenModule &SGM, AbstractFunctionDecl *D)
     : SGM(SGM), PreviousProfiler(std::move(SGM.Profiler)) {
   const auto &Opts = SGM.M.getOptions();
-  if (!Opts.GenerateProfile || isUnmappedDecl(D))
+  if ((!Opts.GenerateProfile && !SGM.PGOReader) || isUnmappedDecl(D))
     return;
   SGM.Profiler =
       llvm::make_unique<SILGenProfiling>(SGM, Opts.EmitProfileCoverageMapping);
@@ -692,6 +693,21 @@ void SILGenProfiling::assignRegionCounters(AbstractFunctionDecl *Root) {
                                    getEquivalentPGOLinkage(CurrentFuncLinkage)),
                                FunctionHash, RegionCounterMap, CurrentFileName);
   }
+
+  if (SGM.PGOReader) {
+    std::string PGOFuncName = llvm::getPGOFuncName(
+        CurrentFuncName, getEquivalentPGOLinkage(CurrentFuncLinkage),
+        CurrentFileName);
+    // Functions that are not in the profile, or whose counters don't match
+    // it, are left without counts.
+    if (auto E = SGM.PGOReader->getFunctionCounts(PGOFuncName, FunctionHash,
+                                                  RegionCounts)) {
+      llvm::consumeError(std::move(E));
+      RegionCounts.clear();
+    } else if (RegionCounts.size() != NumRegionCounters) {
+      RegionCounts.clear();
+    }
+  }
 }
 
 static SILLocation getLocation(ASTNode Node) {
@@ -712,6 +728,19 @@ void SILGenProfiling::emitCounterIncrement(SILGenBuilder &Builder,ASTNode Node){
   assert(CounterIt != RegionCounterMap.end() &&
          "cannot increment non-existent counter");
 
+  // The counter is incremented each time the current block is entered, so its
+  // value is the block's execution count.
+  if (!RegionCounts.empty() && Builder.hasValidInsertionPoint()) {
+    uint64_t Count = RegionCounts[CounterIt->second];
+    SILBasicBlock *BB = Builder.getInsertionBB();
+    BB->setProfileCount(Count);
+    if (BB->isEntry())
+      SGM.M.noteProfileEntryCount(Count);
+  }
+
+  if (!SGM.M.getOptions().GenerateProfile)
+    return;
+
   auto Int32Ty = SGM.Types.getLoweredType(BuiltinIntegerType::get(32, C));
   auto Int64Ty = SGM.Types.getLoweredType(BuiltinIntegerType::get(64, C));
 
@@ -43,6 +43,9 @@ private:
   uint64_t FunctionHash;
   llvm::DenseMap<ASTNode, unsigned> RegionCounterMap;
 
+  // The current function's counter values from -profile-use, if any.
+  std::vector<uint64_t> RegionCounts;
+
   std::vector<std::tuple<std::string, uint64_t, std::string>> CoverageData;
 
 public:
@@ -52,7 +55,8 @@ public:
 
   bool hasRegionCounters() const { return NumRegionCounters != 0; }
 
-  /// Emit SIL to increment the counter for \c Node.
+  /// Emit SIL to increment the counter for \c Node, and attach the counter's
+  /// value from -profile-use to the current block.
   void emitCounterIncrement(SILGenBuilder &Builder, ASTNode Node);
 
 private:
@@ -107,10 +107,14 @@ ColdBlockInfo::BranchHint ColdBlockInfo::getBranchHint(SILValue Cond,
 }
 
 /// \return true if the CFG edge FromBB->ToBB is directly gated by a _slowPath
-/// branch hint.
+/// branch hint, or if profile data says that ToBB was never executed.
 bool ColdBlockInfo::isSlowPath(const SILBasicBlock *FromBB,
                                const SILBasicBlock *ToBB,
                                int recursionDepth) {
+  // Measured counts take precedence over branch hints.
+  if (auto Count = ToBB->getProfileCount())
+    return *Count == 0;
+
   auto *CBI = dyn_cast<CondBranchInst>(FromBB->getTerminator());
   if (!CBI)
     return false;
@@ -127,7 +131,8 @@ bool ColdBlockInfo::isSlowPath(const SILBasicBlock *FromBB,
   return ToBB == ColdTarget;
 }
 
-/// \return true if the given block is dominated by a _slowPath branch hint.
+/// \return true if the given block is dominated by a _slowPath branch hint, or
+/// by a block which profile data says was never executed.
 ///
 /// Cache all blocks visited to avoid introducing quadratic behavior.
 bool ColdBlockInfo::isCold(const SILBasicBlock *BB, int recursionDepth) {
@@ -142,6 +147,11 @@ bool ColdBlockInfo::isCold(const SILBasicBlock *BB, int recursionDepth) {
   if (!Node)
     return true;
 
+  if (auto Count = BB->getProfileCount()) {
+    ColdBlockMap[BB] = (*Count == 0);
+    return *Count == 0;
+  }
+
   std::vector<const SILBasicBlock*> DomChain;
   DomChain.push_back(BB);
   bool IsCold = false;
@@ -156,6 +166,12 @@ bool ColdBlockInfo::isCold(const SILBasicBlock *BB, int recursionDepth) {
       IsCold = I->second;
       break;
     }
+    // Like a cached block, a block with a profile count decides for the blocks
+    // it dominates: they are cold if it was never executed.
+    if (auto Count = Node->getBlock()->getProfileCount()) {
+      IsCold = (*Count == 0);
+      break;
+    }
     DomChain.push_back(Node->getBlock());
     Node = Node->getIDom();
   }
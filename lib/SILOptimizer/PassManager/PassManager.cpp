@@ -14,6 +14,7 @@
 
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Basic/JSONSerialization.h"
 #include "swift/SIL/SILFunction.h"
 #include "swift/SIL/SILModule.h"
 #include "swift/SILOptimizer/Analysis/BasicCalleeAnalysis.h"
@@ -22,12 +23,17 @@
 #include "swift/SILOptimizer/PassManager/Transforms.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace swift;
 
@@ -45,6 +51,17 @@ llvm::cl::opt<bool> SILPrintPassTime(
     "sil-print-pass-time", llvm::cl::init(false),
     llvm::cl::desc("Print the execution time of each SIL pass"));
 
+llvm::cl::opt<std::string> SILOptProfile(
+    "sil-opt-profile", llvm::cl::init(""),
+    llvm::cl::desc("Write a JSON profile of each SIL pass run on each "
+                   "function to <file>"),
+    llvm::cl::value_desc("file"));
+
+llvm::cl::opt<unsigned> SILOptProfileTop(
+    "sil-opt-profile-top", llvm::cl::init(10),
+    llvm::cl::desc("With -sil-opt-profile, print the <N> most expensive "
+                   "pass/function pairs"));
+
 llvm::cl::opt<unsigned> SILNumOptPassesToRun(
     "sil-opt-pass-count", llvm::cl::init(UINT_MAX),
     llvm::cl::desc("Stop optimizing after <N> optimization passes"));
@@ -95,6 +112,11 @@ llvm::cl::opt<bool> SILDisableSkippingPasses(
     "sil-disable-skipping-passes", llvm::cl::init(false),
     llvm::cl::desc("Do not skip passes even if nothing was changed"));
 
+llvm::cl::opt<bool> SILVerifySkippedPasses(
+    "sil-verify-skipped-passes", llvm::cl::init(false),
+    llvm::cl::desc("Run passes that would be skipped because nothing was "
+                   "changed, and check that they don't change anything"));
+
 static llvm::ManagedStatic<std::vector<unsigned>> DebugPassNumbers;
 
 namespace {
@@ -118,6 +140,200 @@ struct DebugOnlyPassNumberOpt {
 
 static DebugOnlyPassNumberOpt DebugOnlyPassNumberOptLoc;
 
+//===----------------------------------------------------------------------===//
+//                           Optimizer profile
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// What the optimizer profile records about one pass running on one
+/// function, or on the whole module, summed over all the times it ran.
+struct PassProfileEntry {
+  std::string Pass;
+  /// Empty for module passes.
+  std::string Function;
+  uint64_t NumRuns = 0;
+  uint64_t Nanoseconds = 0;
+  uint64_t InstructionsBefore = 0;
+  uint64_t InstructionsAfter = 0;
+  uint64_t NumInvalidations = 0;
+  /// The largest amount the module's allocator grew by in a single run.
+  uint64_t PeakAllocatedBytes = 0;
+};
+
+/// The profile written by -sil-opt-profile.
+///
+/// The profile covers every pass manager created by the process, so it is
+/// written when the process shuts down.
+class PassProfile {
+  std::vector<PassProfileEntry> Entries;
+  llvm::StringMap<unsigned> EntryIndices;
+
+  void write(StringRef Path);
+  void printSummary(llvm::raw_ostream &OS, unsigned NumEntries);
+
+public:
+  /// Returns the index of the entry for \p Pass running on \p Function.
+  unsigned getEntryIndex(StringRef Pass, StringRef Function) {
+    std::string Key = Pass.str();
+    Key += '\0';
+    Key += Function;
+    auto Inserted = EntryIndices.insert({Key, Entries.size()});
+    if (Inserted.second) {
+      Entries.emplace_back();
+      Entries.back().Pass = Pass.str();
+      Entries.back().Function = Function.str();
+    }
+    return Inserted.first->getValue();
+  }
+
+  PassProfileEntry &getEntry(unsigned Index) { return Entries[Index]; }
+
+  ~PassProfile() {
+    if (Entries.empty())
+      return;
+    write(SILOptProfile);
+    if (SILOptProfileTop != 0)
+      printSummary(llvm::errs(), SILOptProfileTop);
+  }
+};
+
+} // end anonymous namespace
+
+static llvm::ManagedStatic<PassProfile> OptProfile;
+
+namespace swift {
+namespace json {
+template <> struct ObjectTraits<PassProfileEntry> {
+  static void mapping(Output &out, PassProfileEntry &value) {
+    out.mapRequired("pass", value.Pass);
+    out.mapOptional("function", value.Function, std::string());
+    out.mapRequired("runs", value.NumRuns);
+    out.mapRequired("time_ns", value.Nanoseconds);
+    out.mapRequired("instructions_before", value.InstructionsBefore);
+    out.mapRequired("instructions_after", value.InstructionsAfter);
+    out.mapRequired("invalidations", value.NumInvalidations);
+    out.mapRequired("peak_allocated_bytes", value.PeakAllocatedBytes);
+  }
+};
+
+template <> struct ArrayTraits<std::vector<PassProfileEntry>> {
+  static size_t size(Output &out, std::vector<PassProfileEntry> &seq) {
+    return seq.size();
+  }
+  static PassProfileEntry &element(Output &out,
+                                   std::vector<PassProfileEntry> &seq,
+                                   size_t index) {
+    return seq[index];
+  }
+};
+} // end namespace json
+} // end namespace swift
+
+void PassProfile::write(StringRef Path) {
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+  if (EC) {
+    llvm::errs() << "error: cannot write SIL optimizer profile to '" << Path
+                 << "': " << EC.message() << "\n";
+    return;
+  }
+  json::Output JOS(OS);
+  JOS << Entries;
+  OS << "\n";
+}
+
+void PassProfile::printSummary(llvm::raw_ostream &OS, unsigned NumEntries) {
+  std::vector<const PassProfileEntry *> Sorted;
+  for (const PassProfileEntry &Entry : Entries)
+    Sorted.push_back(&Entry);
+  // Sort by time, and otherwise keep the order the entries were created in.
+  std::stable_sort(Sorted.begin(), Sorted.end(),
+                   [](const PassProfileEntry *LHS,
+                      const PassProfileEntry *RHS) {
+    return LHS->Nanoseconds > RHS->Nanoseconds;
+  });
+  if (Sorted.size() > NumEntries)
+    Sorted.resize(NumEntries);
+
+  OS << "*** Most expensive SIL passes ***\n";
+  OS << "  Time (ms)  Runs  Instructions  Pass, Function\n";
+  for (const PassProfileEntry *Entry : Sorted) {
+    int64_t Delta = int64_t(Entry->InstructionsAfter) -
+                    int64_t(Entry->InstructionsBefore);
+    OS << llvm::format("%11.3f", Entry->Nanoseconds / 1e6)
+       << llvm::format("%6llu", (unsigned long long)Entry->NumRuns)
+       << llvm::format("%+14lld", (long long)Delta)
+       << "  " << Entry->Pass;
+    if (!Entry->Function.empty())
+      OS << ", " << Entry->Function;
+    OS << "\n";
+  }
+}
+
+/// Returns the number of instructions in \p F, or in all of \p M if \p F
+/// is null.
+static uint64_t countInstructions(SILModule &M, SILFunction *F) {
+  uint64_t Count = 0;
+  auto countIn = [&](SILFunction &Fn) {
+    for (auto &B : Fn)
+      Count += std::distance(B.begin(), B.end());
+  };
+  if (F) {
+    countIn(*F);
+  } else {
+    for (auto &Fn : M)
+      countIn(Fn);
+  }
+  return Count;
+}
+
+namespace {
+
+/// Measures one run of a pass for the optimizer profile, if there is one.
+class PassProfileRun {
+  SILModule &M;
+  SILFunction *F;
+  unsigned EntryIndex = 0;
+  bool IsProfiling;
+  size_t StartBytes = 0;
+  llvm::sys::TimeValue StartTime;
+
+public:
+  PassProfileRun(SILTransform *T, SILModule &M, SILFunction *F)
+      : M(M), F(F), IsProfiling(!SILOptProfile.empty()) {
+    if (!IsProfiling)
+      return;
+    EntryIndex = OptProfile->getEntryIndex(T->getName(),
+                                           F ? F->getName() : StringRef());
+    OptProfile->getEntry(EntryIndex).InstructionsBefore +=
+        countInstructions(M, F);
+    StartBytes = M.getNumAllocatedBytes();
+    StartTime = llvm::sys::TimeValue::now();
+  }
+
+  /// Records the run, which invalidated analyses \p NumInvalidations times.
+  void finish(unsigned NumInvalidations) {
+    if (!IsProfiling)
+      return;
+    // nanoseconds() is only the sub-second part, so convert the whole
+    // difference; passes that take longer than a second matter most here.
+    llvm::sys::TimeValue Delta = llvm::sys::TimeValue::now() - StartTime;
+    auto &Entry = OptProfile->getEntry(EntryIndex);
+    ++Entry.NumRuns;
+    Entry.Nanoseconds += uint64_t(Delta.seconds()) *
+                             llvm::sys::TimeValue::NANOSECONDS_PER_SECOND +
+                         Delta.nanoseconds();
+    Entry.InstructionsAfter += countInstructions(M, F);
+    Entry.NumInvalidations += NumInvalidations;
+    Entry.PeakAllocatedBytes =
+        std::max<uint64_t>(Entry.PeakAllocatedBytes,
+                           M.getNumAllocatedBytes() - StartBytes);
+  }
+};
+
+} // end anonymous namespace
+
 static llvm::cl::opt<DebugOnlyPassNumberOpt, true,
                      llvm::cl::parser<std::string>>
     DebugOnly("debug-only-pass-number",
@@ -283,9 +499,12 @@ void SILPassManager::runPassOnFunction(SILFunctionTransform *SFT,
 
   // If nothing changed since the last run of this pass, we can skip this
   // pass.
-  CompletedPasses &completedPasses = CompletedPassesMap[F];
-  if (completedPasses.test((size_t)SFT->getPassKind()) &&
-      !SILDisableSkippingPasses) {
+  auto CompletedKey = std::make_pair(F, (unsigned)SFT->getPassKind());
+  auto Completed = CompletedEpochs.find(CompletedKey);
+  bool CanSkip = Completed != CompletedEpochs.end() &&
+                 Completed->second == getModificationEpoch(F) &&
+                 !SILDisableSkippingPasses;
+  if (CanSkip && !SILVerifySkippedPasses) {
     if (SILPrintPassName)
       llvm::dbgs() << "  (Skip) Stage: " << StageName
                    << " Pass: " << SFT->getName()
@@ -315,6 +534,8 @@ void SILPassManager::runPassOnFunction(SILFunctionTransform *SFT,
     F->dump(getOptions().EmitVerboseSIL);
   }
 
+  NumCurrentPassInvalidations = 0;
+  PassProfileRun ProfileRun(SFT, *Mod, F);
   llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
   Mod->registerDeleteNotificationHandler(SFT);
   if (breakBeforeRunning(F->getName(), SFT->getName()))
@@ -322,6 +543,7 @@ void SILPassManager::runPassOnFunction(SILFunctionTransform *SFT,
   SFT->run();
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
   Mod->removeDeleteNotificationHandler(SFT);
+  ProfileRun.finish(NumCurrentPassInvalidations);
 
   if (SILPrintPassTime) {
     auto Delta =
@@ -338,9 +560,16 @@ void SILPassManager::runPassOnFunction(SILFunctionTransform *SFT,
     F->dump(getOptions().EmitVerboseSIL);
   }
 
-  // Remember if this pass didn't change anything.
-  if (!CurrentPassHasInvalidated)
-    completedPasses.set((size_t)SFT->getPassKind());
+  if (CanSkip && CurrentPassHasInvalidated) {
+    llvm::errs() << "SIL pass '" << SFT->getName() << "' changed function '"
+                 << F->getName() << "', although nothing had changed since "
+                 << "it last ran on it\n";
+    llvm::report_fatal_error("skipped SIL pass would have changed a function");
+  }
+
+  // Remember if running this pass again wouldn't change anything.
+  if (!CurrentPassHasInvalidated || SFT->isIdempotent())
+    CompletedEpochs[CompletedKey] = getModificationEpoch(F);
 
   if (getOptions().VerifyAll &&
       (CurrentPassHasInvalidated || SILVerifyWithoutInvalidation)) {
@@ -439,12 +668,15 @@ void SILPassManager::runModulePass(SILModuleTransform *SMT) {
     printModule(Mod, Options.EmitVerboseSIL);
   }
 
+  NumCurrentPassInvalidations = 0;
+  PassProfileRun ProfileRun(SMT, *Mod, nullptr);
   llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
   Mod->registerDeleteNotificationHandler(SMT);
   SMT->run();
   Mod->removeDeleteNotificationHandler(SMT);
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
+  ProfileRun.finish(NumCurrentPassInvalidations);
 
   if (SILPrintPassTime) {
     auto Delta = llvm::sys::TimeValue::now().nanoseconds() -
@@ -349,6 +349,9 @@ class SILCombine : public SILFunctionTransform {
   
   virtual bool needsNotifications() override { return true; }
 
+  /// The combiner iterates until it doesn't change anything.
+  bool isIdempotent() override { return true; }
+
   StringRef getName() override { return "SIL Combine"; }
 };
 
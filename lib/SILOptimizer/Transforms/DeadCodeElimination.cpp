@@ -176,6 +176,10 @@ class DCE : public SILFunctionTransform {
   SILBasicBlock *nearestUsefulPostDominator(SILBasicBlock *Block);
   void replaceBranchWithJump(SILInstruction *Inst, SILBasicBlock *Block);
 
+  /// Liveness is computed for the whole function before anything is removed,
+  /// so everything that is dead is removed in one run.
+  bool isIdempotent() override { return true; }
+
   StringRef getName() override { return "Dead Code Elimination"; }
 };
 
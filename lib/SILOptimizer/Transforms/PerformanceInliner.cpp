@@ -1021,6 +1021,15 @@ class SILPerformanceInliner {
     /// Configuration for the caller block limit.
     BlockLimitDenominator = 10000,
 
+    /// A call site is hot if the profile data says it was executed at least
+    /// 1/HotCallSiteDenominator times as often as the hottest function was
+    /// entered.
+    HotCallSiteDenominator = 100,
+
+    /// The additional weight of a hot call site, as if it was in two more
+    /// nested loops.
+    HotCallSiteWeight = 2 * ShortestPathAnalysis::SingleLoopWeight,
+
     /// The assumed execution length of a function call.
     DefaultApplyLength = 10
   };
@@ -1052,6 +1061,8 @@ class SILPerformanceInliner {
 
   bool isProfitableInColdBlock(FullApplySite AI, SILFunction *Callee);
 
+  int getProfileWeight(SILBasicBlock *BB);
+
   void visitColdBlocks(SmallVectorImpl<FullApplySite> &AppliesToInline,
                        SILBasicBlock *root, DominanceInfo *DT);
 
@@ -1338,6 +1349,21 @@ static void addWeightCorrection(FullApplySite FAS,
   }
 }
 
+/// Returns the additional weight for calls in \p BB if the profile data says
+/// that they are hot.
+///
+/// Calls which the profile data says were never executed don't need this:
+/// their blocks are cold, and are handled by visitColdBlocks.
+int SILPerformanceInliner::getProfileWeight(SILBasicBlock *BB) {
+  uint64_t MaxCount = BB->getModule().getMaxProfileEntryCount();
+  auto Count = BB->getProfileCount();
+  if (!Count || *Count == 0 || MaxCount == 0)
+    return 0;
+  if (*Count < MaxCount / HotCallSiteDenominator)
+    return 0;
+  return HotCallSiteWeight;
+}
+
 void SILPerformanceInliner::collectAppliesToInline(
     SILFunction *Caller, SmallVectorImpl<FullApplySite> &Applies) {
   DominanceInfo *DT = DA->get(Caller);
@@ -1406,7 +1432,8 @@ void SILPerformanceInliner::collectAppliesToInline(
           BlockWeight = SPA->getWeight(block, Weight(0, 0));
 
         // The actual weight including a possible weight correction.
-        Weight W(BlockWeight, WeightCorrections.lookup(AI));
+        Weight W(BlockWeight, WeightCorrections.lookup(AI) +
+                              getProfileWeight(block));
 
         if (isProfitableToInline(AI, W, constTracker, NumCallerBlocks))
           InitialCandidates.push_back(AI);
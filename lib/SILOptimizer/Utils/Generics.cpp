@@ -16,10 +16,17 @@
 #include "swift/SILOptimizer/Utils/Generics.h"
 #include "swift/SILOptimizer/Utils/GenericCloner.h"
 #include "swift/SIL/DebugUtils.h"
+#include "swift/SIL/SILArgument.h"
 #include "swift/AST/GenericEnvironment.h"
+#include "swift/AST/ResilienceExpansion.h"
 
 using namespace swift;
 
+llvm::cl::opt<bool> EnableLayoutSpecialization(
+    "enable-layout-specialization", llvm::cl::init(true),
+    llvm::cl::desc("Share the specializations of generic functions between "
+                   "class types which the function only moves around."));
+
 // Max depth of a bound generic which can be processed by the generic
 // specializer.
 // E.g. the depth of Array<Array<Array<T>>> is 3.
@@ -244,6 +251,140 @@ SILFunction *GenericFuncSpecializer::tryCreateSpecialization() {
   return SpecializedF;
 }
 
+// =============================================================================
+// Layout-based specialization
+// =============================================================================
+
+static bool mentionsType(Type Ty, CanType Target) {
+  return Ty.findIf([&](Type Sub) -> bool {
+    return Sub->getCanonicalType() == Target;
+  });
+}
+
+/// Returns true if \p F uses values of type \p Archetype only by moving,
+/// copying and destroying them, so that its code only depends on the layout
+/// of the archetype's replacement type.
+static bool usesOnlyLayoutOf(SILFunction *F, CanType Archetype) {
+  // Values of the archetype and their addresses are fine; values of types
+  // which are built from the archetype, like T.Type or Array<T>, are not.
+  auto isLayoutOnly = [&](SILType Ty) -> bool {
+    CanType RValueTy = Ty.getSwiftRValueType();
+    return RValueTy == Archetype || !mentionsType(RValueTy, Archetype);
+  };
+
+  for (SILBasicBlock &BB : *F) {
+    for (SILArgument *Arg : BB.getBBArgs())
+      if (!isLayoutOnly(Arg->getType()))
+        return false;
+
+    for (SILInstruction &I : BB) {
+      if (I.hasValue() && !isLayoutOnly(I.getType()))
+        return false;
+
+      // Existentials and casts record or check the dynamic type, even if they
+      // only use addresses of the archetype.
+      bool ChecksDynamicType =
+        isa<InitExistentialAddrInst>(I) || isa<InitExistentialRefInst>(I) ||
+        isa<InitExistentialMetatypeInst>(I) ||
+        isa<AllocExistentialBoxInst>(I) || isa<CheckedCastBranchInst>(I) ||
+        isa<CheckedCastAddrBranchInst>(I) ||
+        isa<UnconditionalCheckedCastInst>(I) ||
+        isa<UnconditionalCheckedCastAddrInst>(I);
+      if (ChecksDynamicType && I.hasValue() &&
+          mentionsType(I.getType().getSwiftRValueType(), Archetype))
+        return false;
+
+      for (const Operand &Op : I.getAllOperands()) {
+        SILType OpTy = Op.get()->getType();
+        if (!isLayoutOnly(OpTy) ||
+            (ChecksDynamicType &&
+             mentionsType(OpTy.getSwiftRValueType(), Archetype)))
+          return false;
+      }
+
+      // Builtins like sizeof and destroyArray only depend on the layout, but
+      // other generic callees could inspect the type.
+      if (auto Apply = ApplySite::isa(&I))
+        for (const Substitution &Sub : Apply.getSubstitutions())
+          if (mentionsType(Sub.getReplacement(), Archetype))
+            return false;
+    }
+  }
+  return true;
+}
+
+/// Returns true if \p Sig has a requirement on \p ParamTy.
+static bool hasRequirementsOn(GenericSignature *Sig,
+                              GenericTypeParamType *ParamTy) {
+  CanType CanParamTy = ParamTy->getCanonicalType();
+  for (const Requirement &Req : Sig->getRequirements()) {
+    if (Req.getKind() == RequirementKind::WitnessMarker)
+      continue;
+    if (mentionsType(Req.getFirstType(), CanParamTy))
+      return true;
+    if (Req.getSecondType() && mentionsType(Req.getSecondType(), CanParamTy))
+      return true;
+  }
+  return false;
+}
+
+/// Replaces the native class types in \p Subs, which the generic function
+/// \p F only moves around, with Builtin.NativeObject. All native class
+/// references have the same layout, so the resulting specialization of \p F
+/// can be shared between all of them.
+///
+/// \returns true and sets \p LayoutSubs if any substitution was replaced.
+static bool getLayoutSubstitutions(SILFunction *F, ArrayRef<Substitution> Subs,
+                                 llvm::SmallVectorImpl<Substitution> &LayoutSubs) {
+  GenericSignature *Sig = F->getLoweredFunctionType()->getGenericSignature();
+  GenericEnvironment *Env = F->getGenericEnvironment();
+  if (!EnableLayoutSpecialization || !Sig || !Env)
+    return false;
+
+  SmallVector<Type, 4> DependentTypes;
+  for (Type DepTy : Sig->getAllDependentTypes())
+    DependentTypes.push_back(DepTy);
+  if (DependentTypes.size() != Subs.size())
+    return false;
+
+  SILModule &M = F->getModule();
+  bool Changed = false;
+  LayoutSubs.assign(Subs.begin(), Subs.end());
+  for (unsigned Idx = 0, e = Subs.size(); Idx != e; ++Idx) {
+    auto *ParamTy = DependentTypes[Idx]->getAs<GenericTypeParamType>();
+    if (!ParamTy || !Subs[Idx].getConformances().empty())
+      continue;
+
+    Type Replacement = Subs[Idx].getReplacement();
+    if (!Replacement->getClassOrBoundGenericClass() ||
+        !Replacement->usesNativeReferenceCounting(ResilienceExpansion::Maximal))
+      continue;
+    if (hasRequirementsOn(Sig, ParamTy))
+      continue;
+
+    CanType Archetype = Env->mapTypeIntoContext(M.getSwiftModule(), ParamTy)
+                          ->getCanonicalType();
+    if (!usesOnlyLayoutOf(F, Archetype))
+      continue;
+
+    LayoutSubs[Idx] = Substitution(M.getASTContext().TheNativeObjectType, {});
+    Changed = true;
+  }
+  return Changed;
+}
+
+/// Casts \p V to \p Ty if a layout specialization's argument or result type
+/// differs from the type at the call site.
+static SILValue castForLayoutSpecialization(SILBuilder &Builder,
+                                            SILLocation Loc, SILValue V,
+                                            SILType Ty) {
+  if (V->getType() == Ty)
+    return V;
+  if (Ty.isAddress())
+    return Builder.createUncheckedAddrCast(Loc, V, Ty);
+  return Builder.createUncheckedRefCast(Loc, V, Ty);
+}
+
 // =============================================================================
 // Apply substitution
 // =============================================================================
@@ -310,11 +451,26 @@ static ApplySite replaceWithSpecializedCallee(ApplySite AI,
     return NewTAI;
   }
   if (auto *A = dyn_cast<ApplyInst>(AI)) {
+    // A layout specialization takes Builtin.NativeObject instead of the class
+    // types at the call site.
+    auto CalleeTy = Callee->getType().castTo<SILFunctionType>();
+    SmallVector<SILType, 8> ArgTys;
+    for (const SILResultInfo &RI : CalleeTy->getIndirectResults())
+      ArgTys.push_back(RI.getSILType());
+    for (const SILParameterInfo &PI : CalleeTy->getParameters())
+      ArgTys.push_back(PI.getSILType());
+    assert(ArgTys.size() == Arguments.size());
+    for (unsigned i = 0, e = Arguments.size(); i != e; ++i)
+      Arguments[i] = castForLayoutSpecialization(Builder, Loc, Arguments[i],
+                                                 ArgTys[i]);
+
     auto *NewAI = Builder.createApply(Loc, Callee, Arguments, A->isNonThrowing());
     if (StoreResultTo) {
       // Store the direct result to the original result address.
       fixUsedVoidType(A, Loc, Builder);
-      Builder.createStore(Loc, NewAI, StoreResultTo);
+      SILValue Result = castForLayoutSpecialization(
+          Builder, Loc, NewAI, StoreResultTo->getType().getObjectType());
+      Builder.createStore(Loc, Result, StoreResultTo);
     }
     A->replaceAllUsesWith(NewAI);
     return NewAI;
@@ -467,7 +623,15 @@ void swift::trySpecializeApplyOfGeneric(
   if (F->isFragile() && RefF->isFragile())
     Fragile = IsFragile;
 
-  ReabstractionInfo ReInfo(RefF, Apply.getSubstitutions());
+  // Try to share the specialization between class types. This is only done
+  // for full applies which don't throw, so that only the arguments and the
+  // result need to be cast at the call site.
+  ArrayRef<Substitution> Subs = Apply.getSubstitutions();
+  SmallVector<Substitution, 4> LayoutSubs;
+  if (isa<ApplyInst>(Apply) && getLayoutSubstitutions(RefF, Subs, LayoutSubs))
+    Subs = LayoutSubs;
+
+  ReabstractionInfo ReInfo(RefF, Subs);
   if (!ReInfo.getSpecializedType())
     return;
 
@@ -509,8 +673,7 @@ void swift::trySpecializeApplyOfGeneric(
     }
   }
 
-  GenericFuncSpecializer FuncSpecializer(RefF, Apply.getSubstitutions(),
-                                         Fragile, ReInfo);
+  GenericFuncSpecializer FuncSpecializer(RefF, Subs, Fragile, ReInfo);
   SILFunction *SpecializedF = FuncSpecializer.lookupSpecialization();
   if (SpecializedF) {
     // Even if the pre-specialization exists already, try to preserve it
@@ -339,6 +339,21 @@ public:
   }
 };
 
+/// Used to deserialize entries in an on-disk decl hash table with string
+/// keys, which are otherwise the same as those with identifier keys.
+class ModuleFile::DeclStringTableInfo : public ModuleFile::DeclTableInfo {
+public:
+  using external_key_type = StringRef;
+
+  internal_key_type GetInternalKey(external_key_type key) {
+    return key;
+  }
+
+  external_key_type GetExternalKey(internal_key_type key) {
+    return key;
+  }
+};
+
 /// Used to deserialize entries in the on-disk decl hash table.
 class ModuleFile::LocalDeclTableInfo {
 public:
@@ -388,6 +403,17 @@ ModuleFile::readDeclTable(ArrayRef<uint64_t> fields, StringRef blobData) {
                                                 base + sizeof(uint32_t), base));
 }
 
+std::unique_ptr<ModuleFile::SerializedDeclStringTable>
+ModuleFile::readDeclStringTable(ArrayRef<uint64_t> fields, StringRef blobData) {
+  uint32_t tableOffset;
+  index_block::DeclListLayout::readRecord(fields, tableOffset);
+  auto base = reinterpret_cast<const uint8_t *>(blobData.data());
+
+  using OwnedTable = std::unique_ptr<SerializedDeclStringTable>;
+  return OwnedTable(SerializedDeclStringTable::Create(base + tableOffset,
+    base + sizeof(uint32_t), base));
+}
+
 std::unique_ptr<ModuleFile::SerializedLocalDeclTable>
 ModuleFile::readLocalDeclTable(ArrayRef<uint64_t> fields, StringRef blobData) {
   uint32_t tableOffset;
@@ -486,20 +512,20 @@ bool ModuleFile::readIndexBlock(llvm::BitstreamCursor &cursor) {
 
       switch (kind) {
       case index_block::DECL_OFFSETS:
-        assert(blobData.empty());
-        Decls.assign(scratch.begin(), scratch.end());
+        if (!Decls.setRawOffsets(blobData))
+          return false;
         break;
       case index_block::DECL_CONTEXT_OFFSETS:
-        assert(blobData.empty());
-        DeclContexts.assign(scratch.begin(), scratch.end());
+        if (!DeclContexts.setRawOffsets(blobData))
+          return false;
         break;
       case index_block::TYPE_OFFSETS:
-        assert(blobData.empty());
-        Types.assign(scratch.begin(), scratch.end());
+        if (!Types.setRawOffsets(blobData))
+          return false;
         break;
       case index_block::IDENTIFIER_OFFSETS:
-        assert(blobData.empty());
-        Identifiers.assign(scratch.begin(), scratch.end());
+        if (!Identifiers.setRawOffsets(blobData))
+          return false;
         break;
       case index_block::TOP_LEVEL_DECLS:
         TopLevelDecls = readDeclTable(scratch, blobData);
@@ -511,11 +537,14 @@ bool ModuleFile::readIndexBlock(llvm::BitstreamCursor &cursor) {
         PrecedenceGroupDecls = readDeclTable(scratch, blobData);
         break;
       case index_block::EXTENSIONS:
-        ExtensionDecls = readDeclTable(scratch, blobData);
+        ExtensionDecls = readDeclStringTable(scratch, blobData);
         break;
       case index_block::CLASS_MEMBERS:
         ClassMembersByName = readDeclTable(scratch, blobData);
         break;
+      case index_block::CLASS_MEMBERS_BY_TYPE:
+        ClassMembersByTypeAndName = readDeclStringTable(scratch, blobData);
+        break;
       case index_block::OPERATOR_METHODS:
         OperatorMethodDecls = readDeclTable(scratch, blobData);
         break;
@@ -530,12 +559,12 @@ bool ModuleFile::readIndexBlock(llvm::BitstreamCursor &cursor) {
         LocalTypeDecls = readLocalDeclTable(scratch, blobData);
         break;
       case index_block::LOCAL_DECL_CONTEXT_OFFSETS:
-        assert(blobData.empty());
-        LocalDeclContexts.assign(scratch.begin(), scratch.end());
+        if (!LocalDeclContexts.setRawOffsets(blobData))
+          return false;
         break;
       case index_block::NORMAL_CONFORMANCE_OFFSETS:
-        assert(blobData.empty());
-        NormalConformances.assign(scratch.begin(), scratch.end());
+        if (!NormalConformances.setRawOffsets(blobData))
+          return false;
         break;
 
       default:
@@ -1332,18 +1361,19 @@ void ModuleFile::lookupVisibleDecls(Module::AccessPathTy accessPath,
   }
 }
 
-void ModuleFile::loadExtensions(NominalTypeDecl *nominal) {
+void ModuleFile::loadExtensions(NominalTypeDecl *nominal,
+                                StringRef extensionTableKey) {
   PrettyModuleFileDeserialization stackEntry(*this);
   if (!ExtensionDecls)
     return;
 
-  auto iter = ExtensionDecls->find(nominal->getName());
+  auto iter = ExtensionDecls->find(extensionTableKey);
   if (iter == ExtensionDecls->end())
     return;
 
   for (auto item : *iter) {
-    if (item.first == getKindForTable(nominal))
-      (void)getDecl(item.second);
+    assert(item.first == getKindForTable(nominal));
+    (void)getDecl(item.second);
   }
 }
 
@@ -1387,6 +1417,25 @@ void ModuleFile::lookupClassMember(Module::AccessPathTy accessPath,
   PrettyModuleFileDeserialization stackEntry(*this);
   assert(accessPath.size() <= 1 && "can only refer to top-level decls");
 
+  if (!accessPath.empty()) {
+    // Only look at the members of the type named by the access path.
+    if (!ClassMembersByTypeAndName)
+      return;
+
+    auto iter = ClassMembersByTypeAndName->find(
+        getClassMemberTableKey(accessPath.front().first.str(),
+                               name.getBaseName().str()));
+    if (iter == ClassMembersByTypeAndName->end())
+      return;
+
+    for (auto item : *iter) {
+      auto vd = cast<ValueDecl>(getDecl(item.second));
+      if (vd->getFullName().matchesRef(name))
+        results.push_back(vd);
+    }
+    return;
+  }
+
   if (!ClassMembersByName)
     return;
 
@@ -1394,37 +1443,6 @@ void ModuleFile::lookupClassMember(Module::AccessPathTy accessPath,
   if (iter == ClassMembersByName->end())
     return;
 
-  if (!accessPath.empty()) {
-    // As a hack to avoid completely redoing how the module is indexed, we take
-    // the simple-name-based lookup then filter by the compound name if we have
-    // one.
-    if (name.isSimpleName()) {
-      for (auto item : *iter) {
-        auto vd = cast<ValueDecl>(getDecl(item.second));
-        auto dc = vd->getDeclContext();
-        while (!dc->getParent()->isModuleScopeContext())
-          dc = dc->getParent();
-        if (auto nominal = dc->getAsNominalTypeOrNominalTypeExtensionContext())
-          if (nominal->getName() == accessPath.front().first)
-            results.push_back(vd);
-      }
-    } else {
-      for (auto item : *iter) {
-        auto vd = cast<ValueDecl>(getDecl(item.second));
-        if (!vd->getFullName().matchesRef(name))
-          continue;
-        
-        auto dc = vd->getDeclContext();
-        while (!dc->getParent()->isModuleScopeContext())
-          dc = dc->getParent();
-        if (auto nominal = dc->getAsNominalTypeOrNominalTypeExtensionContext())
-          if (nominal->getName() == accessPath.front().first)
-            results.push_back(vd);
-      }
-    }
-    return;
-  }
-
   for (auto item : *iter) {
     auto vd = cast<ValueDecl>(getDecl(item.second));
     results.push_back(vd);
@@ -1436,24 +1454,27 @@ void ModuleFile::lookupClassMembers(Module::AccessPathTy accessPath,
   PrettyModuleFileDeserialization stackEntry(*this);
   assert(accessPath.size() <= 1 && "can only refer to top-level decls");
 
-  if (!ClassMembersByName)
-    return;
-
   if (!accessPath.empty()) {
-    for (const auto &list : ClassMembersByName->data()) {
-      for (auto item : list) {
-        auto vd = cast<ValueDecl>(getDecl(item.second));
-        auto dc = vd->getDeclContext();
-        while (!dc->getParent()->isModuleScopeContext())
-          dc = dc->getParent();
-        if (auto nominal = dc->getAsNominalTypeOrNominalTypeExtensionContext())
-          if (nominal->getName() == accessPath.front().first)
-            consumer.foundDecl(vd, DeclVisibilityKind::DynamicLookup);
-      }
+    // Only look at the members of the type named by the access path, which
+    // are the entries whose keys start with its name.
+    if (!ClassMembersByTypeAndName)
+      return;
+
+    std::string prefix =
+        getClassMemberTableKey(accessPath.front().first.str(), "");
+    for (StringRef key : ClassMembersByTypeAndName->keys()) {
+      if (!key.startswith(prefix))
+        continue;
+      for (auto item : *ClassMembersByTypeAndName->find(key))
+        consumer.foundDecl(cast<ValueDecl>(getDecl(item.second)),
+                           DeclVisibilityKind::DynamicLookup);
     }
     return;
   }
 
+  if (!ClassMembersByName)
+    return;
+
   for (const auto &list : ClassMembersByName->data()) {
     for (auto item : list)
       consumer.foundDecl(cast<ValueDecl>(getDecl(item.second)),
@@ -71,7 +71,7 @@ namespace {
   /// Used to serialize the on-disk decl hash table.
   class DeclTableInfo {
   public:
-    using key_type = Identifier;
+    using key_type = StringRef;
     using key_type_ref = key_type;
     using data_type = Serializer::DeclTableData;
     using data_type_ref = const data_type &;
@@ -80,13 +80,13 @@ namespace {
 
     hash_value_type ComputeHash(key_type_ref key) {
       assert(!key.empty());
-      return llvm::HashString(key.str());
+      return llvm::HashString(key);
     }
 
     std::pair<unsigned, unsigned> EmitKeyDataLength(raw_ostream &out,
                                                     key_type_ref key,
                                                     data_type_ref data) {
-      uint32_t keyLength = key.str().size();
+      uint32_t keyLength = key.size();
       uint32_t dataLength = (sizeof(uint32_t) + 1) * data.size();
       endian::Writer<little> writer(out);
       writer.write<uint16_t>(keyLength);
@@ -95,7 +95,7 @@ namespace {
     }
 
     void EmitKey(raw_ostream &out, key_type_ref key, unsigned len) {
-      out << key.str();
+      out << key;
     }
 
     void EmitData(raw_ostream &out, key_type_ref key, data_type_ref data,
@@ -475,6 +475,7 @@ void Serializer::writeBlockInfoBlock() {
   BLOCK_RECORD(index_block, LOCAL_TYPE_DECLS);
   BLOCK_RECORD(index_block, NORMAL_CONFORMANCE_OFFSETS);
   BLOCK_RECORD(index_block, PRECEDENCE_GROUPS);
+  BLOCK_RECORD(index_block, CLASS_MEMBERS_BY_TYPE);
 
   BLOCK(SIL_BLOCK);
   BLOCK_RECORD(sil_block, SIL_FUNCTION);
@@ -1272,6 +1273,17 @@ void Serializer::writeMembers(DeclRange members, bool isClass) {
         if (VD->canBeAccessedByDynamicLookup()) {
           auto &list = ClassMembersByName[VD->getName()];
           list.push_back({getKindForTable(VD), memberID});
+
+          const DeclContext *DC = VD->getDeclContext();
+          while (!DC->getParent()->isModuleScopeContext())
+            DC = DC->getParent();
+          auto *type = DC->getAsNominalTypeOrNominalTypeExtensionContext();
+          if (type) {
+            auto key = getClassMemberTableKey(type->getName().str(),
+                                              VD->getName().str());
+            ClassMembersByTypeAndName[key].push_back({getKindForTable(VD),
+                                                      memberID});
+          }
         }
       }
     }
@@ -3376,14 +3388,32 @@ void Serializer::writeAllIdentifiers() {
 
 void Serializer::writeOffsets(const index_block::OffsetsLayout &Offsets,
                               const std::vector<BitOffset> &values) {
-  Offsets.emit(ScratchRecord, getOffsetRecordCode(values), values);
+  // The offsets are stored as a blob so that the reader can use them
+  // directly from the module's buffer, without decoding every one on load.
+  llvm::SmallString<4096> blob;
+  {
+    llvm::raw_svector_ostream blobStream(blob);
+    endian::Writer<little> writer(blobStream);
+    for (BitOffset offset : values)
+      writer.write<uint32_t>(offset);
+  }
+  Offsets.emit(ScratchRecord, getOffsetRecordCode(values), blob);
+}
+
+static StringRef getDeclTableKey(Identifier key) {
+  return key.str();
+}
+
+static StringRef getDeclTableKey(StringRef key) {
+  return key;
 }
 
 /// Writes an in-memory decl table to an on-disk representation, using the
 /// given layout.
+template <typename Table>
 static void writeDeclTable(const index_block::DeclListLayout &DeclList,
                            index_block::RecordKind kind,
-                           const Serializer::DeclTable &table) {
+                           const Table &table) {
   if (table.empty())
     return;
 
@@ -3393,7 +3423,7 @@ static void writeDeclTable(const index_block::DeclListLayout &DeclList,
   {
     llvm::OnDiskChainedHashTableGenerator<DeclTableInfo> generator;
     for (auto &entry : table)
-      generator.insert(entry.first, entry.second);
+      generator.insert(getDeclTableKey(entry.first), entry.second);
 
     llvm::raw_svector_ostream blobStream(hashTableBlob);
     // Make sure that no bucket is at offset 0
@@ -3925,8 +3955,9 @@ static void addOperatorsAndTopLevel(Serializer &S, Range members,
 }
 
 void Serializer::writeAST(ModuleOrSourceFile DC) {
-  DeclTable topLevelDecls, extensionDecls, operatorDecls, operatorMethodDecls;
+  DeclTable topLevelDecls, operatorDecls, operatorMethodDecls;
   DeclTable precedenceGroupDecls;
+  DeclStringTable extensionDecls;
   ObjCMethodTable objcMethods;
   LocalTypeHashTableGenerator localTypeGenerator;
   bool hasLocalTypes = false;
@@ -3954,7 +3985,7 @@ void Serializer::writeAST(ModuleOrSourceFile DC) {
       } else if (auto ED = dyn_cast<ExtensionDecl>(D)) {
         Type extendedTy = ED->getExtendedType();
         const NominalTypeDecl *extendedNominal = extendedTy->getAnyNominal();
-        extensionDecls[extendedNominal->getName()]
+        extensionDecls[getExtensionTableKey(extendedNominal)]
           .push_back({ getKindForTable(extendedNominal), addDeclRef(D) });
       } else if (auto OD = dyn_cast<OperatorDecl>(D)) {
         operatorDecls[OD->getName()]
@@ -4025,6 +4056,8 @@ void Serializer::writeAST(ModuleOrSourceFile DC) {
     writeDeclTable(DeclList, index_block::PRECEDENCE_GROUPS, precedenceGroupDecls);
     writeDeclTable(DeclList, index_block::EXTENSIONS, extensionDecls);
     writeDeclTable(DeclList, index_block::CLASS_MEMBERS, ClassMembersByName);
+    writeDeclTable(DeclList, index_block::CLASS_MEMBERS_BY_TYPE,
+                   ClassMembersByTypeAndName);
     writeDeclTable(DeclList, index_block::OPERATOR_METHODS, operatorMethodDecls);
     if (hasLocalTypes)
       writeLocalDeclTable(DeclList, index_block::LOCAL_TYPE_DECLS,
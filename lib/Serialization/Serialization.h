@@ -113,6 +113,9 @@ public:
   /// table.
   using DeclTable = llvm::MapVector<Identifier, DeclTableData>;
 
+  /// Like DeclTable, for tables with keys that are not identifiers.
+  using DeclStringTable = llvm::MapVector<std::string, DeclTableData>;
+
   /// Returns the declaration the given generic parameter list is associated
   /// with.
   const Decl *getGenericContext(const GenericParamList *paramList);
@@ -129,6 +132,11 @@ private:
   /// This is used for id-style lookup.
   DeclTable ClassMembersByName;
 
+  /// The entries of ClassMembersByName, keyed by getClassMemberTableKey.
+  ///
+  /// This is used for id-style lookup restricted to a single type.
+  DeclStringTable ClassMembersByTypeAndName;
+
   /// The queue of types and decls that need to be serialized.
   ///
   /// This is a queue and not simply a vector because serializing one
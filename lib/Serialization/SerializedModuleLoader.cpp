@@ -19,9 +19,13 @@
 #include "swift/Basic/SourceManager.h"
 #include "swift/Basic/Version.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/Debug.h"
+#include <mutex>
 #include <system_error>
 
 using namespace swift;
@@ -36,6 +40,96 @@ SerializedModuleLoader::SerializedModuleLoader(ASTContext &ctx,
   : ModuleLoader(tracker), Ctx(ctx) {}
 SerializedModuleLoader::~SerializedModuleLoader() = default;
 
+namespace {
+/// A view of a buffer that may be shared by several modules.
+class SharedMemoryBuffer : public llvm::MemoryBuffer {
+  std::shared_ptr<llvm::MemoryBuffer> Underlying;
+
+public:
+  explicit SharedMemoryBuffer(std::shared_ptr<llvm::MemoryBuffer> underlying)
+      : Underlying(std::move(underlying)) {
+    init(Underlying->getBufferStart(), Underlying->getBufferEnd(),
+         /*RequiresNullTerminator=*/false);
+  }
+
+  const char *getBufferIdentifier() const override {
+    return Underlying->getBufferIdentifier();
+  }
+
+  BufferKind getBufferKind() const override {
+    return Underlying->getBufferKind();
+  }
+};
+
+/// Read-only mappings of module files, shared by every loader in the
+/// process.
+///
+/// The jobs of a batch and the ASTContexts of a SourceKit process tend to
+/// import the same modules over and over. Each import gets its own
+/// ModuleFile, but they all read from one mapping of the file as long as
+/// any of them is alive and the file has not changed on disk. Module files
+/// are replaced by renaming a new file over them rather than being written
+/// in place, so an existing mapping stays valid even if it is stale.
+class SharedModuleBuffers {
+  struct Entry {
+    std::weak_ptr<llvm::MemoryBuffer> Buffer;
+    uint64_t Size;
+    llvm::sys::TimeValue ModTime;
+  };
+
+  std::mutex Mutex;
+  llvm::StringMap<Entry> Entries;
+
+public:
+  static SharedModuleBuffers &get() {
+    static SharedModuleBuffers Instance;
+    return Instance;
+  }
+
+  /// Returns a buffer for the file at \p Path, mapping it if no up-to-date
+  /// mapping exists yet.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> open(StringRef Path) {
+    int FD;
+    if (std::error_code EC = llvm::sys::fs::openFileForRead(Path, FD))
+      return EC;
+
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Result =
+        openFile(Path, FD);
+    llvm::sys::Process::SafelyCloseFileDescriptor(FD);
+    return Result;
+  }
+
+private:
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  openFile(StringRef Path, int FD) {
+    llvm::sys::fs::file_status Status;
+    if (std::error_code EC = llvm::sys::fs::status(FD, Status))
+      return EC;
+    if (llvm::sys::fs::is_directory(Status))
+      return std::make_error_code(std::errc::is_a_directory);
+
+    uint64_t Size = Status.getSize();
+    llvm::sys::TimeValue ModTime = Status.getLastModificationTime();
+
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Entry &Cached = Entries[Path];
+    std::shared_ptr<llvm::MemoryBuffer> Buffer = Cached.Buffer.lock();
+    if (!Buffer || Cached.Size != Size || Cached.ModTime != ModTime) {
+      // Without a null terminator, the file can be mapped whatever its size.
+      auto NewBuffer = llvm::MemoryBuffer::getOpenFile(
+          FD, Path, Size, /*RequiresNullTerminator=*/false);
+      if (!NewBuffer)
+        return NewBuffer.getError();
+      Buffer = std::move(NewBuffer.get());
+      Cached = { Buffer, Size, ModTime };
+    }
+
+    return std::unique_ptr<llvm::MemoryBuffer>(
+        new SharedMemoryBuffer(std::move(Buffer)));
+  }
+};
+} // end unnamed namespace
+
 static std::error_code
 openModuleFiles(StringRef DirName, StringRef ModuleFilename,
                 StringRef ModuleDocFilename,
@@ -47,7 +141,8 @@ openModuleFiles(StringRef DirName, StringRef ModuleFilename,
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    SharedModuleBuffers::get().open(StringRef(Scratch.data(),
+                                              Scratch.size()));
   if (!ModuleOrErr)
     return ModuleOrErr.getError();
 
@@ -56,7 +151,8 @@ openModuleFiles(StringRef DirName, StringRef ModuleFilename,
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleDocFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleDocOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    SharedModuleBuffers::get().open(StringRef(Scratch.data(),
+                                              Scratch.size()));
   if (!ModuleDocOrErr &&
       ModuleDocOrErr.getError() != std::errc::no_such_file_or_directory) {
     return ModuleDocOrErr.getError();
@@ -407,10 +503,13 @@ Module *SerializedModuleLoader::loadModule(SourceLoc importLoc,
 
 void SerializedModuleLoader::loadExtensions(NominalTypeDecl *nominal,
                                             unsigned previousGeneration) {
+  std::string extensionTableKey;
   for (auto &modulePair : LoadedModuleFiles) {
     if (modulePair.second <= previousGeneration)
       continue;
-    modulePair.first->loadExtensions(nominal);
+    if (extensionTableKey.empty())
+      extensionTableKey = serialization::getExtensionTableKey(nominal);
+    modulePair.first->loadExtensions(nominal, extensionTableKey);
   }
 }
 
@@ -56,6 +56,10 @@ class StrongRefCount {
   // The next bit is the deallocating marker.
   // The remaining bits are the reference count.
   // refCount == RC_ONE means reference count == 1.
+  //
+  // A reference count with the high bit set marks an immortal object.
+  // Immortal objects start out in the middle of that range, so that
+  // retains and releases racing with setImmortal() stay inside it.
   enum : uint32_t {
     RC_PINNED_FLAG = 0x1,
     RC_DEALLOCATING_FLAG = 0x2,
@@ -64,7 +68,10 @@ class StrongRefCount {
     RC_FLAGS_MASK = 3,
     RC_COUNT_MASK = ~RC_FLAGS_MASK,
 
-    RC_ONE = RC_FLAGS_MASK + 1
+    RC_ONE = RC_FLAGS_MASK + 1,
+
+    RC_IMMORTAL_FLAG = 0x80000000,
+    RC_IMMORTAL = 0xC0000000
   };
 
   static_assert(RC_ONE == RC_DEALLOCATING_FLAG << 1,
@@ -76,6 +83,7 @@ class StrongRefCount {
 
  public:
   enum Initialized_t { Initialized };
+  enum Immortal_t { Immortal };
 
   // StrongRefCount must be trivially constructible to avoid ObjC++
   // destruction overhead at runtime. Use StrongRefCount(Initialized) to produce
@@ -86,28 +94,54 @@ class StrongRefCount {
   constexpr StrongRefCount(Initialized_t)
     : refCount(RC_ONE) { }
 
+  // Refcount of a statically-allocated object that is never deallocated.
+  constexpr StrongRefCount(Immortal_t)
+    : refCount(RC_IMMORTAL) { }
+
   void init() {
     refCount = RC_ONE;
   }
 
+  // Make the object immortal. Retains and releases of an immortal object
+  // don't change its reference count, and it is never deallocated.
+  //
+  // Precondition: the caller holds a strong reference, and the object
+  // is not pinned.
+  void setImmortal() {
+    __atomic_store_n(&refCount, RC_IMMORTAL, __ATOMIC_RELAXED);
+  }
+
+  // Return true if the object is immortal.
+  bool isImmortal() const {
+    return __atomic_load_n(&refCount, __ATOMIC_RELAXED) & RC_IMMORTAL_FLAG;
+  }
+
   // Increment the reference count.
   void increment() {
+    if (isImmortal())
+      return;
     __atomic_fetch_add(&refCount, RC_ONE, __ATOMIC_RELAXED);
   }
 
   void incrementNonAtomic() {
     uint32_t val = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
+    if (val & RC_IMMORTAL_FLAG)
+      return;
     val += RC_ONE;
     __atomic_store_n(&refCount, val, __ATOMIC_RELAXED);
   }
 
   // Increment the reference count by n.
   void increment(uint32_t n) {
+    if (isImmortal())
+      return;
     __atomic_fetch_add(&refCount, n << RC_FLAGS_COUNT, __ATOMIC_RELAXED);
   }
 
   void incrementNonAtomic(uint32_t n) {
     uint32_t val = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
+    if (val & RC_IMMORTAL_FLAG)
+      return;
     val += n << RC_FLAGS_COUNT;
     __atomic_store_n(&refCount, val, __ATOMIC_RELAXED);
  }
@@ -120,12 +154,13 @@ class StrongRefCount {
   //
   // Returns true if the flag was set by this operation.
   //
-  // Postcondition: the flag is set.
+  // Postcondition: the flag is set, or the object is immortal.
   bool tryIncrementAndPin() {
     uint32_t oldval = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
     while (true) {
-      // If the flag is already set, just fail.
-      if (oldval & RC_PINNED_FLAG) {
+      // If the flag is already set, just fail. Immortal objects are never
+      // pinned.
+      if (oldval & (RC_PINNED_FLAG | RC_IMMORTAL_FLAG)) {
         return false;
       }
 
@@ -143,7 +178,7 @@ class StrongRefCount {
   bool tryIncrementAndPinNonAtomic() {
     uint32_t oldval = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
     // If the flag is already set, just fail.
-    if (oldval & RC_PINNED_FLAG) {
+    if (oldval & (RC_PINNED_FLAG | RC_IMMORTAL_FLAG)) {
       return false;
     }
 
@@ -155,6 +190,8 @@ class StrongRefCount {
 
   // Increment the reference count, unless the object is deallocating.
   bool tryIncrement() {
+    if (isImmortal())
+      return true;
     // FIXME: this could be better on LL/SC architectures like arm64
     uint32_t oldval = __atomic_fetch_add(&refCount, RC_ONE, __ATOMIC_RELAXED);
     if (oldval & RC_DEALLOCATING_FLAG) {
@@ -203,6 +240,26 @@ class StrongRefCount {
     return doDecrementShouldDeallocateNNonAtomic<false>(n);
   }
 
+  // Decrement the reference count by n, unless that would leave it at zero
+  // or less. Return false without changing the count in that case.
+  bool tryDecrementN(uint32_t n) {
+    uint32_t oldval = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
+    while ((oldval & RC_COUNT_MASK) > (n << RC_FLAGS_COUNT)) {
+      uint32_t newval = oldval - (n << RC_FLAGS_COUNT);
+      if (__atomic_compare_exchange(&refCount, &oldval, &newval, 0,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        return true;
+    }
+    return false;
+  }
+
+  // Clear the pinned flag without releasing the pinning reference.
+  //
+  // Precondition: the pinned flag is set.
+  void clearPinned() {
+    __atomic_fetch_and(&refCount, ~uint32_t(RC_PINNED_FLAG), __ATOMIC_RELAXED);
+  }
+
   // Return the reference count.
   // During deallocation the reference count is undefined.
   uint32_t getCount() const {
@@ -232,6 +289,11 @@ class StrongRefCount {
     return (int32_t)rotateRightByOne < (int32_t)RC_ONE;
   }
 
+  // Return true if the pin flag is set.
+  bool isPinned() const {
+    return __atomic_load_n(&refCount, __ATOMIC_RELAXED) & RC_PINNED_FLAG;
+  }
+
   // Return true if the object is inside deallocation.
   bool isDeallocating() const {
     return __atomic_load_n(&refCount, __ATOMIC_RELAXED) & RC_DEALLOCATING_FLAG;
@@ -240,6 +302,10 @@ class StrongRefCount {
 private:
   template <bool ClearPinnedFlag>
   bool doDecrementShouldDeallocate() {
+    // Immortal objects are never released.
+    if (isImmortal())
+      return false;
+
     // If we're being asked to clear the pinned flag, we can assume
     // it's already set.
     constexpr uint32_t quantum =
@@ -277,6 +343,10 @@ private:
 
   template <bool ClearPinnedFlag>
   bool doDecrementShouldDeallocateNonAtomic() {
+    // Immortal objects are never released.
+    if (isImmortal())
+      return false;
+
     // If we're being asked to clear the pinned flag, we can assume
     // it's already set.
     constexpr uint32_t quantum =
@@ -317,6 +387,10 @@ private:
 
   template <bool ClearPinnedFlag>
   bool doDecrementShouldDeallocateN(uint32_t n) {
+    // Immortal objects are never released.
+    if (isImmortal())
+      return false;
+
     // If we're being asked to clear the pinned flag, we can assume
     // it's already set.
     uint32_t delta = (n << RC_FLAGS_COUNT) + (ClearPinnedFlag ? RC_PINNED_FLAG : 0);
@@ -353,6 +427,10 @@ private:
 
   template <bool ClearPinnedFlag>
   bool doDecrementShouldDeallocateNNonAtomic(uint32_t n) {
+    // Immortal objects are never released.
+    if (isImmortal())
+      return false;
+
     // If we're being asked to clear the pinned flag, we can assume
     // it's already set.
     uint32_t delta = (n << RC_FLAGS_COUNT) + (ClearPinnedFlag ? RC_PINNED_FLAG : 0);
@@ -397,12 +475,23 @@ private:
 class WeakRefCount {
   uint32_t refCount;
 
+  // The low bit is set once native weak references to the object have
+  // been given a side table.
+  // In runtimes built with biased reference counting, the next bit is set
+  // if the object was allocated with a biased reference count in front
+  // of it.
+  // The remaining bits are the reference count.
   enum : uint32_t {
-    // There isn't really a flag here.
-    RC_UNUSED_FLAG = 1,
+    RC_SIDE_TABLE_FLAG = 1,
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+    RC_BIASED_FLAG = 2,
 
+    RC_FLAGS_COUNT = 2,
+    RC_FLAGS_MASK = 3,
+#else
     RC_FLAGS_COUNT = 1,
     RC_FLAGS_MASK = 1,
+#endif
     RC_COUNT_MASK = ~RC_FLAGS_MASK,
 
     RC_ONE = RC_FLAGS_MASK + 1
@@ -429,6 +518,13 @@ class WeakRefCount {
     refCount = RC_ONE;
   }
 
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  /// Initialize for an object allocated with a biased reference count.
+  void initBiased() {
+    refCount = RC_ONE | RC_BIASED_FLAG;
+  }
+#endif
+
   /// Initialize for a stack promoted object. This prevents that the final
   /// release frees the memory of the object.
   void initForNotDeallocating() {
@@ -476,6 +572,24 @@ class WeakRefCount {
   uint32_t getCount() const {
     return __atomic_load_n(&refCount, __ATOMIC_RELAXED) >> RC_FLAGS_COUNT;
   }
+
+  // Record that the object has a weak reference side table.
+  void setHasSideTable() {
+    __atomic_fetch_or(&refCount, RC_SIDE_TABLE_FLAG, __ATOMIC_RELAXED);
+  }
+
+  // Return true if the object has a weak reference side table that must be
+  // forgotten when the object is deallocated.
+  bool hasSideTable() const {
+    return __atomic_load_n(&refCount, __ATOMIC_RELAXED) & RC_SIDE_TABLE_FLAG;
+  }
+
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  // Return true if the object was allocated with a biased reference count.
+  bool isBiased() const {
+    return __atomic_load_n(&refCount, __ATOMIC_RELAXED) & RC_BIASED_FLAG;
+  }
+#endif
 };
 
 static_assert(swift::IsTriviallyConstructible<StrongRefCount>::value,
@@ -18,12 +18,15 @@
 #include "swift/Basic/Demangle.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Config.h"
 #include "swift/Runtime/Enum.h"
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Mutex.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "swift/Runtime/Debug.h"
 #include "ErrorObject.h"
@@ -634,6 +637,159 @@ static bool _conformsToProtocols(const OpaqueValue *value,
   return true;
 }
 
+namespace {
+  struct CastCacheKey {
+    const Metadata *Source;
+    const ExistentialTypeMetadata *Target;
+  };
+
+  /// The cached result of checking whether a type conforms to the protocols
+  /// of an existential type. The witness tables of a successful check are
+  /// tail-allocated.
+  class CastCacheEntry {
+    const Metadata *Source;
+    const ExistentialTypeMetadata *Target;
+
+    /// The conformance generation under which the check last failed, or
+    /// Succeeded.
+    std::atomic<uintptr_t> Generation;
+
+    enum : uintptr_t { Succeeded = ~uintptr_t(0) };
+
+    std::atomic<const WitnessTable *> *getWitnessTables() {
+      return reinterpret_cast<std::atomic<const WitnessTable *> *>(this + 1);
+    }
+
+    static unsigned getNumWitnessTables(const CastCacheKey &key) {
+      return key.Target->Flags.getNumWitnessTables();
+    }
+
+  public:
+    CastCacheEntry(const CastCacheKey &key,
+                   const WitnessTable * const *conformances,
+                   uintptr_t failureGeneration)
+      : Source(key.Source), Target(key.Target),
+        Generation(conformances ? uintptr_t(Succeeded) : failureGeneration) {
+      auto tables = getWitnessTables();
+      for (unsigned i = 0, n = getNumWitnessTables(key); i != n; ++i)
+        ::new (&tables[i]) std::atomic<const WitnessTable *>(
+          conformances ? conformances[i] : nullptr);
+    }
+
+    int compareWithKey(const CastCacheKey &key) const {
+      if (key.Source != Source) {
+        return (uintptr_t(key.Source) < uintptr_t(Source) ? -1 : 1);
+      } else if (key.Target != Target) {
+        return (uintptr_t(key.Target) < uintptr_t(Target) ? -1 : 1);
+      } else {
+        return 0;
+      }
+    }
+
+    template <class... Args>
+    static size_t getExtraAllocationSize(const CastCacheKey &key,
+                                         Args &&... ignored) {
+      return getNumWitnessTables(key)
+               * sizeof(std::atomic<const WitnessTable *>);
+    }
+
+    static size_t getKeyHash(const CastCacheKey &key) {
+      return llvm::hash_combine(key.Source, key.Target);
+    }
+
+    /// Copy the cached witness tables into \p conformances and return true
+    /// if the check is known to succeed. Return false if it is known to fail
+    /// under the given conformance generation.
+    ///
+    /// \returns None if the cached failure is out of date.
+    Optional<bool> getResult(const WitnessTable **conformances,
+                             uintptr_t generation) {
+      auto cached = Generation.load(std::memory_order_acquire);
+      if (cached == Succeeded) {
+        auto tables = getWitnessTables();
+        for (unsigned i = 0, n = Target->Flags.getNumWitnessTables();
+             i != n; ++i)
+          conformances[i] = tables[i].load(std::memory_order_relaxed);
+        return true;
+      }
+      if (cached == generation)
+        return false;
+      return None;
+    }
+
+    void makeSuccessful(const WitnessTable * const *conformances) {
+      auto tables = getWitnessTables();
+      for (unsigned i = 0, n = Target->Flags.getNumWitnessTables(); i != n; ++i)
+        tables[i].store(conformances[i], std::memory_order_relaxed);
+      Generation.store(Succeeded, std::memory_order_release);
+    }
+
+    void updateFailureGeneration(uintptr_t failureGeneration) {
+      // A successful entry is final, and a failure found under a later
+      // generation must not be replaced by one found under an earlier one.
+      auto cached = Generation.load(std::memory_order_relaxed);
+      while (cached != Succeeded && cached < failureGeneration &&
+             !Generation.compare_exchange_weak(cached, failureGeneration,
+                                               std::memory_order_relaxed)) {
+      }
+    }
+  };
+} // end anonymous namespace
+
+/// The results of conformance checks made by casts to existential types.
+static Lazy<ConcurrentHashMap<CastCacheEntry>> CastCache;
+
+/// Whether checking a type against the protocols of an existential type
+/// depends only on the type, and not on the value being cast.
+static bool isCastToExistentialCacheable(
+                                  const ExistentialTypeMetadata *targetType) {
+  // Objective-C protocol conformance is checked on the object, which can
+  // respond differently than its class.
+  for (unsigned i = 0, n = targetType->Protocols.NumProtocols; i != n; ++i) {
+    auto protocol = targetType->Protocols[i];
+    if (!protocol->Flags.needsWitnessTable() &&
+        protocol->Flags.getSpecialProtocol() != SpecialProtocol::AnyObject)
+      return false;
+  }
+  return true;
+}
+
+/// Check whether a type conforms to the protocols of an existential type,
+/// filling in a list of conformances, and remember the result for later
+/// casts between the same types.
+static bool _conformsToExistentialProtocols(const OpaqueValue *value,
+                                     const Metadata *type,
+                                     const ExistentialTypeMetadata *targetType,
+                                     const WitnessTable **conformances) {
+  if (!isCastToExistentialCacheable(targetType))
+    return _conformsToProtocols(value, type, targetType->Protocols,
+                                conformances);
+
+  // Read the generation before checking, so that sections registered while
+  // we check make a failure out of date.
+  uintptr_t generation = _getProtocolConformanceGeneration();
+
+  auto &cache = CastCache.get();
+  CastCacheKey key{type, targetType};
+  if (auto entry = cache.find(key)) {
+    if (auto result = entry->getResult(conformances, generation))
+      return *result;
+  }
+
+  bool result = _conformsToProtocols(value, type, targetType->Protocols,
+                                     conformances);
+  auto insertion = cache.getOrInsert(key,
+                                     result ? conformances : nullptr,
+                                     generation);
+  if (!insertion.second) {
+    if (result)
+      insertion.first->makeSuccessful(conformances);
+    else
+      insertion.first->updateFailureGeneration(generation);
+  }
+  return result;
+}
+
 static bool shouldDeallocateSource(bool castSucceeded, DynamicCastFlags flags) {
   return (castSucceeded && (flags & DynamicCastFlags::TakeOnSuccess)) ||
         (!castSucceeded && (flags & DynamicCastFlags::DestroyOnFailure));
@@ -1140,9 +1296,10 @@ static bool _dynamicCastToExistential(OpaqueValue *dest,
     // srcDynamicType equals nullptr we have a cast from an existential
     // container with a class instance to AnyObject. In this case no check is
     // necessary.
-    if (srcDynamicType && !_conformsToProtocols(srcDynamicValue, srcDynamicType,
-                              targetType->Protocols,
-                              destExistential->getWitnessTables()))
+    if (srcDynamicType &&
+        !_conformsToExistentialProtocols(srcDynamicValue, srcDynamicType,
+                                         targetType,
+                                         destExistential->getWitnessTables()))
       return fallbackForNonDirectConformance();
 
     auto object = *(reinterpret_cast<HeapObject**>(srcDynamicValue));
@@ -1158,9 +1315,9 @@ static bool _dynamicCastToExistential(OpaqueValue *dest,
       reinterpret_cast<OpaqueExistentialContainer*>(dest);
 
     // Check for protocol conformances and fill in the witness tables.
-    if (!_conformsToProtocols(srcDynamicValue, srcDynamicType,
-                              targetType->Protocols,
-                              destExistential->getWitnessTables()))
+    if (!_conformsToExistentialProtocols(srcDynamicValue, srcDynamicType,
+                                         targetType,
+                                         destExistential->getWitnessTables()))
       return fallbackForNonDirectConformance();
 
     // Fill in the type and value.
@@ -1182,9 +1339,8 @@ static bool _dynamicCastToExistential(OpaqueValue *dest,
     // one we need.
     assert(targetType->Protocols.NumProtocols == 1);
     const WitnessTable *errorWitness;
-    if (!_conformsToProtocols(srcDynamicValue, srcDynamicType,
-                              targetType->Protocols,
-                              &errorWitness))
+    if (!_conformsToExistentialProtocols(srcDynamicValue, srcDynamicType,
+                                         targetType, &errorWitness))
       return fallbackForNonDirectConformance();
 
 #if SWIFT_OBJC_INTEROP
@@ -0,0 +1,387 @@
+//===--- GenericMetadataProfile.cpp - Generic metadata preinstantiation ---===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Recording and replay of the generic type metadata a process instantiates.
+//
+// If SWIFT_DEBUG_GENERIC_METADATA_PROFILE_OUTPUT is set to a path in the
+// environment, every generic type instantiated through
+// swift_getGenericMetadata is remembered, and the set is written to that
+// path at exit.
+//
+// If SWIFT_GENERIC_METADATA_PROFILE is set to the path of such a profile,
+// the first generic metadata instantiation starts a background thread that
+// instantiates every type in the profile, so that the requests made later
+// on the main path of the program find their metadata already cached.
+//
+// A profile is a text file. The first line is a version header, and every
+// following line describes one type:
+//
+//   type ::= 'N' name                        // non-generic nominal type
+//   type ::= 'G' name '<' type* '>' conf*    // generic nominal type
+//   type ::= 'T' ('L' name)? '<' type* '>'   // tuple, optionally labeled
+//   conf ::= 'W' index name                  // conformance of the index'th
+//                                            // type argument to a protocol
+//   name ::= length ':' bytes
+//
+// Nominal types and protocols are named by the mangled names in their
+// descriptors, so a profile stays valid when the program is relinked.
+// Types that cannot be named this way, such as function types or
+// instantiations whose witness tables are not statically emitted, are left
+// out of the profile.
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Concurrent.h"
+#include "swift/Runtime/Metadata.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "Private.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <thread>
+#include <vector>
+
+using namespace swift;
+
+extern "C" const Metadata *
+swift_getTypeByMangledName(const char *typeName, size_t typeNameLength);
+
+static const char ProfileHeader[] = "swift-generic-metadata-profile 1";
+
+/// Bound the nesting of types we record and replay.
+static const unsigned MaxTypeDepth = 32;
+
+namespace {
+
+struct GenericMetadataProfileState {
+  /// The path the profile is written to at exit, if recording.
+  const char *OutputPath;
+
+  /// Every generic type instantiated so far, most recent first.
+  ConcurrentList<const Metadata *> Instantiations;
+
+  GenericMetadataProfileState();
+};
+
+} // end anonymous namespace
+
+static Lazy<GenericMetadataProfileState> ProfileState;
+
+//===----------------------------------------------------------------------===//
+// Recording
+//===----------------------------------------------------------------------===//
+
+static void appendName(std::string &out, llvm::StringRef name) {
+  out += std::to_string(name.size());
+  out += ':';
+  out += name;
+}
+
+static bool appendType(std::string &out, const Metadata *type,
+                       unsigned depth);
+
+static bool appendNominalType(std::string &out, const Metadata *type,
+                              const NominalTypeDescriptor *description,
+                              unsigned depth) {
+  auto &params = description->GenericParams;
+  if (!params.isGeneric()) {
+    out += 'N';
+    appendName(out, description->Name.get());
+    return true;
+  }
+
+  // We can't name the lexical parent of a nested generic type.
+  if (params.Flags.hasGenericParent())
+    return false;
+
+  // The generic arguments are the type arguments followed by the witness
+  // tables for their conformances.
+  auto arguments = reinterpret_cast<const void * const *>(type)
+                     + params.Offset;
+  out += 'G';
+  appendName(out, description->Name.get());
+  out += '<';
+  for (unsigned i = 0; i != params.NumPrimaryParams; ++i) {
+    if (!appendType(out, static_cast<const Metadata *>(arguments[i]),
+                    depth + 1))
+      return false;
+  }
+  out += '>';
+
+  for (unsigned i = params.NumPrimaryParams;
+       i != params.NumGenericRequirements; ++i) {
+    auto table = static_cast<const WitnessTable *>(arguments[i]);
+    auto protocol = _searchConformancesByStaticWitnessTable(table);
+    if (!protocol)
+      return false;
+
+    // Find the type argument the witness table belongs to.
+    unsigned index = 0;
+    while (index != params.NumPrimaryParams &&
+           swift_conformsToProtocol(
+             static_cast<const Metadata *>(arguments[index]), protocol)
+               != table)
+      ++index;
+    if (index == params.NumPrimaryParams)
+      return false;
+
+    out += 'W';
+    out += std::to_string(index);
+    appendName(out, protocol->Name);
+  }
+  return true;
+}
+
+static bool appendType(std::string &out, const Metadata *type,
+                       unsigned depth) {
+  if (depth > MaxTypeDepth)
+    return false;
+
+  switch (type->getKind()) {
+  case MetadataKind::Class:
+  case MetadataKind::Struct:
+  case MetadataKind::Enum:
+  case MetadataKind::Optional: {
+    const NominalTypeDescriptor *description =
+      type->getNominalTypeDescriptor();
+    if (!description)
+      return false;
+    return appendNominalType(out, type, description, depth);
+  }
+
+  case MetadataKind::Tuple: {
+    auto tuple = static_cast<const TupleTypeMetadata *>(type);
+    out += 'T';
+    if (tuple->Labels) {
+      out += 'L';
+      appendName(out, tuple->Labels);
+    }
+    out += '<';
+    for (unsigned i = 0; i != tuple->NumElements; ++i) {
+      if (!appendType(out, tuple->getElement(i).Type, depth + 1))
+        return false;
+    }
+    out += '>';
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
+static void writeGenericMetadataProfile() {
+  auto &state = ProfileState.get();
+
+  FILE *file = fopen(state.OutputPath, "w");
+  if (!file) {
+    fprintf(stderr, "swift runtime: unable to write generic metadata "
+                    "profile to %s\n", state.OutputPath);
+    return;
+  }
+
+  // Write the types in the order they were instantiated.
+  std::vector<const Metadata *> types(state.Instantiations.begin(),
+                                      state.Instantiations.end());
+  fprintf(file, "%s\n", ProfileHeader);
+  std::string line;
+  for (auto i = types.rbegin(), e = types.rend(); i != e; ++i) {
+    line.clear();
+    if (appendType(line, *i, 0))
+      fprintf(file, "%s\n", line.c_str());
+  }
+  fclose(file);
+}
+
+void swift::_noteGenericMetadataInstantiation(const Metadata *metadata) {
+  auto &state = ProfileState.get();
+  if (state.OutputPath)
+    state.Instantiations.push_front(metadata);
+}
+
+//===----------------------------------------------------------------------===//
+// Replay
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// Parses and instantiates the types in a profile.
+class ProfileReader {
+  llvm::StringRef Text;
+
+  bool consume(char c) {
+    if (Text.empty() || Text.front() != c)
+      return false;
+    Text = Text.drop_front();
+    return true;
+  }
+
+  bool readNumber(size_t &value) {
+    size_t length = 0;
+    value = 0;
+    while (length != Text.size() && Text[length] >= '0' &&
+           Text[length] <= '9') {
+      value = value * 10 + (Text[length] - '0');
+      ++length;
+    }
+    Text = Text.drop_front(length);
+    return length != 0;
+  }
+
+  bool readName(llvm::StringRef &name) {
+    size_t length;
+    if (!readNumber(length) || !consume(':') || length > Text.size())
+      return false;
+    name = Text.take_front(length);
+    Text = Text.drop_front(length);
+    return true;
+  }
+
+  bool readTypeList(llvm::SmallVectorImpl<const Metadata *> &types,
+                    unsigned depth) {
+    if (!consume('<'))
+      return false;
+    while (!consume('>')) {
+      auto type = readType(depth + 1);
+      if (!type)
+        return false;
+      types.push_back(type);
+    }
+    return true;
+  }
+
+  const Metadata *readGenericType(unsigned depth) {
+    llvm::StringRef name;
+    llvm::SmallVector<const Metadata *, 4> typeArguments;
+    if (!readName(name) || !readTypeList(typeArguments, depth))
+      return nullptr;
+
+    auto description = _searchGenericTypeDescriptorsByMangledName(name);
+    if (!description)
+      return nullptr;
+    auto pattern = description->getGenericMetadataPattern();
+    if (!pattern)
+      return nullptr;
+
+    llvm::SmallVector<const void *, 8> arguments(typeArguments.begin(),
+                                                 typeArguments.end());
+    while (consume('W')) {
+      size_t index;
+      llvm::StringRef protocolName;
+      if (!readNumber(index) || !readName(protocolName) ||
+          index >= typeArguments.size())
+        return nullptr;
+
+      auto protocol = _searchConformancesByMangledProtocolName(protocolName);
+      if (!protocol)
+        return nullptr;
+      auto table = swift_conformsToProtocol(typeArguments[index], protocol);
+      if (!table)
+        return nullptr;
+      arguments.push_back(table);
+    }
+
+    // The profile may be stale; don't instantiate with the wrong arguments.
+    if (arguments.size() != pattern->NumKeyArguments ||
+        typeArguments.size() != description->GenericParams.NumPrimaryParams)
+      return nullptr;
+
+    return swift_getGenericMetadata(pattern, arguments.data());
+  }
+
+  const Metadata *readTupleType(unsigned depth) {
+    std::string labels;
+    if (consume('L')) {
+      llvm::StringRef labelsRef;
+      if (!readName(labelsRef))
+        return nullptr;
+      labels = labelsRef.str();
+    }
+
+    llvm::SmallVector<const Metadata *, 4> elements;
+    if (!readTypeList(elements, depth))
+      return nullptr;
+
+    // Newly created tuple metadata refers to its labels, so they have to
+    // stay alive for the rest of the process.
+    const char *labelsCopy = nullptr;
+    if (!labels.empty())
+      labelsCopy = strdup(labels.c_str());
+
+    return swift_getTupleTypeMetadata(elements.size(), elements.data(),
+                                      labelsCopy, nullptr);
+  }
+
+public:
+  explicit ProfileReader(llvm::StringRef line) : Text(line) {}
+
+  const Metadata *readType(unsigned depth = 0) {
+    if (depth > MaxTypeDepth)
+      return nullptr;
+
+    if (consume('N')) {
+      llvm::StringRef name;
+      if (!readName(name))
+        return nullptr;
+      return swift_getTypeByMangledName(name.data(), name.size());
+    }
+    if (consume('G'))
+      return readGenericType(depth);
+    if (consume('T'))
+      return readTupleType(depth);
+    return nullptr;
+  }
+};
+
+} // end anonymous namespace
+
+static void replayGenericMetadataProfile(std::string path) {
+  FILE *file = fopen(path.c_str(), "r");
+  if (!file)
+    return;
+
+  std::string contents;
+  char buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) != 0)
+    contents.append(buffer, count);
+  fclose(file);
+
+  llvm::StringRef rest = contents;
+  llvm::StringRef header;
+  std::tie(header, rest) = rest.split('\n');
+  if (header != ProfileHeader)
+    return;
+
+  // Types that can no longer be found are skipped.
+  while (!rest.empty()) {
+    llvm::StringRef line;
+    std::tie(line, rest) = rest.split('\n');
+    if (!line.empty())
+      (void) ProfileReader(line).readType();
+  }
+}
+
+GenericMetadataProfileState::GenericMetadataProfileState()
+    : OutputPath(getenv("SWIFT_DEBUG_GENERIC_METADATA_PROFILE_OUTPUT")),
+      Instantiations() {
+  if (OutputPath)
+    atexit(writeGenericMetadataProfile);
+
+  if (const char *replayPath = getenv("SWIFT_GENERIC_METADATA_PROFILE"))
+    std::thread(replayGenericMetadataProfile, std::string(replayPath))
+      .detach();
+}
@@ -16,15 +16,298 @@
 
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Heap.h"
+#include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Mutex.h"
 #include "Private.h"
 #include "swift/Runtime/Debug.h"
+#include <atomic>
 #include <stdlib.h>
+#include <string.h>
+
+#if SWIFT_THREAD_CACHE_ALLOCATOR_AVAILABLE
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
 
 using namespace swift;
 
+//===----------------------------------------------------------------------===//
+// Thread-caching small-object allocator
+//===----------------------------------------------------------------------===//
+//
+// When SWIFT_RUNTIME_ALLOCATOR=threadcache is set in the environment at
+// startup, small allocations made through swift_slowAlloc are served from
+// per-thread free lists segregated by size class instead of from malloc.
+//
+// Blocks are carved out of runs of a single size class, and all runs live in
+// one reserved virtual region. This lets swift_slowDealloc and
+// _swift_slowAllocGetUsableSize recover the size class from the address
+// alone. The size passed to swift_slowDealloc is not sufficient for this:
+// tail-allocated objects are deallocated through swift_unownedRelease with
+// their instance size rather than their allocated size.
+//
+// Each thread caches a bounded number of free blocks per size class. When a
+// thread cache runs empty it refills a batch from a central free list, or
+// carves a fresh run; when it overflows it returns a batch to the central
+// free list. Memory is never returned to the system.
+
+#if SWIFT_THREAD_CACHE_ALLOCATOR_AVAILABLE
+
+namespace {
+
+/// The granularity of small size classes.
+constexpr size_t SmallAllocQuantum = 16;
+/// The largest allocation served by the small-object allocator.
+constexpr size_t SmallAllocMaxSize = 256;
+constexpr unsigned NumSizeClasses = SmallAllocMaxSize / SmallAllocQuantum;
+
+/// The size of a run of blocks of one size class.
+constexpr size_t RunSize = 64 * 1024;
+/// The size of the virtual region reserved for runs.
+constexpr size_t RegionSize = size_t(1) << 34;
+constexpr size_t NumRuns = RegionSize / RunSize;
+
+/// The maximum number of free blocks a thread keeps per size class.
+constexpr unsigned ThreadCacheLimit = 256;
+/// The number of blocks moved between a thread and the central free list
+/// at once.
+constexpr unsigned TransferBatchSize = ThreadCacheLimit / 2;
+
+struct FreeBlock {
+  FreeBlock *Next;
+};
+
+/// A central free list for one size class, shared by all threads.
+struct CentralFreeList {
+  StaticMutex Lock;
+  FreeBlock *Head = nullptr;
+  size_t Count = 0;
+};
+
+/// The free lists cached by a single thread.
+struct ThreadCache {
+  FreeBlock *Heads[NumSizeClasses];
+  unsigned Counts[NumSizeClasses];
+};
+
+} // end anonymous namespace
+
+/// The bounds of the reserved region. These are set once, before the first
+/// small block is handed out, and never change afterwards.
+static uintptr_t RegionBegin = 0;
+static uintptr_t RegionEnd = 0;
+
+/// The next unused run in the region.
+static std::atomic<uintptr_t> NextRun(0);
+
+/// The size class of every run that has been carved, indexed by run number.
+/// This lives at the start of the region itself.
+static uint8_t *RunSizeClasses = nullptr;
+
+static CentralFreeList CentralFreeLists[NumSizeClasses];
+
+static pthread_key_t ThreadCacheKey;
+static thread_local ThreadCache *CurrentThreadCache = nullptr;
+
+static inline unsigned getSizeClass(size_t size) {
+  return size == 0 ? 0 : unsigned((size - 1) / SmallAllocQuantum);
+}
+
+static inline size_t getSizeClassSize(unsigned sizeClass) {
+  return (sizeClass + 1) * SmallAllocQuantum;
+}
+
+static inline bool isSmallBlock(const void *ptr) {
+  return uintptr_t(ptr) - RegionBegin < RegionEnd - RegionBegin;
+}
+
+static inline unsigned getSizeClassOfSmallBlock(const void *ptr) {
+  return RunSizeClasses[(uintptr_t(ptr) - RegionBegin) / RunSize];
+}
+
+/// Return every block cached by a thread to the central free lists.
+static void destroyThreadCache(void *value) {
+  auto cache = static_cast<ThreadCache *>(value);
+  for (unsigned sizeClass = 0; sizeClass < NumSizeClasses; ++sizeClass) {
+    FreeBlock *head = cache->Heads[sizeClass];
+    if (!head)
+      continue;
+    FreeBlock *tail = head;
+    while (tail->Next)
+      tail = tail->Next;
+
+    auto &central = CentralFreeLists[sizeClass];
+    StaticScopedLock guard(central.Lock);
+    tail->Next = central.Head;
+    central.Head = head;
+    central.Count += cache->Counts[sizeClass];
+  }
+  CurrentThreadCache = nullptr;
+  free(cache);
+}
+
+/// Decide whether the small-object allocator is enabled and, if so, reserve
+/// its region.
+static bool initializeSmallObjectAllocator() {
+  const char *mode = getenv("SWIFT_RUNTIME_ALLOCATOR");
+  if (!mode || strcmp(mode, "threadcache") != 0)
+    return false;
+
+  if (pthread_key_create(&ThreadCacheKey, destroyThreadCache) != 0)
+    return false;
+
+  // Reserve the region without committing it; pages are faulted in as runs
+  // are carved.
+  int flags = MAP_ANON | MAP_PRIVATE;
+#ifdef MAP_NORESERVE
+  flags |= MAP_NORESERVE;
+#endif
+  void *region = mmap(nullptr, RegionSize, PROT_READ | PROT_WRITE, flags,
+                      -1, 0);
+  if (region == MAP_FAILED)
+    return false;
+
+  // The run table occupies the first runs of the region.
+  RunSizeClasses = reinterpret_cast<uint8_t *>(region);
+  size_t tableRuns = (NumRuns + RunSize - 1) / RunSize;
+  NextRun.store(uintptr_t(region) + tableRuns * RunSize,
+                std::memory_order_relaxed);
+  RegionBegin = uintptr_t(region);
+  RegionEnd = uintptr_t(region) + RegionSize;
+  return true;
+}
+
+static bool isSmallObjectAllocatorEnabled() {
+  return SWIFT_LAZY_CONSTANT(initializeSmallObjectAllocator());
+}
+
+static ThreadCache *getThreadCache() {
+  if (auto cache = CurrentThreadCache)
+    return cache;
+
+  auto cache = static_cast<ThreadCache *>(calloc(1, sizeof(ThreadCache)));
+  if (!cache)
+    swift::crash("Could not allocate memory.");
+  pthread_setspecific(ThreadCacheKey, cache);
+  CurrentThreadCache = cache;
+  return cache;
+}
+
+/// Refill an empty thread cache for the given size class. Returns false if
+/// the region is exhausted.
+static bool refillThreadCache(ThreadCache *cache, unsigned sizeClass) {
+  assert(!cache->Heads[sizeClass]);
+
+  // Prefer blocks that other threads have given back.
+  {
+    auto &central = CentralFreeLists[sizeClass];
+    StaticScopedLock guard(central.Lock);
+    if (central.Head) {
+      FreeBlock *head = central.Head;
+      FreeBlock *tail = head;
+      unsigned count = 1;
+      while (count < TransferBatchSize && tail->Next) {
+        tail = tail->Next;
+        ++count;
+      }
+      central.Head = tail->Next;
+      central.Count -= count;
+      tail->Next = nullptr;
+      cache->Heads[sizeClass] = head;
+      cache->Counts[sizeClass] = count;
+      return true;
+    }
+  }
+
+  // Otherwise carve a new run.
+  uintptr_t run = NextRun.fetch_add(RunSize, std::memory_order_relaxed);
+  if (run + RunSize > RegionEnd)
+    return false;
+  RunSizeClasses[(run - RegionBegin) / RunSize] = uint8_t(sizeClass);
+
+  size_t blockSize = getSizeClassSize(sizeClass);
+  size_t numBlocks = RunSize / blockSize;
+  FreeBlock *head = nullptr;
+  for (size_t i = numBlocks; i > 0; --i) {
+    auto block = reinterpret_cast<FreeBlock *>(run + (i - 1) * blockSize);
+    block->Next = head;
+    head = block;
+  }
+  cache->Heads[sizeClass] = head;
+  cache->Counts[sizeClass] = unsigned(numBlocks);
+  return true;
+}
+
+/// Give a batch of blocks from an overflowing thread cache back to the
+/// central free list.
+static void drainThreadCache(ThreadCache *cache, unsigned sizeClass) {
+  FreeBlock *head = cache->Heads[sizeClass];
+  FreeBlock *tail = head;
+  for (unsigned i = 1; i < TransferBatchSize; ++i)
+    tail = tail->Next;
+  cache->Heads[sizeClass] = tail->Next;
+  cache->Counts[sizeClass] -= TransferBatchSize;
+
+  auto &central = CentralFreeLists[sizeClass];
+  StaticScopedLock guard(central.Lock);
+  tail->Next = central.Head;
+  central.Head = head;
+  central.Count += TransferBatchSize;
+}
+
+static void *allocSmallObject(size_t size) {
+  unsigned sizeClass = getSizeClass(size);
+  ThreadCache *cache = getThreadCache();
+
+  FreeBlock *block = cache->Heads[sizeClass];
+  if (LLVM_UNLIKELY(!block)) {
+    if (!refillThreadCache(cache, sizeClass))
+      return nullptr;
+    block = cache->Heads[sizeClass];
+  }
+
+  cache->Heads[sizeClass] = block->Next;
+  --cache->Counts[sizeClass];
+  return block;
+}
+
+static void deallocSmallObject(void *ptr) {
+  unsigned sizeClass = getSizeClassOfSmallBlock(ptr);
+  ThreadCache *cache = getThreadCache();
+
+  auto block = static_cast<FreeBlock *>(ptr);
+  block->Next = cache->Heads[sizeClass];
+  cache->Heads[sizeClass] = block;
+  if (LLVM_UNLIKELY(++cache->Counts[sizeClass] > ThreadCacheLimit))
+    drainThreadCache(cache, sizeClass);
+}
+
+size_t swift::_swift_slowAllocGetUsableSize(const void *ptr) {
+  if (!isSmallBlock(ptr))
+    return 0;
+  return getSizeClassSize(getSizeClassOfSmallBlock(ptr));
+}
+
+#else
+
+size_t swift::_swift_slowAllocGetUsableSize(const void *ptr) {
+  return 0;
+}
+
+#endif // SWIFT_THREAD_CACHE_ALLOCATOR_AVAILABLE
+
 SWIFT_RT_ENTRY_VISIBILITY
 void *swift::swift_slowAlloc(size_t size, size_t alignMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_THREAD_CACHE_ALLOCATOR_AVAILABLE
+  // Small blocks are aligned to the size-class quantum.
+  if (size <= SmallAllocMaxSize && alignMask < SmallAllocQuantum &&
+      isSmallObjectAllocatorEnabled()) {
+    if (void *p = allocSmallObject(size))
+      return p;
+  }
+#endif
+
   // FIXME: use posix_memalign if alignMask is larger than the system guarantee.
   void *p = malloc(size);
   if (!p) swift::crash("Could not allocate memory.");
@@ -34,5 +317,14 @@ void *swift::swift_slowAlloc(size_t size, size_t alignMask)
 SWIFT_RT_ENTRY_VISIBILITY
 void swift::swift_slowDealloc(void *ptr, size_t bytes, size_t alignMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_THREAD_CACHE_ALLOCATOR_AVAILABLE
+  if (isSmallBlock(ptr)) {
+    assert(bytes <= getSizeClassSize(getSizeClassOfSmallBlock(ptr)) &&
+           "deallocating more bytes than were allocated");
+    deallocSmallObject(ptr);
+    return;
+  }
+#endif
+
   free(ptr);
 }
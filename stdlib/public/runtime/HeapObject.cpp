@@ -18,17 +18,24 @@
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Heap.h"
 #include "swift/Runtime/Metadata.h"
+#include "swift/Runtime/Mutex.h"
 #include "swift/ABI/System.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/MathExtras.h"
 #include "MetadataCache.h"
 #include "Private.h"
 #include "swift/Runtime/Debug.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
 #include <thread>
+#include <vector>
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+#include <pthread.h>
+#endif
 #include "../SwiftShims/RuntimeShims.h"
 #if SWIFT_OBJC_INTEROP
 # include <objc/NSObject.h>
@@ -41,6 +48,400 @@
 
 using namespace swift;
 
+// Forward-declare this, but define it after swift_release.
+extern "C" LLVM_LIBRARY_VISIBILITY void
+_swift_release_dealloc(HeapObject *object) SWIFT_CC(RegisterPreservingCC_IMPL)
+    __attribute__((__noinline__, __used__));
+
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+//===----------------------------------------------------------------------===//
+// Biased reference counting
+//===----------------------------------------------------------------------===//
+//
+// In this mode every object allocated by swift_allocObject is biased toward
+// the thread that allocated it. The owner thread counts its references in
+// a BiasedRefCount placed in front of the object, without atomic
+// operations; other threads count theirs in the atomic count of the object
+// header.
+//
+// While an object is biased, the header count includes one reference held
+// on behalf of all of the owner's references, so the object's reference
+// count is the owner's count plus the header count, minus one. Other
+// threads never take the header count below one. A release that would do
+// so is recorded in the BiasedRefCount as owed to the owner instead, and
+// the object is put on its owner's queue. The owner settles the releases
+// owed to it the next time it allocates or releases an object, or when it
+// exits.
+//
+// When the owner's count reaches zero and nothing is owed, the owner
+// unbiases the object and gives up the reference the header held for it.
+// From then on the object is counted in the header alone.
+//
+// Threads that exit leave their BiasedThread to be adopted by the next
+// thread that starts allocating, which takes over the objects biased
+// toward it. Until then, other threads settle releases owed to it
+// themselves, under its lock.
+
+namespace {
+
+class BiasedThread {
+public:
+  Mutex Lock;
+
+  /// Objects with releases owed to this thread. Guarded by Lock.
+  std::vector<HeapObject *> Queue;
+
+  /// Whether Queue may be non-empty, so the owner can poll without taking
+  /// the lock.
+  std::atomic<bool> HasQueue{false};
+
+  /// Whether no running thread owns this BiasedThread. Guarded by Lock.
+  bool Exited = false;
+
+  /// The next exited BiasedThread waiting to be adopted.
+  BiasedThread *NextExited = nullptr;
+};
+
+/// The owner's part of the reference count of a biased object.
+struct BiasedRefCount {
+  BiasedThread *Owner;
+
+  /// The owner's references. While the object is biased, only its owner
+  /// touches this, or another thread holding the lock of an owner that
+  /// has exited.
+  uint32_t Count;
+
+  /// The releases owed to the owner, whether the object is on the owner's
+  /// queue, whether it has been unbiased, and log2 of the distance from
+  /// the start of the allocation to the object.
+  std::atomic<uint32_t> State;
+
+  enum : uint32_t {
+    UnbiasedFlag = 0x1,
+    QueuedFlag = 0x2,
+    OffsetShift = 2,
+    OffsetMask = 0xFC,
+    OwedShift = 8,
+    OwedOne = 1u << OwedShift,
+    OwedMask = ~(OwedOne - 1)
+  };
+
+  /// Whether the current thread may update Count.
+  bool isOwnedByCurrentThread() const;
+
+  size_t getAllocationOffset() const {
+    return size_t(1) << ((State.load(std::memory_order_relaxed) & OffsetMask)
+                           >> OffsetShift);
+  }
+};
+
+} // end anonymous namespace
+
+/// The space in front of a biased object holding its BiasedRefCount.
+/// Allocations with larger alignment leave a larger gap.
+static constexpr size_t BiasedPrefixSize = 16;
+static_assert(sizeof(BiasedRefCount) <= BiasedPrefixSize,
+              "BiasedRefCount doesn't fit in front of the object");
+
+static pthread_key_t BiasedThreadKey;
+static thread_local BiasedThread *CurrentBiasedThread = nullptr;
+
+static StaticMutex ExitedBiasedThreadsLock;
+static BiasedThread *ExitedBiasedThreads = nullptr;
+
+bool BiasedRefCount::isOwnedByCurrentThread() const {
+  // Only the owner sets UnbiasedFlag, so if it is clear the owner can't
+  // have changed its mind since.
+  return !(State.load(std::memory_order_relaxed) & UnbiasedFlag) &&
+         Owner == CurrentBiasedThread;
+}
+
+static BiasedRefCount *getBiasedRefCount(const HeapObject *object) {
+  return reinterpret_cast<BiasedRefCount *>(
+    reinterpret_cast<uintptr_t>(object) - BiasedPrefixSize);
+}
+
+/// Give up the reference the header holds for the owner of \p object, once
+/// the owner holds no references of its own and nothing is owed to it.
+static bool unbiasShouldDeallocate(HeapObject *object, BiasedRefCount *rc) {
+  uint32_t state = rc->State.load(std::memory_order_relaxed);
+  do {
+    // Releases are owed to the owner; settling them will unbias the object.
+    if (state & BiasedRefCount::QueuedFlag)
+      return false;
+  } while (!rc->State.compare_exchange_weak(
+             state, state | BiasedRefCount::UnbiasedFlag,
+             std::memory_order_relaxed));
+  return object->refCount.decrementShouldDeallocate();
+}
+
+/// Release \p n references to \p object as its owner.
+static bool ownerReleaseShouldDeallocate(HeapObject *object,
+                                         BiasedRefCount *rc, uint32_t n) {
+  if (rc->Count > n) {
+    rc->Count -= n;
+    return false;
+  }
+
+  // References the owner got from other threads are counted in the header,
+  // which stays above the reference it holds for the owner.
+  if (uint32_t rest = n - rc->Count) {
+    bool shouldDeallocate = object->refCount.decrementShouldDeallocateN(rest);
+    assert(!shouldDeallocate && "released the owner's header reference");
+    (void) shouldDeallocate;
+  }
+  rc->Count = 0;
+  return unbiasShouldDeallocate(object, rc);
+}
+
+/// Apply the releases other threads owe the owner of \p object. Must be
+/// called by the owner, or with the lock of an owner that has exited.
+static bool settleShouldDeallocate(HeapObject *object, BiasedRefCount *rc) {
+  uint32_t state = rc->State.load(std::memory_order_relaxed);
+  while (!rc->State.compare_exchange_weak(
+           state,
+           state & ~(BiasedRefCount::OwedMask | BiasedRefCount::QueuedFlag),
+           std::memory_order_acquire, std::memory_order_relaxed)) {
+  }
+  return ownerReleaseShouldDeallocate(object, rc,
+                                      state >> BiasedRefCount::OwedShift);
+}
+
+/// Settle everything on the queue of \p thread, which must be the current
+/// thread's BiasedThread.
+static void drainBiasedThreadQueue(BiasedThread *thread) {
+  std::vector<HeapObject *> queue;
+  {
+    ScopedLock guard(thread->Lock);
+    queue.swap(thread->Queue);
+    thread->HasQueue.store(false, std::memory_order_relaxed);
+  }
+
+  for (auto object : queue) {
+    if (settleShouldDeallocate(object, getBiasedRefCount(object)))
+      _swift_release_dealloc(object);
+  }
+}
+
+static void exitBiasedThread(void *value) {
+  auto thread = static_cast<BiasedThread *>(value);
+
+  // Deinitializers run while settling may owe us more releases.
+  while (true) {
+    drainBiasedThreadQueue(thread);
+    ScopedLock guard(thread->Lock);
+    if (thread->Queue.empty()) {
+      thread->Exited = true;
+      break;
+    }
+  }
+  CurrentBiasedThread = nullptr;
+
+  StaticScopedLock guard(ExitedBiasedThreadsLock);
+  thread->NextExited = ExitedBiasedThreads;
+  ExitedBiasedThreads = thread;
+}
+
+static bool initializeBiasedThreadKey() {
+  if (pthread_key_create(&BiasedThreadKey, exitBiasedThread) != 0)
+    swift::crash("Could not create the biased reference counting key.");
+  return true;
+}
+
+static BiasedThread *getCurrentBiasedThread() {
+  if (auto thread = CurrentBiasedThread)
+    return thread;
+
+  (void) SWIFT_LAZY_CONSTANT(initializeBiasedThreadKey());
+
+  BiasedThread *thread = nullptr;
+  {
+    StaticScopedLock guard(ExitedBiasedThreadsLock);
+    if ((thread = ExitedBiasedThreads))
+      ExitedBiasedThreads = thread->NextExited;
+  }
+  if (thread) {
+    // Take over the objects biased toward the exited thread.
+    ScopedLock guard(thread->Lock);
+    thread->Exited = false;
+    thread->NextExited = nullptr;
+  } else {
+    thread = new BiasedThread();
+  }
+
+  pthread_setspecific(BiasedThreadKey, thread);
+  CurrentBiasedThread = thread;
+  return thread;
+}
+
+/// Put \p object on its owner's queue after recording releases owed to it.
+static bool queueForOwnerShouldDeallocate(HeapObject *object,
+                                          BiasedRefCount *rc) {
+  // The object can't be unbiased while it is queued, so its owner stays
+  // valid. BiasedThreads are never freed.
+  auto owner = rc->Owner;
+  ScopedLock guard(owner->Lock);
+  if (!owner->Exited) {
+    owner->Queue.push_back(object);
+    owner->HasQueue.store(true, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Nobody owns the object's count now; settle it ourselves under the lock.
+  return settleShouldDeallocate(object, rc);
+}
+
+static void retainBiased(HeapObject *object, uint32_t n) {
+  if (object->weakRefCount.isBiased()) {
+    auto rc = getBiasedRefCount(object);
+    if (rc->isOwnedByCurrentThread()) {
+      rc->Count += n;
+      return;
+    }
+  }
+  object->refCount.increment(n);
+}
+
+static bool releaseBiasedShouldDeallocate(HeapObject *object, uint32_t n) {
+  if (!object->weakRefCount.isBiased())
+    return object->refCount.decrementShouldDeallocateN(n);
+
+  auto rc = getBiasedRefCount(object);
+  if (rc->isOwnedByCurrentThread()) {
+    auto owner = rc->Owner;
+    bool shouldDeallocate = ownerReleaseShouldDeallocate(object, rc, n);
+
+    // Catch up with releases owed to us, which may include the last
+    // reference to an object.
+    if (owner->HasQueue.load(std::memory_order_relaxed))
+      drainBiasedThreadQueue(owner);
+    return shouldDeallocate;
+  }
+
+  // Release from the header if that leaves the owner's reference there.
+  if (object->refCount.tryDecrementN(n))
+    return false;
+
+  // Otherwise the owner has to account for the release.
+  uint32_t state = rc->State.load(std::memory_order_relaxed);
+  do {
+    if (state & BiasedRefCount::UnbiasedFlag)
+      return object->refCount.decrementShouldDeallocateN(n);
+    // Dropping owed releases would leak the object, and there is nowhere
+    // else to put them while the header holds the owner's reference.
+    if (n > (BiasedRefCount::OwedMask >> BiasedRefCount::OwedShift)
+              - (state >> BiasedRefCount::OwedShift))
+      swift::crash("too many releases owed to the owner of an object");
+  } while (!rc->State.compare_exchange_weak(
+             state,
+             (state + n * BiasedRefCount::OwedOne) | BiasedRefCount::QueuedFlag,
+             std::memory_order_release, std::memory_order_relaxed));
+
+  if (state & BiasedRefCount::QueuedFlag)
+    return false;
+  return queueForOwnerShouldDeallocate(object, rc);
+}
+
+static bool unpinBiasedShouldDeallocate(HeapObject *object) {
+  // The pinning reference is an ordinary reference once the flag is clear.
+  object->refCount.clearPinned();
+  return releaseBiasedShouldDeallocate(object, 1);
+}
+
+/// Move the last reference to \p object into its header, so that it can be
+/// torn down without a release.
+static void unbiasForDeallocation(HeapObject *object) {
+  if (!object->weakRefCount.isBiased())
+    return;
+  auto rc = getBiasedRefCount(object);
+  uint32_t state = rc->State.fetch_or(BiasedRefCount::UnbiasedFlag,
+                                      std::memory_order_acquire);
+  if (state & BiasedRefCount::UnbiasedFlag)
+    return;
+  assert(!(state & BiasedRefCount::QueuedFlag) &&
+         rc->Count + object->refCount.getCount() == 2 &&
+         "object is not uniquely referenced");
+  if (rc->Count == 0)
+    (void) object->refCount.decrementShouldDeallocate();
+  rc->Count = 0;
+}
+
+static HeapObject *allocBiasedObject(size_t requiredSize,
+                                     size_t requiredAlignmentMask) {
+  size_t offset = std::max(BiasedPrefixSize, requiredAlignmentMask + 1);
+  auto allocation = reinterpret_cast<char *>(
+      SWIFT_RT_ENTRY_CALL(swift_slowAlloc)(requiredSize + offset,
+                                           requiredAlignmentMask));
+  auto object = reinterpret_cast<HeapObject *>(allocation + offset);
+
+  auto thread = getCurrentBiasedThread();
+  auto rc = getBiasedRefCount(object);
+  rc->Owner = thread;
+  rc->Count = 1;
+  ::new (&rc->State) std::atomic<uint32_t>(
+    llvm::Log2_64(offset) << BiasedRefCount::OffsetShift);
+  return object;
+}
+
+/// Let a thread that mostly allocates catch up with releases owed to it.
+///
+/// Settling them can run deinitializers, so this must only be called once
+/// the object just allocated has a valid header.
+static void drainBiasedThreadQueueAfterAlloc() {
+  auto thread = CurrentBiasedThread;
+  if (thread->HasQueue.load(std::memory_order_relaxed))
+    drainBiasedThreadQueue(thread);
+}
+
+/// Free the memory of \p object, which may be preceded by a biased
+/// reference count.
+static void deallocObjectMemory(HeapObject *object, size_t allocatedSize,
+                                size_t allocatedAlignMask) {
+  if (object->weakRefCount.isBiased()) {
+    size_t offset = getBiasedRefCount(object)->getAllocationOffset();
+    SWIFT_RT_ENTRY_CALL(swift_slowDealloc)
+        (reinterpret_cast<char *>(object) - offset, allocatedSize + offset,
+         allocatedAlignMask);
+    return;
+  }
+  SWIFT_RT_ENTRY_CALL(swift_slowDealloc)
+      (object, allocatedSize, allocatedAlignMask);
+}
+
+size_t swift::_swift_getHeapObjectAllocationOffset(const void *object) {
+  auto heapObject = static_cast<const HeapObject *>(object);
+  if (!heapObject->weakRefCount.isBiased())
+    return 0;
+  return getBiasedRefCount(heapObject)->getAllocationOffset();
+}
+
+bool swift::_swift_isUniquelyReferencedBiased(const HeapObject *object,
+                                              bool orPinned) {
+  if (orPinned && object->refCount.isPinned())
+    return true;
+  if (!object->weakRefCount.isBiased())
+    return object->refCount.isUniquelyReferenced();
+
+  auto rc = getBiasedRefCount(object);
+  uint32_t state = rc->State.load(std::memory_order_acquire);
+  if (state & BiasedRefCount::UnbiasedFlag)
+    return object->refCount.isUniquelyReferenced();
+
+  // Only the owner can read its count. Other threads answer
+  // conservatively.
+  if (rc->Owner != CurrentBiasedThread)
+    return false;
+  return rc->Count + object->refCount.getCount() - 1
+           - (state >> BiasedRefCount::OwedShift) == 1;
+}
+#else
+static void deallocObjectMemory(HeapObject *object, size_t allocatedSize,
+                                size_t allocatedAlignMask) {
+  SWIFT_RT_ENTRY_CALL(swift_slowDealloc)
+      (object, allocatedSize, allocatedAlignMask);
+}
+#endif
+
 SWIFT_RT_ENTRY_VISIBILITY
 extern "C"
 HeapObject *
@@ -60,17 +461,29 @@ SWIFT_RT_ENTRY_IMPL(swift_allocObject)(HeapMetadata const *metadata,
                                        size_t requiredAlignmentMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
   assert(isAlignmentMask(requiredAlignmentMask));
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  auto object = allocBiasedObject(requiredSize, requiredAlignmentMask);
+#else
   auto object = reinterpret_cast<HeapObject *>(
       SWIFT_RT_ENTRY_CALL(swift_slowAlloc)(requiredSize,
                                            requiredAlignmentMask));
+#endif
   // FIXME: this should be a placement new but that adds a null check
   object->metadata = metadata;
   object->refCount.init();
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  object->weakRefCount.initBiased();
+#else
   object->weakRefCount.init();
+#endif
 
   // If leak tracking is enabled, start tracking this object.
   SWIFT_LEAKS_START_TRACKING_OBJECT(object);
 
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  drainBiasedThreadQueueAfterAlloc();
+#endif
+
   return object;
 }
 
@@ -164,6 +577,10 @@ public:
     return "BoxCache";
   }
 
+  static MetadataCacheKind getCacheKind() {
+    return MetadataCacheKind::Box;
+  }
+
   FullMetadata<GenericBoxHeapMetadata> *getData() {
     return &Metadata;
   }
@@ -225,11 +642,6 @@ OpaqueValue *swift::swift_projectBox(HeapObject *o) {
   return metadata->project(o);
 }
 
-// Forward-declare this, but define it after swift_release.
-extern "C" LLVM_LIBRARY_VISIBILITY void
-_swift_release_dealloc(HeapObject *object) SWIFT_CC(RegisterPreservingCC_IMPL)
-    __attribute__((__noinline__, __used__));
-
 SWIFT_RT_ENTRY_VISIBILITY
 extern "C"
 void swift::swift_retain(HeapObject *object)
@@ -246,7 +658,12 @@ void swift::swift_nonatomic_retain(HeapObject *object) {
 SWIFT_RT_ENTRY_IMPL_VISIBILITY
 extern "C"
 void SWIFT_RT_ENTRY_IMPL(swift_nonatomic_retain)(HeapObject *object) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  if (object)
+    retainBiased(object, 1);
+#else
   _swift_nonatomic_retain_inlined(object);
+#endif
 }
 
 SWIFT_RT_ENTRY_VISIBILITY
@@ -258,7 +675,11 @@ void swift::swift_nonatomic_release(HeapObject *object) {
 SWIFT_RT_ENTRY_IMPL_VISIBILITY
 extern "C"
 void SWIFT_RT_ENTRY_IMPL(swift_nonatomic_release)(HeapObject *object) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  if (object  &&  releaseBiasedShouldDeallocate(object, 1)) {
+#else
   if (object  &&  object->refCount.decrementShouldDeallocateNonAtomic()) {
+#endif
     // TODO: Use non-atomic _swift_release_dealloc?
     _swift_release_dealloc(object);
   }
@@ -268,7 +689,12 @@ SWIFT_RT_ENTRY_IMPL_VISIBILITY
 extern "C"
 void SWIFT_RT_ENTRY_IMPL(swift_retain)(HeapObject *object)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  if (object)
+    retainBiased(object, 1);
+#else
   _swift_retain_inlined(object);
+#endif
 }
 
 SWIFT_RT_ENTRY_VISIBILITY
@@ -283,7 +709,11 @@ extern "C"
 void SWIFT_RT_ENTRY_IMPL(swift_retain_n)(HeapObject *object, uint32_t n)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
   if (object) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+    retainBiased(object, n);
+#else
     object->refCount.increment(n);
+#endif
   }
 }
 
@@ -299,7 +729,11 @@ extern "C"
 void SWIFT_RT_ENTRY_IMPL(swift_nonatomic_retain_n)(HeapObject *object, uint32_t n)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
   if (object) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+    retainBiased(object, n);
+#else
     object->refCount.incrementNonAtomic(n);
+#endif
   }
 }
 
@@ -314,7 +748,11 @@ SWIFT_RT_ENTRY_IMPL_VISIBILITY
 extern "C"
 void SWIFT_RT_ENTRY_IMPL(swift_release)(HeapObject *object)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  if (object  &&  releaseBiasedShouldDeallocate(object, 1)) {
+#else
   if (object  &&  object->refCount.decrementShouldDeallocate()) {
+#endif
     _swift_release_dealloc(object);
   }
 }
@@ -329,12 +767,19 @@ SWIFT_RT_ENTRY_IMPL_VISIBILITY
 extern "C"
 void SWIFT_RT_ENTRY_IMPL(swift_release_n)(HeapObject *object, uint32_t n)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  if (object && releaseBiasedShouldDeallocate(object, n)) {
+#else
   if (object && object->refCount.decrementShouldDeallocateN(n)) {
+#endif
     _swift_release_dealloc(object);
   }
 }
 
 void swift::swift_setDeallocating(HeapObject *object) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  unbiasForDeallocation(object);
+#endif
   object->refCount.decrementFromOneAndDeallocateNonAtomic();
 }
 
@@ -348,12 +793,33 @@ SWIFT_RT_ENTRY_IMPL_VISIBILITY
 extern "C"
 void SWIFT_RT_ENTRY_IMPL(swift_nonatomic_release_n)(HeapObject *object, uint32_t n)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  if (object && releaseBiasedShouldDeallocate(object, n)) {
+#else
   if (object && object->refCount.decrementShouldDeallocateNNonAtomic(n)) {
+#endif
     _swift_release_dealloc(object);
   }
 }
 
+void swift::swift_setImmortal(HeapObject *object) {
+  object->refCount.setImmortal();
+}
+
+bool swift::swift_isImmortal(HeapObject *object) {
+  return object->refCount.isImmortal();
+}
+
 size_t swift::swift_retainCount(HeapObject *object) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  if (object->weakRefCount.isBiased()) {
+    auto rc = getBiasedRefCount(object);
+    if (rc->isOwnedByCurrentThread())
+      return rc->Count + object->refCount.getCount() - 1 -
+             (rc->State.load(std::memory_order_acquire)
+                >> BiasedRefCount::OwedShift);
+  }
+#endif
   return object->refCount.getCount();
 }
 
@@ -382,9 +848,8 @@ void swift::swift_unownedRelease(HeapObject *object)
     assert(metadata->isClassObject());
     auto classMetadata = static_cast<const ClassMetadata*>(metadata);
     assert(classMetadata->isTypeMetadata());
-    SWIFT_RT_ENTRY_CALL(swift_slowDealloc)
-        (object, classMetadata->getInstanceSize(),
-         classMetadata->getInstanceAlignMask());
+    deallocObjectMemory(object, classMetadata->getInstanceSize(),
+                        classMetadata->getInstanceAlignMask());
   }
 }
 
@@ -411,9 +876,8 @@ void swift::swift_unownedRelease_n(HeapObject *object, int n)
     assert(metadata->isClassObject());
     auto classMetadata = static_cast<const ClassMetadata*>(metadata);
     assert(classMetadata->isTypeMetadata());
-    SWIFT_RT_ENTRY_CALL(swift_slowDealloc)
-        (object, classMetadata->getInstanceSize(),
-         classMetadata->getInstanceAlignMask());
+    deallocObjectMemory(object, classMetadata->getInstanceSize(),
+                        classMetadata->getInstanceAlignMask());
   }
 }
 
@@ -436,7 +900,11 @@ HeapObject *swift::swift_tryPin(HeapObject *object)
 SWIFT_RT_ENTRY_VISIBILITY
 void swift::swift_unpin(HeapObject *object)
   SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  if (object && unpinBiasedShouldDeallocate(object)) {
+#else
   if (object && object->refCount.decrementAndUnpinShouldDeallocate()) {
+#endif
     _swift_release_dealloc(object);
   }
 }
@@ -466,7 +934,11 @@ HeapObject *swift::swift_nonatomic_tryPin(HeapObject *object)
 SWIFT_RT_ENTRY_VISIBILITY
 void swift::swift_nonatomic_unpin(HeapObject *object)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  if (object && unpinBiasedShouldDeallocate(object)) {
+#else
   if (object && object->refCount.decrementAndUnpinShouldDeallocateNonAtomic()) {
+#endif
     _swift_release_dealloc(object);
   }
 }
@@ -618,7 +1090,11 @@ extern "C" void swift_deallocPartialClassInstance(HeapObject *object,
 #endif
 
   // The strong reference count should be +1 -- tear down the object
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  bool shouldDeallocate = releaseBiasedShouldDeallocate(object, 1);
+#else
   bool shouldDeallocate = object->refCount.decrementShouldDeallocate();
+#endif
   assert(shouldDeallocate);
   (void) shouldDeallocate;
   swift_deallocClassInstance(object, allocatedSize, allocatedAlignMask);
@@ -636,6 +1112,8 @@ static inline void memset_pattern8(void *b, const void *pattern8, size_t len) {
 }
 #endif
 
+static void clearWeakReferenceSideTable(HeapObject *object);
+
 SWIFT_RT_ENTRY_VISIBILITY
 void swift::swift_deallocObject(HeapObject *object,
                                 size_t allocatedSize,
@@ -652,6 +1130,12 @@ void swift::swift_deallocObject(HeapObject *object,
   // If we are tracking leaks, stop tracking this object.
   SWIFT_LEAKS_STOP_TRACKING_OBJECT(object);
 
+  // Native weak references to the object go through its side table, if it
+  // has one. Stop handing it out to new weak references; the ones that
+  // already use it hold an unowned reference that keeps the memory alive.
+  if (object->weakRefCount.hasSideTable())
+    clearWeakReferenceSideTable(object);
+
   // Drop the initial weak retain of the object.
   //
   // If the outstanding weak retain count is 1 (i.e. only the initial
@@ -718,9 +1202,7 @@ void swift::swift_deallocObject(HeapObject *object,
   // atomic decrement (and has the ability to reconstruct
   // allocatedSize and allocatedAlignMask).
   if (object->weakRefCount.getCount() == 1) {
-    SWIFT_RT_ENTRY_CALL(swift_slowDealloc)
-         (object, allocatedSize,
-          allocatedAlignMask);
+    deallocObjectMemory(object, allocatedSize, allocatedAlignMask);
   } else {
     SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
   }
@@ -728,142 +1210,228 @@ void swift::swift_deallocObject(HeapObject *object,
 
 enum: uintptr_t {
   WR_NATIVE = 1<<(swift::heap_object_abi::ObjCReservedLowBits),
-  WR_READING = 1<<(swift::heap_object_abi::ObjCReservedLowBits+1),
 
   WR_NATIVEMASK = WR_NATIVE | swift::heap_object_abi::ObjCReservedBitsMask,
 };
 
-static_assert(WR_READING < alignof(void*),
-              "weakref lock bit mustn't interfere with real pointer bits");
+static_assert(WR_NATIVE < alignof(void*),
+              "weakref native bit mustn't interfere with real pointer bits");
+
+namespace {
+/// The out-of-line state shared by all native weak references to an object.
+///
+/// A native weak reference points at its object's side table rather than at
+/// the object itself. The side table holds one unowned reference to the
+/// object for as long as any weak reference to it exists, so the object's
+/// memory stays allocated, and its strong count stays readable, until the
+/// side table is freed.
+///
+/// Loading through a side table takes no lock and writes nothing but the
+/// object's strong count: it is a single swift_tryRetain, which fails once
+/// the object has begun deallocation.
+class WeakReferenceSideTable {
+  HeapObject * const Object;
+
+  /// One for each weak reference to this table, plus one while the object
+  /// has not been deallocated.
+  std::atomic<uint32_t> RefCount;
+
+public:
+  explicit WeakReferenceSideTable(HeapObject *object)
+    : Object(object), RefCount(1) {
+    SWIFT_RT_ENTRY_CALL(swift_unownedRetain)(object);
+  }
+
+  WeakReferenceSideTable(const WeakReferenceSideTable &) = delete;
+  WeakReferenceSideTable &operator=(const WeakReferenceSideTable &) = delete;
+
+  void retain() {
+    RefCount.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Drop a reference to the side table. Dropping the last one frees the
+  /// table and releases its unowned reference to the object, which frees
+  /// the object's memory if it was deallocated already.
+  void release() {
+    if (RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(Object);
+      delete this;
+    }
+  }
+
+  /// Return true if the object has begun deallocation.
+  bool isObjectDead() const {
+    return Object->refCount.isDeallocating();
+  }
+
+  /// Retain and return the object, or return null if it has begun
+  /// deallocation.
+  HeapObject *tryRetainObject() {
+    return SWIFT_RT_ENTRY_CALL(swift_tryRetain)(Object);
+  }
+};
+
+/// The side tables of all live objects that have native weak references,
+/// split into independently locked stripes keyed by object address.
+///
+/// This is only consulted when a weak reference is formed to an object and
+/// when an object with a side table is deallocated, never when loading.
+class WeakReferenceSideTables {
+  enum : size_t { NumStripes = 64 };
+
+  struct Stripe {
+    Mutex Lock;
+    llvm::DenseMap<HeapObject *, WeakReferenceSideTable *> Tables;
+  };
 
-enum: short {
-  WR_SPINLIMIT = 64,
+  Stripe Stripes[NumStripes];
+
+  Stripe &getStripe(HeapObject *object) {
+    auto value = reinterpret_cast<uintptr_t>(object);
+    return Stripes[((value >> 4) ^ (value >> 10)) % NumStripes];
+  }
+
+public:
+  /// Return the side table for the given object, creating it if necessary,
+  /// with an extra reference held by the caller. Returns null if the object
+  /// is already deallocating.
+  ///
+  /// The caller must keep the object alive for the duration of the call,
+  /// unless it is already deallocating.
+  WeakReferenceSideTable *retainSideTable(HeapObject *object) {
+    if (object->refCount.isDeallocating())
+      return nullptr;
+
+    auto &stripe = getStripe(object);
+    ScopedLock guard(stripe.Lock);
+    auto &table = stripe.Tables[object];
+    if (!table) {
+      table = new WeakReferenceSideTable(object);
+      object->weakRefCount.setHasSideTable();
+    }
+    table->retain();
+    return table;
+  }
+
+  /// Forget the side table of an object that is being deallocated.
+  ///
+  /// Weak references that already point at the side table keep it, and the
+  /// object's memory, alive until they are destroyed.
+  void clearSideTable(HeapObject *object) {
+    WeakReferenceSideTable *table;
+    {
+      auto &stripe = getStripe(object);
+      ScopedLock guard(stripe.Lock);
+      auto found = stripe.Tables.find(object);
+      if (found == stripe.Tables.end())
+        return;
+      table = found->second;
+      stripe.Tables.erase(found);
+    }
+    // Drop the object's reference to the side table.
+    table->release();
+  }
 };
+} // end anonymous namespace
+
+static Lazy<WeakReferenceSideTables> SideTables;
+
+static void clearWeakReferenceSideTable(HeapObject *object) {
+  SideTables.get().clearSideTable(object);
+}
+
+static WeakReferenceSideTable *getSideTable(WeakReference *ref) {
+  // The reference might be visible to other threads that are loading it.
+  auto value = __atomic_load_n(&ref->Value, __ATOMIC_RELAXED);
+  return reinterpret_cast<WeakReferenceSideTable *>(value & ~WR_NATIVE);
+}
+
+static void setSideTable(WeakReference *ref, WeakReferenceSideTable *table) {
+  auto value = table ? (reinterpret_cast<uintptr_t>(table) | WR_NATIVE)
+                     : uintptr_t(0);
+  __atomic_store_n(&ref->Value, value, __ATOMIC_RELAXED);
+}
+
+static WeakReferenceSideTable *retainSideTableFor(HeapObject *object) {
+  if (!object)
+    return nullptr;
+  return SideTables.get().retainSideTable(object);
+}
 
 bool swift::isNativeSwiftWeakReference(WeakReference *ref) {
   return (ref->Value & WR_NATIVEMASK) == WR_NATIVE;
 }
 
 void swift::swift_weakInit(WeakReference *ref, HeapObject *value) {
-  ref->Value = (uintptr_t)value | WR_NATIVE;
-  SWIFT_RT_ENTRY_CALL(swift_unownedRetain)(value);
+  setSideTable(ref, retainSideTableFor(value));
 }
 
 void swift::swift_weakAssign(WeakReference *ref, HeapObject *newValue) {
-  SWIFT_RT_ENTRY_CALL(swift_unownedRetain)(newValue);
-  auto oldValue = (HeapObject*) (ref->Value & ~WR_NATIVE);
-  ref->Value = (uintptr_t)newValue | WR_NATIVE;
-  SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(oldValue);
+  auto newTable = retainSideTableFor(newValue);
+  auto oldTable = getSideTable(ref);
+  setSideTable(ref, newTable);
+  if (oldTable)
+    oldTable->release();
 }
 
 HeapObject *swift::swift_weakLoadStrong(WeakReference *ref) {
-  if (ref->Value == (uintptr_t)nullptr) {
+  auto table = getSideTable(ref);
+  if (!table)
     return nullptr;
-  }
-
-  // ref might be visible to other threads
-  auto ptr = __atomic_fetch_or(&ref->Value, WR_READING, __ATOMIC_RELAXED);
-  while (ptr & WR_READING) {
-    short c = 0;
-    while (__atomic_load_n(&ref->Value, __ATOMIC_RELAXED) & WR_READING) {
-      if (++c == WR_SPINLIMIT) {
-        std::this_thread::yield();
-        c -= 1;
-      }
-    }
-    ptr = __atomic_fetch_or(&ref->Value, WR_READING, __ATOMIC_RELAXED);
-  }
-
-  auto object = (HeapObject*)(ptr & ~WR_NATIVE);
-  if (object == nullptr) {
-    __atomic_store_n(&ref->Value, (uintptr_t)nullptr, __ATOMIC_RELAXED);
-    return nullptr;
-  }
-  if (object->refCount.isDeallocating()) {
-    __atomic_store_n(&ref->Value, (uintptr_t)nullptr, __ATOMIC_RELAXED);
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
-    return nullptr;
-  }
-  auto result = swift_tryRetain(object);
-  __atomic_store_n(&ref->Value, ptr, __ATOMIC_RELAXED);
-  return result;
+  return table->tryRetainObject();
 }
 
 HeapObject *swift::swift_weakTakeStrong(WeakReference *ref) {
-  auto object = (HeapObject*) (ref->Value & ~WR_NATIVE);
-  if (object == nullptr) return nullptr;
-  auto result = swift_tryRetain(object);
-  ref->Value = (uintptr_t)nullptr;
-  swift_unownedRelease(object);
+  auto table = getSideTable(ref);
+  if (!table)
+    return nullptr;
+  auto result = table->tryRetainObject();
+  setSideTable(ref, nullptr);
+  table->release();
   return result;
 }
 
 void swift::swift_weakDestroy(WeakReference *ref) {
-  auto tmp = (HeapObject*) (ref->Value & ~WR_NATIVE);
-  ref->Value = (uintptr_t)nullptr;
-  SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(tmp);
+  auto table = getSideTable(ref);
+  setSideTable(ref, nullptr);
+  if (table)
+    table->release();
 }
 
 void swift::swift_weakCopyInit(WeakReference *dest, WeakReference *src) {
-  if (src->Value == (uintptr_t)nullptr) {
-    dest->Value = (uintptr_t)nullptr;
+  auto table = getSideTable(src);
+  // Don't propagate references to dead objects.
+  if (!table || table->isObjectDead()) {
+    setSideTable(dest, nullptr);
     return;
   }
-
-  // src might be visible to other threads
-  auto ptr = __atomic_fetch_or(&src->Value, WR_READING, __ATOMIC_RELAXED);
-  while (ptr & WR_READING) {
-    short c = 0;
-    while (__atomic_load_n(&src->Value, __ATOMIC_RELAXED) & WR_READING) {
-      if (++c == WR_SPINLIMIT) {
-        std::this_thread::yield();
-        c -= 1;
-      }
-    }
-    ptr = __atomic_fetch_or(&src->Value, WR_READING, __ATOMIC_RELAXED);
-  }
-
-  auto object = (HeapObject*)(ptr & ~WR_NATIVE);
-  if (object == nullptr) {
-    __atomic_store_n(&src->Value, (uintptr_t)nullptr, __ATOMIC_RELAXED);
-    dest->Value = (uintptr_t)nullptr;
-  } else if (object->refCount.isDeallocating()) {
-    __atomic_store_n(&src->Value, (uintptr_t)nullptr, __ATOMIC_RELAXED);
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
-    dest->Value = (uintptr_t)nullptr;
-  } else {
-    SWIFT_RT_ENTRY_CALL(swift_unownedRetain)(object);
-    __atomic_store_n(&src->Value, ptr, __ATOMIC_RELAXED);
-    dest->Value = (uintptr_t)object | WR_NATIVE;
-  }
+  table->retain();
+  setSideTable(dest, table);
 }
 
 void swift::swift_weakTakeInit(WeakReference *dest, WeakReference *src) {
-  auto object = (HeapObject*) (src->Value & ~WR_NATIVE);
-  if (object == nullptr) {
-    dest->Value = (uintptr_t)nullptr;
-  } else if (object->refCount.isDeallocating()) {
-    dest->Value = (uintptr_t)nullptr;
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
-  } else {
-    dest->Value = (uintptr_t)object | WR_NATIVE;
+  auto table = getSideTable(src);
+  setSideTable(src, nullptr);
+  if (table && table->isObjectDead()) {
+    table->release();
+    table = nullptr;
   }
-  src->Value = (uintptr_t)nullptr;
+  setSideTable(dest, table);
 }
 
 void swift::swift_weakCopyAssign(WeakReference *dest, WeakReference *src) {
-  if (dest->Value) {
-    auto object = (HeapObject*) (dest->Value & ~WR_NATIVE);
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
-  }
+  if (dest == src)
+    return;
+  if (auto oldTable = getSideTable(dest))
+    oldTable->release();
   swift_weakCopyInit(dest, src);
 }
 
 void swift::swift_weakTakeAssign(WeakReference *dest, WeakReference *src) {
-  if (dest->Value) {
-    auto object = (HeapObject*) (dest->Value & ~WR_NATIVE);
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
-  }
+  if (dest == src)
+    return;
+  if (auto oldTable = getSideTable(dest))
+    oldTable->release();
   swift_weakTakeInit(dest, src);
 }
 
@@ -118,6 +118,9 @@ static void swift_freeMetadata(void *addr, size_t size) {
 }
 
 void *MetadataAllocator::alloc(size_t size) {
+  if (LLVM_UNLIKELY(areMetadataCacheStatisticsEnabled()))
+    recordMetadataCacheAllocation(Kind, size);
+
   const uintptr_t PageSize = SWIFT_LAZY_CONSTANT(swift_pageSize());
   // If the requested size is a page or larger, map page(s) for it
   // specifically.
@@ -164,6 +167,31 @@ void *MetadataAllocator::alloc(size_t size) {
   }
 }
 
+/// Find or insert an entry in one of the uniquing maps for non-generic
+/// structural types, recording statistics if they are enabled.
+template <class EntryTy, class KeyTy, class... ArgTys>
+static EntryTy *getOrInsertCacheEntry(ConcurrentMap<EntryTy, false> &map,
+                                      MetadataCacheKind kind,
+                                      size_t keyLength, const KeyTy &key,
+                                      const ArgTys &... args) {
+  if (LLVM_LIKELY(!areMetadataCacheStatisticsEnabled()))
+    return map.getOrInsert(key, args...).first;
+
+  auto start = std::chrono::steady_clock::now();
+  auto result = map.getOrInsert(key, args...);
+  recordMetadataCacheLookup(kind, keyLength, /*hit*/ !result.second);
+  if (result.second) {
+    // The lookup time is dominated by the construction of the new entry.
+    recordMetadataCacheInstantiation(kind,
+                                     std::chrono::steady_clock::now() - start);
+    recordMetadataCacheAllocation(kind,
+                                  sizeof(EntryTy) +
+                                    EntryTy::getExtraAllocationSize(key,
+                                                                    args...));
+  }
+  return result.first;
+}
+
 namespace {
   struct GenericCacheEntry;
 
@@ -177,6 +205,9 @@ namespace {
       : CacheEntry<GenericCacheEntry, GenericCacheEntryHeader> {
 
     static const char *getName() { return "GenericCache"; }
+    static MetadataCacheKind getCacheKind() {
+      return MetadataCacheKind::GenericType;
+    }
 
     GenericCacheEntry(unsigned numArguments) {
       NumArguments = numArguments;
@@ -335,6 +366,7 @@ swift::swift_getGenericMetadata(GenericMetadata *pattern,
       auto metadata = pattern->CreateFunction(pattern, arguments);
       auto entry = GenericCacheEntry::getFromMetadata(pattern, metadata);
       entry->Value = metadata;
+      _noteGenericMetadataInstantiation(metadata);
       return entry;
     });
 
@@ -385,7 +417,9 @@ swift::swift_getObjCClassMetadata(const ClassMetadata *theClass) {
   }
 
 #if SWIFT_OBJC_INTEROP
-  return &ObjCClassWrappers.getOrInsert(theClass).first->Data;
+  return &getOrInsertCacheEntry(ObjCClassWrappers,
+                                MetadataCacheKind::ObjCClassWrapper,
+                                /*keyLength*/ 1, theClass)->Data;
 #else
   fatalError(/* flags = */ 0,
              "swift_getObjCClassMetadata: no Objective-C interop");
@@ -504,7 +538,9 @@ swift::swift_getFunctionTypeMetadata3(FunctionTypeFlags flags,
 const FunctionTypeMetadata *
 swift::swift_getFunctionTypeMetadata(const void *flagsArgsAndResult[]) {
   FunctionCacheEntry::Key key = { flagsArgsAndResult };
-  return &FunctionTypes.getOrInsert(key).first->Data;
+  return &getOrInsertCacheEntry(FunctionTypes, MetadataCacheKind::Function,
+                                key.getFlags().getNumArguments() + 1,
+                                key)->Data;
 }
 
 FunctionCacheEntry::FunctionCacheEntry(Key key) {
@@ -1083,7 +1119,8 @@ swift::swift_getTupleTypeMetadata(size_t numElements,
 
   // Search the cache.
   TupleCacheEntry::Key key = { numElements, elements, labels };
-  return &TupleTypes.getOrInsert(key, proposedWitnesses).first->Data;
+  return &getOrInsertCacheEntry(TupleTypes, MetadataCacheKind::Tuple,
+                                numElements, key, proposedWitnesses)->Data;
 }
 
 TupleCacheEntry::TupleCacheEntry(const Key &key,
@@ -1653,7 +1690,7 @@ static ClassMetadata *_swift_initializeSuperclass(ClassMetadata *theClass,
 #if SWIFT_OBJC_INTEROP
 static MetadataAllocator &getResilientMetadataAllocator() {
   // This should be constant-initialized, but this is safe.
-  static MetadataAllocator allocator;
+  static MetadataAllocator allocator(MetadataCacheKind::ResilientClass);
   return allocator;
 }
 #endif
@@ -1897,7 +1934,8 @@ static ConcurrentMap<MetatypeCacheEntry, false> MetatypeTypes;
 SWIFT_RUNTIME_EXPORT
 extern "C" const MetatypeMetadata *
 swift::swift_getMetatypeMetadata(const Metadata *instanceMetadata) {
-  return &MetatypeTypes.getOrInsert(instanceMetadata).first->Data;
+  return &getOrInsertCacheEntry(MetatypeTypes, MetadataCacheKind::Metatype,
+                                /*keyLength*/ 1, instanceMetadata)->Data;
 }
 
 /***************************************************************************/
@@ -1980,8 +2018,9 @@ getExistentialMetatypeValueWitnesses(unsigned numWitnessTables) {
   static_assert(3 * sizeof(void*) >= sizeof(ValueBuffer),
                 "not handling all possible inline-storage class existentials!");
 
-  return &ExistentialMetatypeValueWitnessTables.getOrInsert(numWitnessTables)
-                                               .first->Data;
+  return &getOrInsertCacheEntry(ExistentialMetatypeValueWitnessTables,
+                                MetadataCacheKind::ExistentialValueWitnesses,
+                                /*keyLength*/ 1, numWitnessTables)->Data;
 }
 
 ExistentialMetatypeValueWitnessTableCacheEntry::
@@ -2014,7 +2053,9 @@ ExistentialMetatypeValueWitnessTableCacheEntry(unsigned numWitnessTables) {
 SWIFT_RUNTIME_EXPORT
 extern "C" const ExistentialMetatypeMetadata *
 swift::swift_getExistentialMetatypeMetadata(const Metadata *instanceMetadata) {
-  return &ExistentialMetatypes.getOrInsert(instanceMetadata).first->Data;
+  return &getOrInsertCacheEntry(ExistentialMetatypes,
+                                MetadataCacheKind::ExistentialMetatype,
+                                /*keyLength*/ 1, instanceMetadata)->Data;
 }
 
 ExistentialMetatypeCacheEntry::ExistentialMetatypeCacheEntry(
@@ -2147,8 +2188,9 @@ getOpaqueExistentialValueWitnesses(unsigned numWitnessTables) {
   if (numWitnessTables == 1)
     return &OpaqueExistentialValueWitnesses_1;
 
-  return &OpaqueExistentialValueWitnessTables.getOrInsert(numWitnessTables)
-                                             .first->Data;
+  return &getOrInsertCacheEntry(OpaqueExistentialValueWitnessTables,
+                                MetadataCacheKind::ExistentialValueWitnesses,
+                                /*keyLength*/ 1, numWitnessTables)->Data;
 }
 
 OpaqueExistentialValueWitnessTableCacheEntry::
@@ -2202,8 +2244,9 @@ getClassExistentialValueWitnesses(unsigned numWitnessTables) {
   static_assert(3 * sizeof(void*) >= sizeof(ValueBuffer),
                 "not handling all possible inline-storage class existentials!");
 
-  return &ClassExistentialValueWitnessTables.getOrInsert(numWitnessTables)
-                                            .first->Data;
+  return &getOrInsertCacheEntry(ClassExistentialValueWitnessTables,
+                                MetadataCacheKind::ExistentialValueWitnesses,
+                                /*keyLength*/ 1, numWitnessTables)->Data;
 }
 
 ClassExistentialValueWitnessTableCacheEntry::
@@ -2425,7 +2468,9 @@ swift::swift_getExistentialTypeMetadata(size_t numProtocols,
   std::sort(protocols, protocols + numProtocols);
 
   ExistentialCacheEntry::Key key = { numProtocols, protocols };
-  return &ExistentialTypes.getOrInsert(key).first->Data;
+  return &getOrInsertCacheEntry(ExistentialTypes,
+                                MetadataCacheKind::Existential,
+                                numProtocols, key)->Data;
 }
 
 ExistentialCacheEntry::ExistentialCacheEntry(Key key) {
@@ -2706,6 +2751,9 @@ namespace {
   class WitnessTableCacheEntry : public CacheEntry<WitnessTableCacheEntry> {
   public:
     static const char *getName() { return "WitnessTableCache"; }
+    static MetadataCacheKind getCacheKind() {
+      return MetadataCacheKind::GenericWitnessTable;
+    }
 
     WitnessTableCacheEntry(size_t numArguments) {
       assert(numArguments == getNumArguments());
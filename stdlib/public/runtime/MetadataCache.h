@@ -17,6 +17,7 @@
 #include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Mutex.h"
+#include <chrono>
 #include <condition_variable>
 #include <thread>
 
@@ -26,6 +27,39 @@
 
 namespace swift {
 
+/// The kinds of metadata cache that statistics are kept for.
+enum class MetadataCacheKind : unsigned {
+  GenericType,
+  GenericWitnessTable,
+  Box,
+  Tuple,
+  Function,
+  Metatype,
+  ExistentialMetatype,
+  Existential,
+  ExistentialValueWitnesses,
+  ObjCClassWrapper,
+  ResilientClass,
+
+  Last_Kind = ResilientClass
+};
+
+/// Whether metadata cache statistics are being collected. They are collected
+/// if SWIFT_DEBUG_METADATA_CACHE_STATISTICS is set in the environment at
+/// startup, and are then printed to stderr at exit.
+bool areMetadataCacheStatisticsEnabled();
+
+/// Record a lookup in a metadata cache for a key of the given length.
+void recordMetadataCacheLookup(MetadataCacheKind kind, size_t keyLength,
+                               bool hit);
+
+/// Record the time taken to instantiate a cache entry after a miss.
+void recordMetadataCacheInstantiation(MetadataCacheKind kind,
+                                      std::chrono::nanoseconds time);
+
+/// Record memory allocated on behalf of a metadata cache.
+void recordMetadataCacheAllocation(MetadataCacheKind kind, size_t size);
+
 /// A bump pointer for metadata allocations. Since metadata is (currently)
 /// never released, it does not support deallocation. This allocator by itself
 /// is not thread-safe; in concurrent uses, allocations must be guarded by
@@ -38,9 +72,13 @@ class MetadataAllocator {
   /// Initializing to -1 instead of nullptr ensures that the first allocation
   /// triggers a page allocation since it will always span a "page" boundary.
   std::atomic<uintptr_t> NextValue;
+
+  /// The cache this allocator allocates for, for statistics.
+  MetadataCacheKind Kind;
   
 public:
-  constexpr MetadataAllocator() : NextValue(~(uintptr_t)0) {}
+  constexpr MetadataAllocator(MetadataCacheKind kind)
+    : NextValue(~(uintptr_t)0), Kind(kind) {}
 
   // Don't copy or move, please.
   MetadataAllocator(const MetadataAllocator &) = delete;
@@ -238,6 +276,10 @@ template <class ValueTy> class MetadataCache {
       return key.KeyData.size() * sizeof(void*);
     }
 
+    static size_t getKeyHash(const Key &key) {
+      return key.Hash;
+    }
+
     int compareWithKey(const Key &key) const {
       // Order by hash first, then by the actual key data.
       if (key.Hash != Hash) {
@@ -261,10 +303,7 @@ template <class ValueTy> class MetadataCache {
   };
 
   /// The concurrent map.
-  ConcurrentMap<Entry> Map;
-
-  static_assert(sizeof(Map) == 2 * sizeof(void*),
-                "offset of Head is not at proper offset");
+  ConcurrentHashMap<Entry> Map;
 
   struct ConcurrencyControl {
     Mutex Lock;
@@ -276,7 +315,9 @@ template <class ValueTy> class MetadataCache {
   MetadataAllocator Allocator;
   
 public:
-  MetadataCache() : Concurrency(new ConcurrencyControl()) {}
+  MetadataCache()
+    : Concurrency(new ConcurrencyControl()),
+      Allocator(ValueTy::getCacheKind()) {}
   ~MetadataCache() {}
 
   /// Caches are not copyable.
@@ -312,6 +353,11 @@ public:
     auto insertResult = Map.getOrInsert(key);
     Entry *entry = insertResult.first;
 
+    bool collectStatistics = areMetadataCacheStatisticsEnabled();
+    if (LLVM_UNLIKELY(collectStatistics))
+      recordMetadataCacheLookup(ValueTy::getCacheKind(), numArguments,
+                                /*hit*/ !insertResult.second);
+
     // If we didn't insert the entry, then we just need to get the
     // initialized value from the entry.
     if (!insertResult.second) {
@@ -349,8 +395,20 @@ public:
 
     // Otherwise, we created the entry and are responsible for
     // creating the metadata.
+    std::chrono::steady_clock::time_point start;
+    if (LLVM_UNLIKELY(collectStatistics))
+      start = std::chrono::steady_clock::now();
+
     auto value = builder();
 
+    if (LLVM_UNLIKELY(collectStatistics)) {
+      recordMetadataCacheInstantiation(ValueTy::getCacheKind(),
+                                       std::chrono::steady_clock::now() - start);
+      recordMetadataCacheAllocation(ValueTy::getCacheKind(),
+                                    sizeof(Entry) +
+                                      Entry::getExtraAllocationSize(key));
+    }
+
 #if SWIFT_DEBUG_RUNTIME
         printf("%s(%p): created %p\n",
                ValueTy::getName(), (void*) this, value);
@@ -0,0 +1,168 @@
+//===--- MetadataCacheStatistics.cpp - Metadata cache instrumentation -----===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Opt-in counters for the runtime's metadata caches.
+//
+// When SWIFT_DEBUG_METADATA_CACHE_STATISTICS is set in the environment at
+// startup, every metadata cache records its lookups, hits, misses, key
+// lengths, instantiation time, and the memory allocated on its behalf.
+// The statistics are printed to stderr at exit, and can be printed at any
+// other time by calling swift_dumpMetadataCacheStatistics.
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Metadata.h"
+#include "MetadataCache.h"
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace swift;
+
+namespace {
+
+/// Key lengths are bucketed as 0, 1, 2, 3, 4, 5-8, 9-16 and 17 or more.
+constexpr unsigned NumKeyLengthBuckets = 8;
+
+struct MetadataCacheStatistics {
+  std::atomic<uint64_t> Hits{0};
+  std::atomic<uint64_t> Misses{0};
+  std::atomic<uint64_t> InstantiationNanoseconds{0};
+  std::atomic<uint64_t> MaxInstantiationNanoseconds{0};
+  std::atomic<uint64_t> AllocatedBytes{0};
+  std::atomic<uint64_t> MaxKeyLength{0};
+  std::atomic<uint64_t> KeyLengths[NumKeyLengthBuckets] = {};
+};
+
+constexpr unsigned NumMetadataCacheKinds =
+  unsigned(MetadataCacheKind::Last_Kind) + 1;
+
+} // end anonymous namespace
+
+static MetadataCacheStatistics Statistics[NumMetadataCacheKinds];
+
+static const char *getMetadataCacheKindName(MetadataCacheKind kind) {
+  switch (kind) {
+  case MetadataCacheKind::GenericType: return "generic type";
+  case MetadataCacheKind::GenericWitnessTable: return "generic witness table";
+  case MetadataCacheKind::Box: return "box";
+  case MetadataCacheKind::Tuple: return "tuple";
+  case MetadataCacheKind::Function: return "function";
+  case MetadataCacheKind::Metatype: return "metatype";
+  case MetadataCacheKind::ExistentialMetatype: return "existential metatype";
+  case MetadataCacheKind::Existential: return "existential";
+  case MetadataCacheKind::ExistentialValueWitnesses:
+    return "existential value witnesses";
+  case MetadataCacheKind::ObjCClassWrapper: return "ObjC class wrapper";
+  case MetadataCacheKind::ResilientClass: return "resilient class";
+  }
+  return "<unknown>";
+}
+
+static unsigned getKeyLengthBucket(size_t keyLength) {
+  if (keyLength <= 4)
+    return unsigned(keyLength);
+  if (keyLength <= 8)
+    return 5;
+  if (keyLength <= 16)
+    return 6;
+  return 7;
+}
+
+static void updateMaximum(std::atomic<uint64_t> &maximum, uint64_t value) {
+  uint64_t current = maximum.load(std::memory_order_relaxed);
+  while (current < value &&
+         !maximum.compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+static void dumpMetadataCacheStatisticsAtExit() {
+  swift_dumpMetadataCacheStatistics();
+}
+
+static bool initializeMetadataCacheStatistics() {
+  if (!getenv("SWIFT_DEBUG_METADATA_CACHE_STATISTICS"))
+    return false;
+  atexit(dumpMetadataCacheStatisticsAtExit);
+  return true;
+}
+
+bool swift::areMetadataCacheStatisticsEnabled() {
+  return SWIFT_LAZY_CONSTANT(initializeMetadataCacheStatistics());
+}
+
+void swift::recordMetadataCacheLookup(MetadataCacheKind kind,
+                                      size_t keyLength, bool hit) {
+  auto &stats = Statistics[unsigned(kind)];
+  if (hit)
+    stats.Hits.fetch_add(1, std::memory_order_relaxed);
+  else
+    stats.Misses.fetch_add(1, std::memory_order_relaxed);
+  stats.KeyLengths[getKeyLengthBucket(keyLength)]
+    .fetch_add(1, std::memory_order_relaxed);
+  updateMaximum(stats.MaxKeyLength, keyLength);
+}
+
+void swift::recordMetadataCacheInstantiation(MetadataCacheKind kind,
+                                             std::chrono::nanoseconds time) {
+  auto &stats = Statistics[unsigned(kind)];
+  uint64_t ns = time.count() < 0 ? 0 : uint64_t(time.count());
+  stats.InstantiationNanoseconds.fetch_add(ns, std::memory_order_relaxed);
+  updateMaximum(stats.MaxInstantiationNanoseconds, ns);
+}
+
+void swift::recordMetadataCacheAllocation(MetadataCacheKind kind,
+                                          size_t size) {
+  Statistics[unsigned(kind)].AllocatedBytes.fetch_add(
+    size, std::memory_order_relaxed);
+}
+
+SWIFT_RUNTIME_EXPORT
+extern "C" void swift::swift_dumpMetadataCacheStatistics() {
+  if (!areMetadataCacheStatisticsEnabled()) {
+    fprintf(stderr, "Metadata cache statistics are not being collected; "
+                    "set SWIFT_DEBUG_METADATA_CACHE_STATISTICS in the "
+                    "environment to collect them.\n");
+    return;
+  }
+
+  fprintf(stderr, "%-28s %10s %10s %12s %10s %12s  %s\n",
+          "metadata cache", "hits", "misses", "inst. us", "max us",
+          "bytes", "key lengths (0,1,2,3,4,5-8,9-16,17+; max)");
+
+  for (unsigned i = 0; i != NumMetadataCacheKinds; ++i) {
+    auto &stats = Statistics[i];
+    uint64_t hits = stats.Hits.load(std::memory_order_relaxed);
+    uint64_t misses = stats.Misses.load(std::memory_order_relaxed);
+    uint64_t bytes = stats.AllocatedBytes.load(std::memory_order_relaxed);
+    if (hits == 0 && misses == 0 && bytes == 0)
+      continue;
+
+    fprintf(stderr, "%-28s %10" PRIu64 " %10" PRIu64 " %12.1f %10.1f "
+                    "%12" PRIu64 " ",
+            getMetadataCacheKindName(MetadataCacheKind(i)), hits, misses,
+            stats.InstantiationNanoseconds.load(std::memory_order_relaxed)
+              / 1000.0,
+            stats.MaxInstantiationNanoseconds.load(std::memory_order_relaxed)
+              / 1000.0,
+            bytes);
+    for (unsigned bucket = 0; bucket != NumKeyLengthBuckets; ++bucket) {
+      fprintf(stderr, "%s%" PRIu64, bucket == 0 ? " " : ",",
+              stats.KeyLengths[bucket].load(std::memory_order_relaxed));
+    }
+    fprintf(stderr, "; %" PRIu64 "\n",
+            stats.MaxKeyLength.load(std::memory_order_relaxed));
+  }
+}
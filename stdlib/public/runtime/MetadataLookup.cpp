@@ -288,6 +288,31 @@ _typeByMangledName(const llvm::StringRef typeName) {
   return foundMetadata;
 }
 
+const NominalTypeDescriptor *
+swift::_searchGenericTypeDescriptorsByMangledName(
+                                             const llvm::StringRef typeName) {
+  auto &T = TypeMetadataRecords.get();
+  const NominalTypeDescriptor *foundDescriptor = nullptr;
+
+  T.SectionsToScanLock.withLock([&] {
+    for (auto &section : T.SectionsToScan) {
+      for (const auto &record : section) {
+        if (record.getTypeKind()
+              != TypeMetadataRecordKind::UniqueNominalTypeDescriptor)
+          continue;
+        auto ntd = record.getNominalTypeDescriptor();
+        if (ntd && ntd->GenericParams.isGeneric() &&
+            ntd->Name.get() == typeName) {
+          foundDescriptor = ntd;
+          return;
+        }
+      }
+    }
+  });
+
+  return foundDescriptor;
+}
+
 /// Return the type metadata for a given mangled name, used in the
 /// implementation of _typeByName(). The human readable name returned
 /// by swift_getTypeName() is non-unique, so we used mangled names
@@ -153,9 +153,40 @@ namespace swift {
                                   const Metadata *metadata,
                                   const NominalTypeDescriptor *ntd);
 
+  /// The number of protocol conformance sections registered so far. A
+  /// failed conformance lookup remains valid until this changes.
+  size_t _getProtocolConformanceGeneration();
+
   const Metadata *
   _searchConformancesByMangledTypeName(const llvm::StringRef typeName);
 
+  /// Find the protocol whose name is the given mangled name among the
+  /// protocols that have registered conformances.
+  const ProtocolDescriptor *
+  _searchConformancesByMangledProtocolName(const llvm::StringRef protocolName);
+
+  /// Find the protocol of the registered conformance whose static witness
+  /// table is the given table.
+  const ProtocolDescriptor *
+  _searchConformancesByStaticWitnessTable(const WitnessTable *table);
+
+  /// Find the nominal type descriptor of the generic type with the given
+  /// mangled name among the registered type metadata records.
+  const NominalTypeDescriptor *
+  _searchGenericTypeDescriptorsByMangledName(const llvm::StringRef typeName);
+
+  /// Note that generic metadata was instantiated, for the generic metadata
+  /// profile.
+  void _noteGenericMetadataInstantiation(const Metadata *metadata);
+
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  /// Return whether \p object is uniquely referenced, or pinned if
+  /// \p orPinned is set, taking its biased reference count into account.
+  /// Threads other than the object's owner may get a false negative.
+  bool _swift_isUniquelyReferencedBiased(const HeapObject *object,
+                                         bool orPinned);
+#endif
+
 #if SWIFT_OBJC_INTEROP
   Demangle::NodePointer _swift_buildDemanglingForMetadata(const Metadata *type);
 #endif
@@ -19,8 +19,12 @@
 #include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Mutex.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Hashing.h"
 #include "Private.h"
 
+#include <algorithm>
+
 #if defined(__APPLE__) && defined(__MACH__)
 #include <mach-o/dyld.h>
 #include <mach-o/getsect.h>
@@ -155,8 +159,68 @@ const {
 #endif
 
 namespace {
+  /// An index from protocol descriptor to the conformance records for that
+  /// protocol within a single conformance section.
+  ///
+  /// Registering an image only records the bounds of its section; the
+  /// records are sorted by protocol the first time a lookup visits the
+  /// section, so images whose conformances are never searched cost nothing
+  /// beyond that. Once built, the sorted records are never modified, so
+  /// they can be read without locking. Only the protocol is used as a key:
+  /// the type reference in a record cannot be resolved to its canonical
+  /// metadata while the image is still being loaded, so type filtering is
+  /// left to the lookup.
+  class ConformanceSectionIndex {
+    struct SortedRecords {
+      /// The records of the section that have a protocol, sorted by
+      /// protocol.
+      const ProtocolConformanceRecord **Records;
+      size_t Count;
+    };
+
+    const ProtocolConformanceRecord *Begin, *End;
+    mutable std::atomic<const SortedRecords *> Sorted;
+
+    const SortedRecords *sort() const;
+
+    static bool protocolLess(const ProtocolConformanceRecord *record,
+                             const ProtocolDescriptor *protocol) {
+      return uintptr_t(record->getProtocol()) < uintptr_t(protocol);
+    }
+
+  public:
+    ConformanceSectionIndex(const ProtocolConformanceRecord *begin,
+                            const ProtocolConformanceRecord *end)
+      : Begin(begin), End(end), Sorted(nullptr) {}
+
+    ConformanceSectionIndex(const ConformanceSectionIndex &) = delete;
+    ConformanceSectionIndex &
+    operator=(const ConformanceSectionIndex &) = delete;
+
+    /// Return the records in this section that conform to the given protocol.
+    ArrayRef<const ProtocolConformanceRecord *>
+    lookup(const ProtocolDescriptor *protocol) const {
+      auto sorted = Sorted.load(std::memory_order_acquire);
+      if (!sorted)
+        sorted = sort();
+
+      auto first = std::lower_bound(sorted->Records,
+                                    sorted->Records + sorted->Count,
+                                    protocol, protocolLess);
+      auto last = first;
+      while (last != sorted->Records + sorted->Count &&
+             (*last)->getProtocol() == protocol)
+        ++last;
+      return {first, last};
+    }
+  };
+
   struct ConformanceSection {
     const ProtocolConformanceRecord *Begin, *End;
+    /// The index for this section. Sections are never unregistered, so the
+    /// index is never destroyed.
+    const ConformanceSectionIndex *Index;
+
     const ProtocolConformanceRecord *begin() const {
       return Begin;
     }
@@ -204,6 +268,10 @@ namespace {
       return 0;
     }
 
+    static size_t getKeyHash(const ConformanceCacheKey &key) {
+      return llvm::hash_combine(key.Type, key.Proto);
+    }
+
     bool isSuccessful() const {
       return Table.load(std::memory_order_relaxed) != nullptr;
     }
@@ -213,7 +281,11 @@ namespace {
     }
 
     void updateFailureGeneration(uintptr_t failureGeneration) {
-      assert(!isSuccessful());
+      // Lookups are not serialized, so another thread may have found a
+      // conformance in a newer section while we were scanning older ones.
+      // A successful entry is final.
+      if (isSuccessful())
+        return;
       FailureGeneration.store(failureGeneration, std::memory_order_relaxed);
     }
     
@@ -246,12 +318,13 @@ static void _addImageProtocolConformancesBlock(const uint8_t *conformances,
 #endif
 
 struct ConformanceState {
-  ConcurrentMap<ConformanceCacheEntry> Cache;
-  std::vector<ConformanceSection> SectionsToScan;
+  ConcurrentHashMap<ConformanceCacheEntry> Cache;
+  /// The registered conformance sections. Readers take lock-free snapshots;
+  /// SectionsToScanLock only serializes registration.
+  ConcurrentReadableArray<ConformanceSection> SectionsToScan;
   Mutex SectionsToScanLock;
   
   ConformanceState() {
-    SectionsToScan.reserve(16);
 #if defined(__APPLE__) && defined(__MACH__)
     _initializeCallbacksToInspectDylib();
 #else
@@ -272,8 +345,8 @@ struct ConformanceState {
     }
   }
 
-  void cacheFailure(const void *type, const ProtocolDescriptor *proto) {
-    uintptr_t failureGeneration = SectionsToScan.size();
+  void cacheFailure(const void *type, const ProtocolDescriptor *proto,
+                    uintptr_t failureGeneration) {
     auto result = Cache.getOrInsert(ConformanceCacheKey(type, proto),
                                     (const WitnessTable *) nullptr,
                                     failureGeneration);
@@ -292,12 +365,49 @@ struct ConformanceState {
 
 static Lazy<ConformanceState> Conformances;
 
+const ConformanceSectionIndex::SortedRecords *
+ConformanceSectionIndex::sort() const {
+  // Collect the records that name a protocol. A weak-linked protocol may be
+  // missing at runtime, in which case the record can never match.
+  auto sorted = new SortedRecords{nullptr, 0};
+  size_t numRecords = End - Begin;
+  if (numRecords != 0) {
+    sorted->Records = new const ProtocolConformanceRecord *[numRecords];
+    for (auto record = Begin; record != End; ++record)
+      if (record->getProtocol())
+        sorted->Records[sorted->Count++] = record;
+  }
+
+  // Group the records by protocol, preserving section order within a group.
+  std::stable_sort(sorted->Records, sorted->Records + sorted->Count,
+                   [](const ProtocolConformanceRecord *lhs,
+                      const ProtocolConformanceRecord *rhs) {
+                     return uintptr_t(lhs->getProtocol())
+                          < uintptr_t(rhs->getProtocol());
+                   });
+
+  // Another thread may have sorted the section at the same time; keep
+  // whichever result was published first.
+  const SortedRecords *expected = nullptr;
+  if (!Sorted.compare_exchange_strong(expected, sorted,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+    delete[] sorted->Records;
+    delete sorted;
+    return expected;
+  }
+  return sorted;
+}
+
 static void
 _registerProtocolConformances(ConformanceState &C,
                               const ProtocolConformanceRecord *begin,
                               const ProtocolConformanceRecord *end) {
+  // The index is filled in by the first lookup that visits the section.
+  auto index = new ConformanceSectionIndex(begin, end);
+
   ScopedLock guard(C.SectionsToScanLock);
-  C.SectionsToScan.push_back(ConformanceSection{begin, end});
+  C.SectionsToScan.push_back(ConformanceSection{begin, end, index});
 }
 
 static void _addImageProtocolConformancesBlock(const uint8_t *conformances,
@@ -449,10 +559,6 @@ void swift::_swift_initializeCallbacksToInspectDylib(
 # error No known mechanism to inspect dynamic libraries on this platform.
 #endif
 
-// This variable is used to signal when a cache was generated and
-// it is correct to avoid a new scan.
-static unsigned ConformanceCacheGeneration = 0;
-
 void
 swift::swift_registerProtocolConformances(const ProtocolConformanceRecord *begin,
                                           const ProtocolConformanceRecord *end){
@@ -566,14 +672,12 @@ swift::swift_conformsToProtocol(const Metadata *type,
                                 const ProtocolDescriptor *protocol) {
   auto &C = Conformances.get();
   auto origType = type;
-  unsigned numSections = 0;
+  size_t numSections = 0;
   ConformanceCacheEntry *foundEntry;
 
 recur:
-  // See if we have a cached conformance. The ConcurrentMap data structure
-  // allows us to insert and search the map concurrently without locking.
-  // We do lock the slow path because the SectionsToScan data structure is not
-  // concurrent.
+  // See if we have a cached conformance. The ConcurrentHashMap data
+  // structure allows us to search the map concurrently without locking.
   auto FoundConformance = searchInConformanceCache(type, protocol, foundEntry);
   // The negative answer does not always mean that there is no conformance,
   // unless it is an exact match on the type. If it is not an exact match,
@@ -585,56 +689,43 @@ recur:
   }
 
   // If we didn't have an up-to-date cache entry, scan the conformance records.
-  C.SectionsToScanLock.lock();
-  unsigned failedGeneration = ConformanceCacheGeneration;
-
-  // If we have no new information to pull in (and nobody else pulled in
-  // new information while we waited on the lock), we're done.
-  if (C.SectionsToScan.size() == numSections) {
-    if (failedGeneration != ConformanceCacheGeneration) {
-      // Someone else pulled in new conformances while we were waiting.
-      // Start over with our newly-populated cache.
-      C.SectionsToScanLock.unlock();
-      type = origType;
-      goto recur;
-    }
-
+  // Sections are only ever appended, so a snapshot stays valid while we scan
+  // it without holding any lock. Other threads may be scanning the same
+  // sections concurrently; they will cache the same results.
+  auto sections = C.SectionsToScan.snapshot();
 
+  // If we have no new information to pull in, we're done.
+  if (sections.size() == numSections) {
     // Save the failure for this type-protocol pair in the cache.
-    C.cacheFailure(type, protocol);
-
-    C.SectionsToScanLock.unlock();
+    C.cacheFailure(type, protocol, numSections);
     return nullptr;
   }
 
   // Update the last known number of sections to scan.
-  numSections = C.SectionsToScan.size();
+  numSections = sections.size();
 
   // Scan only sections that were not scanned yet.
-  unsigned sectionIdx = foundEntry ? foundEntry->getFailureGeneration() : 0;
-  unsigned endSectionIdx = C.SectionsToScan.size();
+  size_t sectionIdx = foundEntry ? foundEntry->getFailureGeneration() : 0;
+  size_t endSectionIdx = sections.size();
 
   for (; sectionIdx < endSectionIdx; ++sectionIdx) {
-    auto &section = C.SectionsToScan[sectionIdx];
-    // Eagerly pull records for nondependent witnesses into our cache.
-    for (const auto &record : section) {
-      // If the record applies to a specific type, cache it.
-      if (auto metadata = record.getCanonicalTypeMetadata()) {
-        auto P = record.getProtocol();
-
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
+    auto &section = sections[sectionIdx];
+    // Eagerly pull records for nondependent witnesses into our cache. The
+    // section index only yields records for the requested protocol.
+    for (const auto *record : section.Index->lookup(protocol)) {
+      assert(record->getProtocol() == protocol);
 
+      // If the record applies to a specific type, cache it.
+      if (auto metadata = record->getCanonicalTypeMetadata()) {
         if (!isRelatedType(type, metadata, /*isMetadata=*/true))
           continue;
 
         // Store the type-protocol pair in the cache.
-        auto witness = record.getWitnessTable(metadata);
+        auto witness = record->getWitnessTable(metadata);
         if (witness) {
-          C.cacheSuccess(metadata, P, witness);
+          C.cacheSuccess(metadata, protocol, witness);
         } else {
-          C.cacheFailure(metadata, P);
+          C.cacheFailure(metadata, protocol, numSections);
         }
 
       // If the record provides a nondependent witness table for all instances
@@ -642,46 +733,37 @@ recur:
       // TODO: "Nondependent witness table" probably deserves its own flag.
       // An accessor function might still be necessary even if the witness table
       // can be shared.
-      } else if (record.getTypeKind()
+      } else if (record->getTypeKind()
                    == TypeMetadataRecordKind::UniqueNominalTypeDescriptor
-                 && record.getConformanceKind()
+                 && record->getConformanceKind()
                    == ProtocolConformanceReferenceKind::WitnessTable) {
 
-        auto R = record.getNominalTypeDescriptor();
-        auto P = record.getProtocol();
-
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
+        auto R = record->getNominalTypeDescriptor();
 
         if (!isRelatedType(type, R, /*isMetadata=*/false))
           continue;
 
         // Store the type-protocol pair in the cache.
-        C.cacheSuccess(R, P, record.getStaticWitnessTable());
+        C.cacheSuccess(R, protocol, record->getStaticWitnessTable());
       }
     }
   }
-  ++ConformanceCacheGeneration;
 
-  C.SectionsToScanLock.unlock();
   // Start over with our newly-populated cache.
   type = origType;
   goto recur;
 }
 
+size_t swift::_getProtocolConformanceGeneration() {
+  return Conformances.get().SectionsToScan.size();
+}
+
 const Metadata *
 swift::_searchConformancesByMangledTypeName(const llvm::StringRef typeName) {
   auto &C = Conformances.get();
   const Metadata *foundMetadata = nullptr;
 
-  ScopedLock guard(C.SectionsToScanLock);
-
-  unsigned sectionIdx = 0;
-  unsigned endSectionIdx = C.SectionsToScan.size();
-
-  for (; sectionIdx < endSectionIdx; ++sectionIdx) {
-    auto &section = C.SectionsToScan[sectionIdx];
+  for (auto &section : C.SectionsToScan.snapshot()) {
     for (const auto &record : section) {
       if (auto metadata = record.getCanonicalTypeMetadata())
         foundMetadata = _matchMetadataByMangledTypeName(typeName, metadata, nullptr);
@@ -697,3 +779,35 @@ swift::_searchConformancesByMangledTypeName(const llvm::StringRef typeName) {
 
   return foundMetadata;
 }
+
+const ProtocolDescriptor *
+swift::_searchConformancesByMangledProtocolName(
+                                         const llvm::StringRef protocolName) {
+  auto &C = Conformances.get();
+
+  for (auto &section : C.SectionsToScan.snapshot()) {
+    for (const auto &record : section) {
+      auto protocol = record.getProtocol();
+      if (protocol && protocol->Name && protocolName == protocol->Name)
+        return protocol;
+    }
+  }
+
+  return nullptr;
+}
+
+const ProtocolDescriptor *
+swift::_searchConformancesByStaticWitnessTable(const WitnessTable *table) {
+  auto &C = Conformances.get();
+
+  for (auto &section : C.SectionsToScan.snapshot()) {
+    for (const auto &record : section) {
+      if (record.getConformanceKind()
+            == ProtocolConformanceReferenceKind::WitnessTable &&
+          record.getStaticWitnessTable() == table)
+        return record.getProtocol();
+    }
+  }
+
+  return nullptr;
+}
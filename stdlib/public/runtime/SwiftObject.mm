@@ -1338,7 +1338,11 @@ bool swift::swift_isUniquelyReferenced_nonNull_native(
 ) SWIFT_CC(RegisterPreservingCC_IMPL) {
   assert(object != nullptr);
   assert(!object->refCount.isDeallocating());
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  return _swift_isUniquelyReferencedBiased(object, /*orPinned*/ false);
+#else
   return object->refCount.isUniquelyReferenced();
+#endif
 }
 
 bool swift::swift_isUniquelyReferenced_native(const HeapObject* object) {
@@ -1448,7 +1452,11 @@ bool swift::swift_isUniquelyReferencedOrPinned_nonNull_native(
   SWIFT_CC(RegisterPreservingCC_IMPL) {
   assert(object != nullptr);
   assert(!object->refCount.isDeallocating());
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  return _swift_isUniquelyReferencedBiased(object, /*orPinned*/ true);
+#else
   return object->refCount.isUniquelyReferencedOrPinned();
+#endif
 }
 
 using ClassExtents = TwoWordPair<size_t, size_t>;
@@ -30,6 +30,7 @@ swift::_SwiftEmptyArrayStorage swift::_swiftEmptyArrayStorage = {
   // HeapObject header;
   {
     &_TMCs18_EmptyArrayStorage, // isa pointer
+    StrongRefCount::Immortal    // shared by every empty array; never freed
   },
   
   // _SwiftArrayBodyStorage body;
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Heap.h"
 #include "../SwiftShims/LibcShims.h"
 #include "llvm/Support/DataTypes.h"
 
@@ -85,28 +86,45 @@ int swift::_swift_stdlib_close(int fd) {
 
 #if defined(__APPLE__)
 #include <malloc/malloc.h>
-size_t swift::_swift_stdlib_malloc_size(const void *ptr) {
+static size_t getMallocSize(const void *ptr) {
   return malloc_size(ptr);
 }
 #elif defined(__GNU_LIBRARY__) || defined(__CYGWIN__) || defined(__ANDROID__)
 #include <malloc.h>
-size_t swift::_swift_stdlib_malloc_size(const void *ptr) {
+static size_t getMallocSize(const void *ptr) {
   return malloc_usable_size(const_cast<void *>(ptr));
 }
 #elif defined(_MSC_VER)
 #include <malloc.h>
-size_t swift::_swift_stdlib_malloc_size(const void *ptr) {
+static size_t getMallocSize(const void *ptr) {
   return _msize(const_cast<void *>(ptr));
 }
 #elif defined(__FreeBSD__)
 #include <malloc_np.h>
-size_t swift::_swift_stdlib_malloc_size(const void *ptr) {
+static size_t getMallocSize(const void *ptr) {
   return malloc_usable_size(const_cast<void *>(ptr));
 }
 #else
 #error No malloc_size analog known for this platform/libc.
 #endif
 
+static size_t getAllocationSize(const void *ptr) {
+  // Small blocks may come from the runtime's own allocator rather than
+  // from malloc.
+  if (size_t size = _swift_slowAllocGetUsableSize(ptr))
+    return size;
+  return getMallocSize(ptr);
+}
+
+size_t swift::_swift_stdlib_malloc_size(const void *ptr) {
+#if SWIFT_RUNTIME_BIASED_REFCOUNTING
+  // The allocation starts with the object's biased reference count.
+  if (size_t offset = _swift_getHeapObjectAllocationOffset(ptr))
+    return getAllocationSize(static_cast<const char *>(ptr) - offset) - offset;
+#endif
+  return getAllocationSize(ptr);
+}
+
 static Lazy<std::mt19937> theGlobalMT19937;
 
 static std::mt19937 &getGlobalMT19937() {
@@ -0,0 +1,29 @@
+// main | other
+
+// RUN: rm -rf %t && cp -r %S/Inputs/independent/ %t
+// RUN: touch -t 201401240005 %t/*
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | %FileCheck -check-prefix=CHECK-ALL %s
+
+// CHECK-ALL: Handled main.swift
+// CHECK-ALL: Handled other.swift
+
+// Files written within the last second are not cached, so age the .swiftdeps
+// files before the no-op build that saves them.
+// RUN: touch -t 201401240006 %t/main.swiftdeps %t/other.swiftdeps
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | %FileCheck -check-prefix=CHECK-NONE %s
+// RUN: ls %t/main~buildrecord.swiftdeps.cache
+
+// CHECK-NONE-NOT: Handled
+
+// Break other.swiftdeps without changing its size or modification time. The
+// cached copy is used instead, so nothing needs to be rebuilt.
+// RUN: tr '#' '[' < %t/other.swiftdeps > %t/other.swiftdeps.new
+// RUN: touch -r %t/other.swiftdeps %t/other.swiftdeps.new
+// RUN: mv %t/other.swiftdeps.new %t/other.swiftdeps
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | %FileCheck -check-prefix=CHECK-NONE %s
+
+// Once its modification time changes, the file is read again, and the
+// malformed dependencies force a full rebuild.
+// RUN: touch -t 201401240007 %t/other.swiftdeps
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | %FileCheck -check-prefix=CHECK-ALL %s
@@ -0,0 +1,30 @@
+// RUN: rm -rf %t && cp -r %S/Inputs/bindings-build-record/ %t
+// RUN: %S/Inputs/touch.py 443865900 %t/*
+
+// With durations from the last build, the slowest files are compiled first.
+// RUN: echo '{version: "'$(%swiftc_driver_plain -version | head -n1)'", inputs: {"./main.swift": !dirty [443865900, 0], "./other.swift": !dirty [443865900, 0], "./yet-another.swift": !dirty [443865900, 0]}, job_durations: {"./main.swift": [1, 0], "./other.swift": [3, 0], "./yet-another.swift": [2, 500000000]}, build_time: [443865901, 0]}' > %t/main~buildrecord.swiftdeps
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift ./yet-another.swift -module-name main -j1 -driver-show-critical-path 2>&1 | %FileCheck -check-prefix=CHECK-SLOWEST-FIRST %s
+
+// CHECK-SLOWEST-FIRST-NOT: warning
+// CHECK-SLOWEST-FIRST: Handled other.swift
+// CHECK-SLOWEST-FIRST: Handled yet-another.swift
+// CHECK-SLOWEST-FIRST: Handled main.swift
+// CHECK-SLOWEST-FIRST: Critical path: {{[0-9]+\.[0-9]{3}}}s
+// CHECK-SLOWEST-FIRST-NEXT: {{^}}  compile main.swift: {{[0-9]+\.[0-9]{3}}}s
+
+// The new record has this build's durations.
+// RUN: %FileCheck -check-prefix=CHECK-RECORD %s < %t/main~buildrecord.swiftdeps
+
+// CHECK-RECORD: job_durations:
+// CHECK-RECORD-NEXT: "./main.swift": [{{[0-9]+}}, {{[0-9]+}}]
+// CHECK-RECORD-NEXT: "./other.swift": [{{[0-9]+}}, {{[0-9]+}}]
+// CHECK-RECORD-NEXT: "./yet-another.swift": [{{[0-9]+}}, {{[0-9]+}}]
+
+// Without them, the files are compiled in order.
+// RUN: echo '{version: "'$(%swiftc_driver_plain -version | head -n1)'", inputs: {"./main.swift": !dirty [443865900, 0], "./other.swift": !dirty [443865900, 0], "./yet-another.swift": !dirty [443865900, 0]}, build_time: [443865901, 0]}' > %t/main~buildrecord.swiftdeps
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift ./yet-another.swift -module-name main -j1 2>&1 | %FileCheck -check-prefix=CHECK-IN-ORDER %s
+
+// CHECK-IN-ORDER-NOT: warning
+// CHECK-IN-ORDER: Handled main.swift
+// CHECK-IN-ORDER: Handled other.swift
+// CHECK-IN-ORDER: Handled yet-another.swift
@@ -0,0 +1,57 @@
+#!/usr/bin/env python
+# fake-batch-frontend.py - Fake build to test driver-formed batches.
+#
+# This source file is part of the Swift.org open source project
+#
+# Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+# Licensed under Apache License v2.0 with Runtime Library Exception
+#
+# See http://swift.org/LICENSE.txt for license information
+# See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+#
+# ----------------------------------------------------------------------------
+#
+# Prints the primary files of each frontend invocation on one line, and
+# checks that there is exactly one output, and one of each supplementary
+# output that was asked for, for each of them.
+#
+# ----------------------------------------------------------------------------
+
+from __future__ import print_function
+
+import os
+import sys
+
+assert sys.argv[1] == '-frontend'
+
+primaryFiles = [sys.argv[i + 1] for i, arg in enumerate(sys.argv)
+                if arg == '-primary-file']
+assert primaryFiles
+
+if '-output-filelist' in sys.argv:
+    outputListFile = sys.argv[sys.argv.index('-output-filelist') + 1]
+    with open(outputListFile, 'r') as f:
+        outputs = [line.rstrip('\n') for line in f.readlines()]
+else:
+    outputs = [sys.argv[i + 1] for i, arg in enumerate(sys.argv)
+               if arg == '-o']
+
+
+
+def check_outputs(outputs):
+    assert len(outputs) == len(primaryFiles)
+    for primaryFile, output in zip(primaryFiles, outputs):
+        assert (os.path.splitext(os.path.basename(primaryFile))[0] ==
+                os.path.splitext(os.path.basename(output))[0].split('-')[0])
+        with open(output, 'w'):
+            pass
+
+check_outputs(outputs)
+for option in ['-emit-module-path', '-emit-module-doc-path',
+               '-serialize-diagnostics-path', '-emit-dependencies-path',
+               '-emit-reference-dependencies-path']:
+    if option in sys.argv:
+        check_outputs([sys.argv[i + 1] for i, arg in enumerate(sys.argv)
+                       if arg == option])
+
+print("Handled", " ".join(os.path.basename(f) for f in primaryFiles))
@@ -0,0 +1,38 @@
+#!/usr/bin/env python
+# fake-frontend.py - Fake build to test how many frontends run at once.
+#
+# This source file is part of the Swift.org open source project
+#
+# Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+# Licensed under Apache License v2.0 with Runtime Library Exception
+#
+# See http://swift.org/LICENSE.txt for license information
+# See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+#
+# ----------------------------------------------------------------------------
+#
+# Leaves a marker file in the current directory while it runs, and reports
+# whether the marker of any other invocation was there at the same time.
+#
+# ----------------------------------------------------------------------------
+
+from __future__ import print_function
+
+import glob
+import os
+import sys
+import time
+
+assert sys.argv[1] == '-frontend'
+
+primaryFile = sys.argv[sys.argv.index('-primary-file') + 1]
+
+marker = 'running.{}'.format(os.getpid())
+with open(marker, 'w'):
+    pass
+time.sleep(0.2)
+others = [path for path in glob.glob('running.*') if path != marker]
+os.remove(marker)
+
+print("Handled", os.path.basename(primaryFile),
+      "concurrently" if others else "alone")
@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+# run-with-jobserver.py - Run a command under a fake make jobserver.
+#
+# This source file is part of the Swift.org open source project
+#
+# Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+# Licensed under Apache License v2.0 with Runtime Library Exception
+#
+# See http://swift.org/LICENSE.txt for license information
+# See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+#
+# ----------------------------------------------------------------------------
+#
+# Usage: run-with-jobserver.py [--fifo] <tokens> <command> [<args>...]
+#
+# Creates a jobserver pipe holding <tokens> tokens and passes it to the
+# command through MAKEFLAGS, the way GNU make does. With --fifo, the pipe is
+# a named pipe passed by path, as make 4.4 does; otherwise it is inherited.
+# Once the command has finished, prints how many tokens are left in the pipe.
+#
+# ----------------------------------------------------------------------------
+
+from __future__ import print_function
+
+import errno
+import fcntl
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+args = sys.argv[1:]
+useFifo = args[0] == '--fifo'
+if useFifo:
+    args = args[1:]
+assert len(args) >= 2
+tokens = int(args[0])
+
+env = dict(os.environ)
+if useFifo:
+    tempDir = tempfile.mkdtemp()
+    fifoPath = os.path.join(tempDir, 'jobserver')
+    os.mkfifo(fifoPath)
+    readFD = writeFD = os.open(fifoPath, os.O_RDWR)
+    env['MAKEFLAGS'] = ' -j --jobserver-auth=fifo:{}'.format(fifoPath)
+else:
+    readFD, writeFD = os.pipe()
+    for fd in (readFD, writeFD):
+        if hasattr(os, 'set_inheritable'):
+            os.set_inheritable(fd, True)
+    env['MAKEFLAGS'] = ' -j --jobserver-auth={},{}'.format(readFD, writeFD)
+os.write(writeFD, b'+' * tokens)
+
+status = subprocess.call(args[1:], env=env, close_fds=False)
+if useFifo:
+    shutil.rmtree(tempDir)
+
+flags = fcntl.fcntl(readFD, fcntl.F_GETFL)
+fcntl.fcntl(readFD, fcntl.F_SETFL, flags | os.O_NONBLOCK)
+try:
+    remaining = len(os.read(readFD, 1024))
+except OSError as e:
+    if e.errno != errno.EAGAIN:
+        raise
+    remaining = 0
+
+sys.stdout.flush()
+print("jobserver tokens:", remaining)
+sys.exit(status)
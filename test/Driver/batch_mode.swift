@@ -0,0 +1,37 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: touch %t/a.swift %t/b.swift %t/c.swift %t/d.swift
+
+// RUN: (cd %t && %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/batch/fake-batch-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -enable-batch-mode -j2 2>&1 | %FileCheck -check-prefix=CHECK-J2 %s)
+
+// CHECK-J2-NOT: Handled
+// CHECK-J2-DAG: Handled a.swift b.swift{{$}}
+// CHECK-J2-DAG: Handled c.swift d.swift{{$}}
+// CHECK-J2-NOT: Handled
+
+// RUN: (cd %t && %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/batch/fake-batch-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -enable-batch-mode -j1 2>&1 | %FileCheck -check-prefix=CHECK-J1 %s)
+// RUN: (cd %t && %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/batch/fake-batch-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -enable-batch-mode -j1 -driver-use-filelists 2>&1 | %FileCheck -check-prefix=CHECK-J1 %s)
+
+// CHECK-J1-NOT: Handled
+// CHECK-J1: Handled a.swift b.swift c.swift d.swift{{$}}
+// CHECK-J1-NOT: Handled
+
+// Supplementary outputs are passed once per primary file, in the same order.
+// RUN: (cd %t && %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/batch/fake-batch-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -enable-batch-mode -j2 -emit-dependencies -serialize-diagnostics 2>&1 | %FileCheck -check-prefix=CHECK-J2 %s)
+
+// A larger -j than there are files leaves every file in its own invocation.
+// RUN: (cd %t && %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/batch/fake-batch-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -enable-batch-mode -j8 2>&1 | %FileCheck -check-prefix=CHECK-J8 %s)
+
+// CHECK-J8-NOT: Handled
+// CHECK-J8-DAG: Handled a.swift{{$}}
+// CHECK-J8-DAG: Handled b.swift{{$}}
+// CHECK-J8-DAG: Handled c.swift{{$}}
+// CHECK-J8-DAG: Handled d.swift{{$}}
+// CHECK-J8-NOT: Handled
+
+// Without -enable-batch-mode, nothing changes.
+// RUN: (cd %t && %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/batch/fake-batch-frontend.py -c ./a.swift ./b.swift -module-name main -target x86_64-apple-macosx10.9 -j1 2>&1 | %FileCheck -check-prefix=CHECK-NO-BATCH %s)
+
+// CHECK-NO-BATCH-NOT: Handled
+// CHECK-NO-BATCH: Handled a.swift{{$}}
+// CHECK-NO-BATCH-NEXT: Handled b.swift{{$}}
+// CHECK-NO-BATCH-NOT: Handled
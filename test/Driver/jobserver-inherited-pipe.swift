@@ -0,0 +1,24 @@
+// An inherited jobserver pipe is only used where it can be reopened for
+// reading without blocking.
+// REQUIRES: OS=linux-gnu
+
+// RUN: rm -rf %t && mkdir %t
+// RUN: touch %t/a.swift %t/b.swift %t/c.swift %t/d.swift
+
+// RUN: (cd %t && %{python} %S/Inputs/jobserver/run-with-jobserver.py 0 %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/fake-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -j4 2>&1 | %FileCheck -check-prefix=CHECK-NO-TOKENS %s)
+
+// CHECK-NO-TOKENS-NOT: concurrently
+// CHECK-NO-TOKENS-DAG: Handled a.swift alone
+// CHECK-NO-TOKENS-DAG: Handled b.swift alone
+// CHECK-NO-TOKENS-DAG: Handled c.swift alone
+// CHECK-NO-TOKENS-DAG: Handled d.swift alone
+// CHECK-NO-TOKENS-NOT: concurrently
+// CHECK-NO-TOKENS: jobserver tokens: 0
+
+// RUN: (cd %t && %{python} %S/Inputs/jobserver/run-with-jobserver.py 2 %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/fake-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -j4 2>&1 | %FileCheck -check-prefix=CHECK-TOKENS %s)
+
+// CHECK-TOKENS-DAG: Handled a.swift
+// CHECK-TOKENS-DAG: Handled b.swift
+// CHECK-TOKENS-DAG: Handled c.swift
+// CHECK-TOKENS-DAG: Handled d.swift
+// CHECK-TOKENS: jobserver tokens: 2
@@ -0,0 +1,35 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: touch %t/a.swift %t/b.swift %t/c.swift %t/d.swift
+
+// With no tokens to spare, only one frontend may run at a time, whatever -j
+// allows.
+// RUN: (cd %t && %{python} %S/Inputs/jobserver/run-with-jobserver.py --fifo 0 %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/fake-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -j4 2>&1 | %FileCheck -check-prefix=CHECK-NO-TOKENS %s)
+
+// CHECK-NO-TOKENS-NOT: concurrently
+// CHECK-NO-TOKENS-DAG: Handled a.swift alone
+// CHECK-NO-TOKENS-DAG: Handled b.swift alone
+// CHECK-NO-TOKENS-DAG: Handled c.swift alone
+// CHECK-NO-TOKENS-DAG: Handled d.swift alone
+// CHECK-NO-TOKENS-NOT: concurrently
+// CHECK-NO-TOKENS: jobserver tokens: 0
+
+// Every token taken is given back.
+// RUN: (cd %t && %{python} %S/Inputs/jobserver/run-with-jobserver.py --fifo 2 %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/fake-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -j4 2>&1 | %FileCheck -check-prefix=CHECK-TOKENS %s)
+
+// CHECK-TOKENS-DAG: Handled a.swift
+// CHECK-TOKENS-DAG: Handled b.swift
+// CHECK-TOKENS-DAG: Handled c.swift
+// CHECK-TOKENS-DAG: Handled d.swift
+// CHECK-TOKENS: jobserver tokens: 2
+
+// A jobserver whose pipe wasn't passed down is ignored.
+// RUN: (cd %t && env MAKEFLAGS=--jobserver-auth=98,99 %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/fake-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -j4 2>&1 | %FileCheck -check-prefix=CHECK-ALL %s)
+// RUN: (cd %t && %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/fake-frontend.py -c ./a.swift ./b.swift ./c.swift ./d.swift -module-name main -target x86_64-apple-macosx10.9 -j4 -load-average 1000 2>&1 | %FileCheck -check-prefix=CHECK-ALL %s)
+
+// CHECK-ALL-DAG: Handled a.swift
+// CHECK-ALL-DAG: Handled b.swift
+// CHECK-ALL-DAG: Handled c.swift
+// CHECK-ALL-DAG: Handled d.swift
+
+// RUN: not %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/fake-frontend.py -c %t/a.swift -module-name main -load-average abc 2>&1 | %FileCheck -check-prefix=CHECK-BAD-LOAD %s
+// CHECK-BAD-LOAD: error: invalid value 'abc' in '-load-average abc'
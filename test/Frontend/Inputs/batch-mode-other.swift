@@ -0,0 +1,7 @@
+public struct OtherStruct {
+  public var value: Int
+}
+
+public func otherFunction() -> OtherStruct {
+  return OtherStruct(value: 1)
+}
@@ -0,0 +1,40 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-swift-frontend -emit-ir -primary-file %s -primary-file %S/Inputs/batch-mode-other.swift -o %t/batch-mode.ll -o %t/batch-mode-other.ll -emit-reference-dependencies-path %t/batch-mode.swiftdeps -emit-reference-dependencies-path %t/batch-mode-other.swiftdeps -module-name main
+// RUN: %FileCheck -check-prefix=IR-MAIN %s < %t/batch-mode.ll
+// RUN: %FileCheck -check-prefix=IR-OTHER %s < %t/batch-mode-other.ll
+// RUN: %FileCheck -check-prefix=DEPS-MAIN %s < %t/batch-mode.swiftdeps
+// RUN: %FileCheck -check-prefix=DEPS-OTHER %s < %t/batch-mode-other.swiftdeps
+
+// The primary files are matched to outputs in input order, whatever the
+// order of the -primary-file options.
+// RUN: echo '%S/Inputs/batch-mode-other.swift' > %t/input.txt
+// RUN: echo '%s' >> %t/input.txt
+// RUN: %target-swift-frontend -emit-ir -filelist %t/input.txt -primary-file %s -primary-file %S/Inputs/batch-mode-other.swift -o %t/filelist-other.ll -o %t/filelist-main.ll -module-name main
+// RUN: %FileCheck -check-prefix=IR-MAIN %s < %t/filelist-main.ll
+// RUN: %FileCheck -check-prefix=IR-OTHER %s < %t/filelist-other.ll
+
+// RUN: not %target-swift-frontend -emit-ir -primary-file %s -primary-file %S/Inputs/batch-mode-other.swift -o %t/batch-mode.ll -module-name main 2>&1 | %FileCheck -check-prefix=CHECK-COUNT %s
+// CHECK-COUNT: error: '-o' must be given once for each -primary-file (2 expected, 1 given)
+
+// RUN: not %target-swift-frontend -emit-ir -primary-file %s -primary-file %S/Inputs/batch-mode-other.swift -o %t/batch-mode.ll -o %t/batch-mode-other.ll -emit-dependencies-path %t/batch-mode.d -module-name main 2>&1 | %FileCheck -check-prefix=CHECK-DEPS-COUNT %s
+// CHECK-DEPS-COUNT: error: '-emit-dependencies-path' must be given once for each -primary-file (2 expected, 1 given)
+
+// RUN: not %target-swift-frontend -parse -primary-file %s -primary-file %S/Inputs/batch-mode-other.swift -module-name main 2>&1 | %FileCheck -check-prefix=CHECK-MODE %s
+// CHECK-MODE: error: this mode does not support more than one -primary-file
+
+// IR-MAIN: define{{.*}} @_TF4main8mainUserFT_Si
+// IR-MAIN-NOT: define{{.*}} @_TF4main13otherFunctionFT_VS_11OtherStruct
+// IR-OTHER: define{{.*}} @_TF4main13otherFunctionFT_VS_11OtherStruct
+// IR-OTHER-NOT: define{{.*}} @_TF4main8mainUserFT_Si
+
+// DEPS-MAIN: provides-top-level:
+// DEPS-MAIN: - "mainUser"
+// DEPS-MAIN: depends-top-level:
+// DEPS-MAIN: - "otherFunction"
+// DEPS-OTHER: provides-top-level:
+// DEPS-OTHER: - "otherFunction"
+// DEPS-OTHER-NOT: "mainUser"
+
+public func mainUser() -> Int {
+  return otherFunction().value
+}
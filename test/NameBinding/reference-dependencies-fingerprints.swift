@@ -0,0 +1,63 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: cp %s %t/main.swift
+// RUN: %target-swift-frontend -parse -primary-file %t/main.swift -emit-reference-dependencies-path - > %t/before.swiftdeps
+// RUN: %FileCheck %s < %t/before.swiftdeps
+
+// Change the body of 'stable', the signatures of 'edited' and 'extra', and
+// the type behind 'Alias'.
+// RUN: sed -e 's/return 1/return 2/' -e 's/edited() -> Int/edited() -> Bool/' -e 's/func extra()/func extra(_ x: Int)/' -e 's/Alias = Int/Alias = Bool/' %s > %t/main.swift
+// RUN: %target-swift-frontend -parse -primary-file %t/main.swift -emit-reference-dependencies-path - > %t/after.swiftdeps
+
+// RUN: grep '"stable"' %t/before.swiftdeps > %t/stable-before
+// RUN: grep '"stable"' %t/after.swiftdeps > %t/stable-after
+// RUN: diff %t/stable-before %t/stable-after
+// RUN: grep '"other"' %t/before.swiftdeps > %t/other-before
+// RUN: grep '"other"' %t/after.swiftdeps > %t/other-after
+// RUN: diff %t/other-before %t/other-after
+
+// RUN: grep '"edited"' %t/before.swiftdeps > %t/edited-before
+// RUN: grep '"edited"' %t/after.swiftdeps > %t/edited-after
+// RUN: not diff %t/edited-before %t/edited-after
+// RUN: grep '"extra"' %t/before.swiftdeps > %t/extra-before
+// RUN: grep '"extra"' %t/after.swiftdeps > %t/extra-after
+// RUN: not diff %t/extra-before %t/extra-after
+
+// 'usesAlias' itself is unchanged, but the typealias it refers to is not.
+// RUN: grep '"usesAlias"' %t/before.swiftdeps > %t/uses-before
+// RUN: grep '"usesAlias"' %t/after.swiftdeps > %t/uses-after
+// RUN: not diff %t/uses-before %t/uses-after
+
+// CHECK-LABEL: {{^fingerprint-top-level:$}}
+// CHECK-DAG: - ["Alias", "{{[0-9a-f]+}}"]
+// CHECK-DAG: - ["stable", "{{[0-9a-f]+}}"]
+// CHECK-DAG: - ["edited", "{{[0-9a-f]+}}"]
+// CHECK-DAG: - ["usesAlias", "{{[0-9a-f]+}}"]
+// CHECK-DAG: - ["Outer", "{{[0-9a-f]+}}"]
+
+// CHECK-LABEL: {{^fingerprint-nominal:$}}
+// CHECK: - ["V4main5Outer", "{{[0-9a-f]+}}"]
+
+// CHECK-LABEL: {{^fingerprint-member:$}}
+// CHECK-DAG: - ["V4main5Outer", "", "{{[0-9a-f]+}}"]
+// CHECK-DAG: - ["V4main5Outer", "extra", "{{[0-9a-f]+}}"]
+// CHECK-DAG: - ["V4main5Outer", "other", "{{[0-9a-f]+}}"]
+
+// CHECK-LABEL: {{^depends-external:$}}
+
+typealias Alias = Int
+
+func stable() -> Int { return 1 }
+func edited() -> Int { return 0 }
+func usesAlias(_ x: Alias) {}
+
+struct Outer {
+  func method() {}
+}
+
+extension Outer {
+  func extra() {}
+}
+
+extension Outer {
+  func other() {}
+}
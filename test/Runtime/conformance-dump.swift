@@ -0,0 +1,14 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %target-build-swift %s -parse-as-library -emit-library -module-name Conformances -o %t/libConformances.%target-dylib-extension
+// RUN: %target-swift-conformance-dump -protocols %t/libConformances.%target-dylib-extension | %FileCheck %s
+
+// CHECK: libConformances.{{.*}}: 3 records, 2 protocols
+// CHECK-NEXT: {{  0x[0-9a-f]+}}: 2
+// CHECK-NEXT: {{  0x[0-9a-f]+}}: 1
+// CHECK-NEXT: total: 3 records in 1 images
+
+public protocol P {}
+public protocol Q {}
+
+public struct S1 : P, Q {}
+public struct S2 : P {}
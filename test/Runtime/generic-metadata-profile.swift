@@ -0,0 +1,45 @@
+// RUN: rm -rf %t
+// RUN: mkdir -p %t
+// RUN: %target-build-swift %s -o %t/a.out
+// RUN: env SWIFT_DEBUG_GENERIC_METADATA_PROFILE_OUTPUT=%t/profile %target-run %t/a.out | %FileCheck %s --check-prefix=OUTPUT
+// RUN: %FileCheck %s --check-prefix=PROFILE < %t/profile
+// RUN: env SWIFT_GENERIC_METADATA_PROFILE=%t/profile %target-run %t/a.out | %FileCheck %s --check-prefix=OUTPUT
+
+// The environment is not passed through to the program on these targets.
+// UNSUPPORTED: OS=watchos
+// UNSUPPORTED: OS=ios
+// UNSUPPORTED: OS=tvos
+
+// REQUIRES: executable_test
+
+struct Pair<T, U> {
+  var first: T
+  var second: U
+}
+
+struct Keyed<K: Hashable> {
+  var key: K
+}
+
+class Node<T> {
+  var value: T
+  init(_ value: T) { self.value = value }
+}
+
+@inline(never)
+func describe<T>(_ value: T) -> String {
+  return "\(T.self)"
+}
+
+// OUTPUT: Pair<Int, Node<String>>
+print(describe(Pair(first: 1, second: Node("x"))))
+// OUTPUT: Keyed<Int>
+print(describe(Keyed(key: 1)))
+// OUTPUT: Array<(Int, {{.*}}Double)>
+print(describe([(1, label: 2.0)]))
+
+// PROFILE: swift-generic-metadata-profile 1
+// PROFILE-DAG: {{^}}G{{[0-9]+}}:{{[^<]*}}Node<N{{[0-9]+}}:SS>{{$}}
+// PROFILE-DAG: {{^}}G{{[0-9]+}}:{{[^<]*}}Pair<N{{[0-9]+}}:SiG{{[0-9]+}}:{{[^<]*}}Node<N{{[0-9]+}}:SS>>{{$}}
+// PROFILE-DAG: {{^}}G{{[0-9]+}}:{{[^<]*}}Keyed<N{{[0-9]+}}:Si>W0{{[0-9]+}}:_TtPs8Hashable_{{$}}
+// PROFILE-DAG: {{^}}G{{[0-9]+}}:SaTL{{[0-9]+}}:{{[^<]*}}<N{{[0-9]+}}:SiN{{[0-9]+}}:Sd>>{{$}}
@@ -0,0 +1,34 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %llvm-profdata merge %S/Inputs/profile_use.proftext -o %t/profile_use.profdata
+// RUN: %target-swift-frontend -parse-as-library -module-name profile_use -emit-silgen -profile-use=%t/profile_use.profdata %s > %t/profile_use.sil
+// RUN: %FileCheck %s < %t/profile_use.sil
+// RUN: %FileCheck -check-prefix=NO-INCREMENT %s < %t/profile_use.sil
+// RUN: %target-swift-frontend -parse-as-library -module-name profile_use -emit-ir -profile-use=%t/profile_use.profdata %s | %FileCheck -check-prefix=IR %s
+// RUN: not %target-swift-frontend -parse-as-library -emit-silgen -profile-use=%t/missing.profdata %s 2>&1 | %FileCheck -check-prefix=MISSING %s
+
+// MISSING: error: cannot read profile data '{{.*}}missing.profdata'
+
+// Counters are only read, not incremented.
+// NO-INCREMENT-NOT: int_instrprof_increment
+
+// CHECK-LABEL: sil @_TF11profile_use8classifyFSiSi
+// CHECK: bb0(%0 : $Int):{{ *}}// count: 100
+// CHECK: cond_br {{.*}}, [[THEN:bb[0-9]+]], [[ELSE:bb[0-9]+]]
+// CHECK: [[THEN]]:{{.*}}// count: 90
+// CHECK-NOT: // count:
+
+// IR-LABEL: define {{.*}} @_TF11profile_use8classifyFSiSi
+// IR: br i1 {{.*}}, !prof ![[WEIGHTS:[0-9]+]]
+// IR: ![[WEIGHTS]] = !{!"branch_weights", i32 90, i32 10}
+public func classify(_ x: Int) -> Int {
+  if x > 0 {
+    return 1
+  }
+  return 0
+}
+
+// CHECK-LABEL: sil @_TF11profile_use11neverCalledFT_Si
+// CHECK: bb0:{{ *}}// count: 0
+public func neverCalled() -> Int {
+  return 2
+}
@@ -0,0 +1,53 @@
+#!/usr/bin/env python
+# check-profile-times.py - Check the times in a SIL optimizer profile.
+#
+# This source file is part of the Swift.org open source project
+#
+# Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+# Licensed under Apache License v2.0 with Runtime Library Exception
+#
+# See http://swift.org/LICENSE.txt for license information
+# See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+#
+# ----------------------------------------------------------------------------
+#
+# Usage: check-profile-times.py <profile> <command> [<args>...]
+#
+# Runs the command, which is expected to write a -sil-opt-profile to
+# <profile>, and checks that the pass times recorded in the profile add up
+# to no more than the wall time the command took.
+#
+# ----------------------------------------------------------------------------
+
+from __future__ import print_function
+
+import json
+import subprocess
+import sys
+import time
+
+assert len(sys.argv) >= 3
+
+start = time.time()
+status = subprocess.call(sys.argv[2:])
+wall_ns = (time.time() - start) * 1e9
+if status != 0:
+    sys.exit(status)
+
+with open(sys.argv[1]) as f:
+    entries = json.load(f)
+
+total_ns = 0
+for entry in entries:
+    if entry['time_ns'] < 0 or entry['time_ns'] > wall_ns:
+        print('error: %s took %d ns, but the compiler ran for %d ns' %
+              (entry['pass'], entry['time_ns'], wall_ns))
+        sys.exit(1)
+    total_ns += entry['time_ns']
+
+if total_ns > wall_ns:
+    print('error: passes took %d ns, but the compiler ran for %d ns' %
+          (total_ns, wall_ns))
+    sys.exit(1)
+
+print('pass times are consistent')
@@ -0,0 +1,23 @@
+public struct A {
+  public struct Index {
+    public init() {}
+  }
+}
+
+public struct B {
+  public struct Index {
+    public init() {}
+  }
+}
+
+extension A.Index {
+  public func fromA() {}
+}
+
+extension B.Index {
+  public func fromB() {}
+}
+
+extension Array {
+  public func fromArray() {}
+}
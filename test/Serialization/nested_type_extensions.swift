@@ -0,0 +1,13 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/nested_type_extensions.swift
+// RUN: %target-swift-frontend -parse -verify -I %t %s
+
+// Extensions are found by the type they extend, not just by its name.
+
+import nested_type_extensions
+
+A.Index().fromA()
+B.Index().fromB()
+A.Index().fromB() // expected-error {{value of type 'A.Index' has no member 'fromB'}}
+B.Index().fromA() // expected-error {{value of type 'B.Index' has no member 'fromA'}}
+[1, 2, 3].fromArray()
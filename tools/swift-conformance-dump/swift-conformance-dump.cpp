@@ -0,0 +1,182 @@
+//===--- swift-conformance-dump.cpp - Dump protocol conformance sections --===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+// This is a host-side tool that reports how many protocol conformance
+// records each linked swift image carries, and for how many protocols.
+// These are the records the runtime sorts the first time a conformance
+// lookup misses its cache.
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Object/MachO.h"
+#include "llvm/Object/MachOUniversal.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <vector>
+
+using llvm::dyn_cast;
+using llvm::StringRef;
+using namespace llvm::object;
+
+namespace options {
+static llvm::cl::list<std::string>
+BinaryFilename(llvm::cl::Positional, llvm::cl::desc("<binary files>"),
+               llvm::cl::OneOrMore);
+
+static llvm::cl::opt<std::string>
+Architecture("arch", llvm::cl::desc("Architecture to inspect in universal "
+                                    "binaries"));
+
+static llvm::cl::opt<bool>
+Protocols("protocols",
+          llvm::cl::desc("Also print the number of records for each "
+                         "protocol, largest first"));
+} // end namespace options
+
+/// The size of a ProtocolConformanceRecord: relative pointers to the
+/// protocol, the type and the witness table or accessor, and flags.
+static const uint64_t RecordSize = 16;
+
+namespace {
+struct ImageConformances {
+  std::string Filename;
+  uint64_t NumRecords = 0;
+  /// The number of records for each protocol, keyed by the address of the
+  /// protocol descriptor or of the GOT entry referring to it.
+  llvm::DenseMap<uint64_t, uint64_t> RecordsPerProtocol;
+};
+} // end anonymous namespace
+
+template<typename T>
+static T unwrap(llvm::ErrorOr<T> value) {
+  if (!value.getError())
+    return std::move(value.get());
+  llvm::errs() << "swift-conformance-dump error: "
+               << value.getError().message() << "\n";
+  exit(EXIT_FAILURE);
+}
+
+static SectionRef getConformanceSection(const ObjectFile *objectFile) {
+  for (auto section : objectFile->sections()) {
+    StringRef sectionName;
+    section.getName(sectionName);
+    if (sectionName == "__swift2_proto" ||
+        sectionName == ".swift2_protocol_conformances")
+      return section;
+  }
+  return SectionRef();
+}
+
+static void readConformances(const ObjectFile *objectFile,
+                             ImageConformances &image) {
+  auto section = getConformanceSection(objectFile);
+  if (section.getObject() == nullptr)
+    return;
+
+  StringRef contents;
+  section.getContents(contents);
+  uint64_t address = section.getAddress();
+  bool isLittleEndian = objectFile->isLittleEndian();
+
+  // In ELF images the section starts with its size, filled in by
+  // swift_begin.o.
+  if (objectFile->isELF() && contents.size() >= 8) {
+    uint64_t size = isLittleEndian
+      ? llvm::support::endian::read64le(contents.data())
+      : llvm::support::endian::read64be(contents.data());
+    if (size == contents.size() - 8) {
+      contents = contents.drop_front(8);
+      address += 8;
+    }
+  }
+
+  for (uint64_t offset = 0; offset + RecordSize <= contents.size();
+       offset += RecordSize) {
+    const char *field = contents.data() + offset;
+    int32_t protocolOffset = int32_t(isLittleEndian
+      ? llvm::support::endian::read32le(field)
+      : llvm::support::endian::read32be(field));
+
+    // The low bit marks an indirect reference through a GOT entry, which
+    // identifies the protocol just as well.
+    uint64_t protocol = address + offset + (protocolOffset & ~int32_t(1));
+    ++image.NumRecords;
+    ++image.RecordsPerProtocol[protocol];
+  }
+}
+
+static void printImage(const ImageConformances &image,
+                       llvm::raw_ostream &OS) {
+  OS << image.Filename << ": " << image.NumRecords << " records, "
+     << image.RecordsPerProtocol.size() << " protocols\n";
+  if (!options::Protocols)
+    return;
+
+  std::vector<std::pair<uint64_t, uint64_t>> protocols(
+    image.RecordsPerProtocol.begin(), image.RecordsPerProtocol.end());
+  std::sort(protocols.begin(), protocols.end(),
+            [](const std::pair<uint64_t, uint64_t> &lhs,
+               const std::pair<uint64_t, uint64_t> &rhs) {
+              if (lhs.second != rhs.second)
+                return lhs.second > rhs.second;
+              return lhs.first < rhs.first;
+            });
+  for (auto &protocol : protocols)
+    OS << "  " << llvm::format_hex(protocol.first, 18) << ": "
+       << protocol.second << "\n";
+}
+
+int main(int argc, char *argv[]) {
+  llvm::cl::ParseCommandLineOptions(argc, argv, "Swift Conformance Dump\n");
+
+  uint64_t totalRecords = 0;
+  for (auto &binaryFilename : options::BinaryFilename) {
+    auto binaryOwner = unwrap(createBinary(binaryFilename));
+    Binary *binaryFile = binaryOwner.getBinary();
+
+    // The object file we read -- either the binary itself, or a particular
+    // slice of a universal binary.
+    std::unique_ptr<ObjectFile> objectOwner;
+    const ObjectFile *objectFile;
+
+    if (auto o = dyn_cast<ObjectFile>(binaryFile)) {
+      objectFile = o;
+    } else if (auto universal = dyn_cast<MachOUniversalBinary>(binaryFile)) {
+      if (options::Architecture.empty()) {
+        llvm::errs() << "swift-conformance-dump error: " << binaryFilename
+                     << " is a universal binary; pass -arch\n";
+        return EXIT_FAILURE;
+      }
+      objectOwner =
+        unwrap(universal->getObjectForArch(options::Architecture));
+      objectFile = objectOwner.get();
+    } else {
+      llvm::errs() << "swift-conformance-dump error: " << binaryFilename
+                   << " is not an object file\n";
+      return EXIT_FAILURE;
+    }
+
+    ImageConformances image;
+    image.Filename = binaryFilename;
+    readConformances(objectFile, image);
+    printImage(image, llvm::outs());
+    totalRecords += image.NumRecords;
+  }
+
+  llvm::outs() << "total: " << totalRecords << " records in "
+               << options::BinaryFilename.size() << " images\n";
+  return EXIT_SUCCESS;
+}
@@ -1,4 +1,6 @@
 #include "swift/Driver/DependencyGraph.h"
+#include "swift/Basic/BinaryDependencyFile.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace swift;
@@ -790,3 +792,242 @@ TEST(DependencyGraph, ChainedExternalPreMarked) {
   EXPECT_TRUE(graph.isMarked(0));
   EXPECT_FALSE(graph.isMarked(1));
 }
+
+using Kind = BinaryDependencyFile::Kind;
+
+static std::string writeBinary(const BinaryDependencyFileWriter &writer) {
+  std::string result;
+  llvm::raw_string_ostream out(result);
+  writer.write(out);
+  return out.str();
+}
+
+TEST(DependencyGraph, BinaryLoad) {
+  DependencyGraph<uintptr_t> graph;
+
+  BinaryDependencyFileWriter provider;
+  provider.addProvides(Kind::TopLevel, "a");
+  provider.addProvides(Kind::Nominal, "V4main1S");
+  provider.addMember("V4main1S", "foo", /*provides*/true, /*cascading*/true);
+  provider.setInterfaceHash("abc");
+
+  BinaryDependencyFileWriter memberUser;
+  memberUser.addDepends(Kind::External, "/foo", /*cascading*/true);
+  memberUser.addMember("V4main1S", "foo", /*provides*/false,
+                       /*cascading*/true);
+  memberUser.addProvides(Kind::TopLevel, "b");
+
+  BinaryDependencyFileWriter privateUser;
+  privateUser.addDepends(Kind::TopLevel, "b", /*cascading*/false);
+
+  EXPECT_EQ(graph.loadFromString(0, writeBinary(provider)),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, writeBinary(memberUser)),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2, writeBinary(privateUser)),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(3, "depends-top-level: [b]"),
+            LoadResult::UpToDate);
+
+  // Changing the interface hash affects downstream nodes, as in YAML.
+  provider.setInterfaceHash("def");
+  EXPECT_EQ(graph.loadFromString(0, writeBinary(provider)),
+            LoadResult::AffectsDownstream);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(3u, marked.size());
+  EXPECT_TRUE(graph.isMarked(0));
+  EXPECT_TRUE(graph.isMarked(1));
+  EXPECT_FALSE(graph.isMarked(2));
+  EXPECT_TRUE(graph.isMarked(3));
+
+  EXPECT_EQ(1, std::distance(graph.getExternalDependencies().begin(),
+                             graph.getExternalDependencies().end()));
+}
+
+TEST(DependencyGraph, BinaryLoadErrors) {
+  DependencyGraph<uintptr_t> graph;
+
+  BinaryDependencyFileWriter writer;
+  writer.addProvides(Kind::TopLevel, "a");
+  writer.addDepends(Kind::TopLevel, "b", /*cascading*/true);
+  std::string data = writeBinary(writer);
+
+  EXPECT_EQ(graph.loadFromString(0, data), LoadResult::UpToDate);
+
+  // Any truncation leaves the file malformed.
+  for (size_t length = 4; length < data.size(); ++length) {
+    EXPECT_EQ(graph.loadFromString(1, data.substr(0, length)),
+              LoadResult::HadError);
+  }
+
+  // So does an unknown version.
+  std::string badVersion = data;
+  badVersion[4] = 0x7F;
+  EXPECT_EQ(graph.loadFromString(1, badVersion), LoadResult::HadError);
+
+  // So does a string index past the end of the table. The first record
+  // follows the six-word header and the two string entries.
+  std::string badString = data;
+  badString[(6 + 2 * 2) * 4] = 0x7F;
+  EXPECT_EQ(graph.loadFromString(1, badString), LoadResult::HadError);
+}
+
+TEST(DependencyGraph, Fingerprints) {
+  DependencyGraph<uintptr_t> graph;
+
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-top-level: [a, b]\n"
+                                 "fingerprint-top-level: [[a, '1'], [b, '2']]\n"
+                                 "interface-hash: 'x'"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1,
+                                 "depends-top-level: [a]\n"
+                                 "provides-top-level: [c]"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2, "depends-top-level: [b]"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(3, "depends-top-level: [c]"),
+            LoadResult::UpToDate);
+
+  // A new interface hash with the same fingerprints affects nothing.
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-top-level: [a, b]\n"
+                                 "fingerprint-top-level: [[a, '1'], [b, '2']]\n"
+                                 "interface-hash: 'y'"),
+            LoadResult::UpToDate);
+
+  // Only the users of 'b' are affected when its fingerprint changes.
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-top-level: [a, b]\n"
+                                 "fingerprint-top-level: [[a, '1'], [b, '3']]\n"
+                                 "interface-hash: 'z'"),
+            LoadResult::AffectsDownstream);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_EQ(2u, marked.front());
+  EXPECT_TRUE(graph.isMarked(0));
+  EXPECT_FALSE(graph.isMarked(1));
+  EXPECT_TRUE(graph.isMarked(2));
+  EXPECT_FALSE(graph.isMarked(3));
+
+  // Removing 'a' affects its users.
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-top-level: [b]\n"
+                                 "fingerprint-top-level: [[b, '3']]\n"
+                                 "interface-hash: 'w'"),
+            LoadResult::AffectsDownstream);
+
+  marked.clear();
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(2u, marked.size());
+  EXPECT_TRUE(graph.isMarked(1));
+  EXPECT_TRUE(graph.isMarked(3));
+}
+
+TEST(DependencyGraph, FingerprintsOnlySomeNames) {
+  DependencyGraph<uintptr_t> graph;
+
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-member: [[S, foo], [S, bar]]\n"
+                                 "provides-dynamic-lookup: [foo]\n"
+                                 "fingerprint-member: [[S, foo, '1'], "
+                                                      "[S, bar, '2']]\n"
+                                 "interface-hash: 'x'"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, "depends-member: [[S, bar]]"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2, "depends-dynamic-lookup: [foo]"),
+            LoadResult::UpToDate);
+
+  // Names without fingerprints are affected by any change to the interface.
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-member: [[S, foo], [S, bar]]\n"
+                                 "provides-dynamic-lookup: [foo]\n"
+                                 "fingerprint-member: [[S, foo, '3'], "
+                                                      "[S, bar, '2']]\n"
+                                 "interface-hash: 'y'"),
+            LoadResult::AffectsDownstream);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_FALSE(graph.isMarked(1));
+  EXPECT_TRUE(graph.isMarked(2));
+}
+
+TEST(DependencyGraph, FingerprintsWithMarkedDependency) {
+  DependencyGraph<uintptr_t> graph;
+
+  EXPECT_EQ(graph.loadFromString(0, "provides-top-level: [a]"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1,
+                                 "provides-top-level: [b, c]\n"
+                                 "fingerprint-top-level: [[b, '1'], [c, '2']]\n"
+                                 "interface-hash: 'x'"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2, "depends-top-level: [c]"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(3, "depends-top-level: [a]"),
+            LoadResult::UpToDate);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_TRUE(graph.isMarked(3));
+
+  // Node 1 now depends on something that changed, so everything it provides
+  // is affected, whatever its fingerprints say.
+  EXPECT_EQ(graph.loadFromString(1,
+                                 "depends-top-level: [a]\n"
+                                 "provides-top-level: [b, c]\n"
+                                 "fingerprint-top-level: [[b, '3'], [c, '2']]\n"
+                                 "interface-hash: 'y'"),
+            LoadResult::AffectsDownstream);
+
+  marked.clear();
+  graph.markTransitive(marked, 1);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_TRUE(graph.isMarked(2));
+}
+
+TEST(DependencyGraph, BinaryFingerprints) {
+  DependencyGraph<uintptr_t> graph;
+
+  BinaryDependencyFileWriter provider;
+  provider.addProvides(Kind::Nominal, "V4main1S");
+  provider.addMember("V4main1S", "foo", /*provides*/true, /*cascading*/true);
+  provider.addMember("V4main1S", "bar", /*provides*/true, /*cascading*/true);
+  provider.addFingerprint(Kind::Nominal, "V4main1S", "1");
+  provider.addMemberFingerprint("V4main1S", "foo", "2");
+  provider.addMemberFingerprint("V4main1S", "bar", "3");
+  provider.setInterfaceHash("abc");
+
+  EXPECT_EQ(graph.loadFromString(0, writeBinary(provider)),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, "depends-member: [[V4main1S, foo]]"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2, "depends-member: [[V4main1S, bar]]"),
+            LoadResult::UpToDate);
+
+  BinaryDependencyFileWriter changed;
+  changed.addProvides(Kind::Nominal, "V4main1S");
+  changed.addMember("V4main1S", "foo", /*provides*/true, /*cascading*/true);
+  changed.addMember("V4main1S", "bar", /*provides*/true, /*cascading*/true);
+  changed.addFingerprint(Kind::Nominal, "V4main1S", "1");
+  changed.addMemberFingerprint("V4main1S", "foo", "4");
+  changed.addMemberFingerprint("V4main1S", "bar", "3");
+  changed.setInterfaceHash("def");
+
+  EXPECT_EQ(graph.loadFromString(0, writeBinary(changed)),
+            LoadResult::AffectsDownstream);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_TRUE(graph.isMarked(1));
+  EXPECT_FALSE(graph.isMarked(2));
+}
@@ -15,6 +15,7 @@
 #include "gtest/gtest.h"
 #include <iterator>
 #include <functional>
+#include <set>
 #include <sys/mman.h>
 #include <vector>
 #include <pthread.h>
@@ -249,6 +250,58 @@ TEST(Concurrent, ConcurrentMap) {
 }
 
 
+namespace {
+  struct HashedEntry {
+    size_t Key;
+    HashedEntry(size_t key) : Key(key) {}
+    int compareWithKey(size_t key) const {
+      return (key == Key ? 0 : (key < Key ? -1 : 1));
+    }
+    static size_t getExtraAllocationSize(size_t key) { return 0; }
+    static size_t getKeyHash(size_t key) {
+      return (key * 0x9E3779B97F4A7C15ull) >> 16;
+    }
+  };
+}
+
+TEST(Concurrent, ConcurrentHashMap) {
+  const int numElem = 1000;
+
+  ConcurrentHashMap<HashedEntry> Map;
+
+  // Add a bunch of numbers to the map concurrently, forcing it to grow
+  // while other threads are looking up.
+  std::atomic<int> inserted(0);
+  RaceTest<int*>(
+    [&]() -> int* {
+      for (int i = 0; i < numElem; i++) {
+        size_t key = (i * 123512) % 0xFFFF;
+        auto result = Map.getOrInsert(key);
+        EXPECT_EQ(key, result.first->Key);
+        if (result.second)
+          ++inserted;
+        EXPECT_TRUE(Map.find(key));
+      }
+      return nullptr;
+    }
+  );
+
+  // Each key was inserted by exactly one thread.
+  std::set<size_t> keys;
+  for (int i = 0; i < numElem; i++)
+    keys.insert((i * 123512) % 0xFFFF);
+  EXPECT_EQ(keys.size(), size_t(inserted.load()));
+
+  for (auto key : keys) {
+    auto entry = Map.find(key);
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(key, entry->Key);
+    EXPECT_EQ(entry, Map.getOrInsert(key).first);
+  }
+  EXPECT_FALSE(Map.find(size_t(0x10000)));
+}
+
+
 TEST(MetadataTest, getGenericMetadata) {
   auto metadataTemplate = (GenericMetadata*) &MetadataTest1;
 
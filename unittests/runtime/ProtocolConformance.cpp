@@ -0,0 +1,75 @@
+//===--- ProtocolConformance.cpp - Conformance lookup tests ---------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Runtime/Metadata.h"
+#include "gtest/gtest.h"
+#include "ThreadingHelpers.h"
+#include <atomic>
+
+using namespace swift;
+
+extern "C" const ProtocolDescriptor _TMps8Hashable;
+extern "C" const ProtocolDescriptor _TMps5Error;
+
+extern "C" const Metadata _TMSb; // Bool
+extern "C" const Metadata _TMSi; // Int
+extern "C" const Metadata _TMSu; // UInt
+extern "C" const Metadata _TMSf; // Float
+extern "C" const Metadata _TMSd; // Double
+
+namespace {
+  struct ConformanceQuery {
+    const Metadata *Type;
+    const ProtocolDescriptor *Protocol;
+    bool ExpectConforms;
+  };
+}
+
+static const ConformanceQuery Queries[] = {
+  { &_TMSb, &_TMps8Hashable, true },
+  { &_TMSi, &_TMps8Hashable, true },
+  { &_TMSu, &_TMps8Hashable, true },
+  { &_TMSf, &_TMps8Hashable, true },
+  { &_TMSd, &_TMps8Hashable, true },
+  { &_TMSb, &_TMps5Error, false },
+  { &_TMSi, &_TMps5Error, false },
+  { &_TMSu, &_TMps5Error, false },
+  { &_TMSf, &_TMps5Error, false },
+  { &_TMSd, &_TMps5Error, false },
+};
+
+TEST(ProtocolConformanceTest, conformsToProtocol) {
+  for (auto &query : Queries) {
+    EXPECT_EQ(query.ExpectConforms,
+              swift_conformsToProtocol(query.Type, query.Protocol) != nullptr);
+  }
+}
+
+// Look up a mix of conforming and non-conforming pairs on several threads
+// at once; all threads must observe the same answers.
+TEST(ProtocolConformanceTest, conformsToProtocolOnThreads) {
+  const unsigned threadCount = 8;
+  const unsigned iterations = 1000;
+  const size_t numQueries = sizeof(Queries) / sizeof(Queries[0]);
+
+  std::atomic<unsigned> mismatches(0);
+  runOnThreads(threadCount, [&](unsigned threadIndex) {
+    for (unsigned i = 0; i < iterations; ++i) {
+      auto &query = Queries[(i + threadIndex) % numQueries];
+      bool conforms =
+        swift_conformsToProtocol(query.Type, query.Protocol) != nullptr;
+      if (conforms != query.ExpectConforms)
+        ++mismatches;
+    }
+  });
+  EXPECT_EQ(0u, mismatches.load());
+}
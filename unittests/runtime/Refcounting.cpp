@@ -13,6 +13,7 @@
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
 #include "gtest/gtest.h"
+#include "ThreadingHelpers.h"
 
 using namespace swift;
 
@@ -47,6 +48,35 @@ static TestObject *allocTestObject(size_t *addr, size_t value) {
   return result;
 }
 
+struct CountedTestObject : HeapObject {
+  std::atomic<size_t> *Deallocations;
+};
+
+static void destroyCountedTestObject(HeapObject *_object) {
+  auto object = static_cast<CountedTestObject*>(_object);
+  ++*object->Deallocations;
+  swift_deallocObject(object, sizeof(CountedTestObject),
+                      alignof(CountedTestObject) - 1);
+}
+
+static const FullMetadata<ClassMetadata> CountedTestClassObjectMetadata = {
+  { { &destroyCountedTestObject }, { &_TWVBo } },
+  { { { MetadataKind::Class } }, 0, /*rodata*/ 1,
+  ClassFlags::UsesSwift1Refcounting, nullptr, 0, 0, 0, 0, 0 }
+};
+
+/// Create an object that increments the given counter each time it is
+/// deallocated.
+static CountedTestObject *
+allocCountedTestObject(std::atomic<size_t> *deallocations) {
+  auto result = static_cast<CountedTestObject *>(
+    swift_allocObject(&CountedTestClassObjectMetadata,
+                      sizeof(CountedTestObject),
+                      alignof(CountedTestObject) - 1));
+  result->Deallocations = deallocations;
+  return result;
+}
+
 TEST(RefcountingTest, release) {
   size_t value = 0;
   auto object = allocTestObject(&value, 1);
@@ -246,3 +276,212 @@ TEST(RefcountingTest, nonatomic_unknown_retain_release_n) {
   EXPECT_EQ(1u, swift_retainCount(object));
 }
 
+
+TEST(RefcountingTest, weak_load_after_release) {
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  WeakReference ref;
+  swift_weakInit(&ref, object);
+  auto loaded = swift_weakLoadStrong(&ref);
+  EXPECT_EQ(object, loaded);
+  swift_release(loaded);
+  EXPECT_EQ(0u, value);
+
+  // The object is destroyed even though a weak reference to it remains.
+  swift_release(object);
+  EXPECT_EQ(1u, value);
+  EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref));
+  swift_weakDestroy(&ref);
+}
+
+TEST(RefcountingTest, weak_copy_take_assign) {
+  size_t value1 = 0, value2 = 0;
+  auto object1 = allocTestObject(&value1, 1);
+  auto object2 = allocTestObject(&value2, 1);
+
+  WeakReference ref1, ref2, ref3;
+  swift_weakInit(&ref1, object1);
+  swift_weakCopyInit(&ref2, &ref1);
+  swift_weakTakeInit(&ref3, &ref2);
+
+  auto loaded = swift_weakTakeStrong(&ref3);
+  EXPECT_EQ(object1, loaded);
+  swift_release(loaded);
+
+  swift_weakInit(&ref2, object2);
+  swift_weakCopyAssign(&ref2, &ref1);
+  loaded = swift_weakLoadStrong(&ref2);
+  EXPECT_EQ(object1, loaded);
+  swift_release(loaded);
+
+  swift_weakAssign(&ref1, object2);
+  swift_release(object1);
+  EXPECT_EQ(1u, value1);
+  EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref2));
+
+  // Copying a reference to a dead object produces nil.
+  swift_weakInit(&ref3, nullptr);
+  swift_weakCopyAssign(&ref3, &ref2);
+  EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref3));
+
+  swift_weakTakeAssign(&ref3, &ref1);
+  loaded = swift_weakLoadStrong(&ref3);
+  EXPECT_EQ(object2, loaded);
+  swift_release(loaded);
+
+  swift_release(object2);
+  EXPECT_EQ(1u, value2);
+  EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref3));
+  swift_weakDestroy(&ref2);
+  swift_weakDestroy(&ref3);
+}
+
+TEST(RefcountingTest, weak_load_on_threads) {
+  const unsigned threadCount = 4;
+  const unsigned iterations = 1000;
+
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  WeakReference ref;
+  swift_weakInit(&ref, object);
+
+  std::atomic<unsigned> mismatches(0);
+  runOnThreads(threadCount, [&](unsigned threadIndex) {
+    for (unsigned i = 0; i < iterations; ++i) {
+      auto loaded = swift_weakLoadStrong(&ref);
+      if (loaded != object)
+        ++mismatches;
+      swift_release(loaded);
+    }
+  });
+  EXPECT_EQ(0u, mismatches.load());
+  EXPECT_EQ(1u, swift_retainCount(object));
+
+  // Race loads against the release of the last strong reference.
+  runOnThreads(threadCount, [&](unsigned threadIndex) {
+    if (threadIndex == 0) {
+      swift_release(object);
+      return;
+    }
+    for (unsigned i = 0; i < iterations; ++i) {
+      if (auto loaded = swift_weakLoadStrong(&ref)) {
+        if (loaded != object)
+          ++mismatches;
+        swift_release(loaded);
+      }
+    }
+  });
+  EXPECT_EQ(0u, mismatches.load());
+  EXPECT_EQ(1u, value);
+  EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref));
+  swift_weakDestroy(&ref);
+}
+
+TEST(RefcountingTest, immortal) {
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  EXPECT_FALSE(swift_isImmortal(object));
+  swift_setImmortal(object);
+  EXPECT_TRUE(swift_isImmortal(object));
+
+  auto count = swift_retainCount(object);
+  swift_retain(object);
+  swift_retain_n(object, 3);
+  swift_nonatomic_retain(object);
+  EXPECT_EQ(count, swift_retainCount(object));
+
+  // Releasing more references than were ever retained must not free it.
+  swift_release(object);
+  swift_release(object);
+  swift_release_n(object, 5);
+  swift_nonatomic_release(object);
+  EXPECT_EQ(count, swift_retainCount(object));
+  EXPECT_EQ(0u, value);
+
+  EXPECT_FALSE(swift_isUniquelyReferenced_nonNull_native(object));
+  EXPECT_FALSE(swift_isUniquelyReferencedOrPinned_nonNull_native(object));
+  EXPECT_EQ(nullptr, swift_tryPin(object));
+  EXPECT_EQ(object, swift_tryRetain(object));
+  EXPECT_EQ(0u, value);
+}
+
+TEST(RefcountingTest, immortal_on_threads) {
+  const unsigned threadCount = 4;
+  const unsigned iterations = 1000;
+
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  swift_setImmortal(object);
+  auto count = swift_retainCount(object);
+
+  // Unbalanced releases on some threads must not free it either.
+  runOnThreads(threadCount, [&](unsigned threadIndex) {
+    for (unsigned i = 0; i < iterations; ++i) {
+      if (threadIndex % 2 == 0)
+        swift_retain(object);
+      swift_release(object);
+    }
+  });
+
+  EXPECT_TRUE(swift_isImmortal(object));
+  EXPECT_EQ(count, swift_retainCount(object));
+  EXPECT_EQ(0u, value);
+}
+
+TEST(RefcountingTest, release_on_other_threads) {
+  const unsigned threadCount = 8;
+  const unsigned releasesPerThread = 100;
+
+  // Objects may keep a separate count for the thread that allocated them;
+  // releases from other threads have to be reconciled with it.
+  std::atomic<size_t> deallocations(0);
+  auto object = allocCountedTestObject(&deallocations);
+  swift_retain_n(object, threadCount * releasesPerThread);
+
+  runOnThreads(threadCount, [&](unsigned threadIndex) {
+    for (unsigned i = 0; i < releasesPerThread; ++i)
+      swift_release(object);
+  });
+  EXPECT_EQ(0u, deallocations.load());
+  EXPECT_EQ(1u, swift_retainCount(object));
+
+  // The allocating thread's last release settles what the others released.
+  swift_release(object);
+  EXPECT_EQ(1u, deallocations.load());
+}
+
+TEST(RefcountingTest, release_last_reference_on_other_thread) {
+  std::atomic<size_t> deallocations(0);
+  auto object = allocCountedTestObject(&deallocations);
+  swift_retain(object);
+
+  // Hand both references to another thread. Its releases may be owed to
+  // this thread rather than applied right away.
+  std::thread([&] {
+    swift_release(object);
+    swift_release(object);
+  }).join();
+
+  // Allocating and releasing settles anything owed to this thread.
+  std::atomic<size_t> otherDeallocations(0);
+  swift_release(allocCountedTestObject(&otherDeallocations));
+  EXPECT_EQ(1u, otherDeallocations.load());
+  EXPECT_EQ(1u, deallocations.load());
+}
+
+TEST(RefcountingTest, release_after_allocating_thread_exits) {
+  std::atomic<size_t> deallocations(0);
+  CountedTestObject *object = nullptr;
+  std::thread([&] {
+    object = allocCountedTestObject(&deallocations);
+    swift_retain(object);
+    swift_release(object);
+  }).join();
+  EXPECT_EQ(0u, deallocations.load());
+
+  swift_retain(object);
+  swift_release(object);
+  EXPECT_EQ(0u, deallocations.load());
+  swift_release(object);
+  EXPECT_EQ(1u, deallocations.load());
+}
@@ -0,0 +1,45 @@
+//===--- ThreadingHelpers.h - Helpers for multithreaded tests ---*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_UNITTESTS_RUNTIME_THREADINGHELPERS_H
+#define SWIFT_UNITTESTS_RUNTIME_THREADINGHELPERS_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/// Run \p body on \p threadCount threads that are released at the same time,
+/// and wait for all of them to finish.
+template <typename ThreadBody>
+static void runOnThreads(unsigned threadCount, ThreadBody body) {
+  std::vector<std::thread> threads;
+  std::atomic<bool> spinWait(true);
+  std::atomic<unsigned> readyCount(0);
+
+  for (unsigned i = 0; i < threadCount; ++i) {
+    threads.push_back(std::thread([&, i] {
+      ++readyCount;
+      while (spinWait)
+        std::this_thread::yield();
+      body(i);
+    }));
+  }
+
+  while (readyCount < threadCount)
+    std::this_thread::yield();
+
+  spinWait = false;
+  for (auto &thread : threads)
+    thread.join();
+}
+
+#endif